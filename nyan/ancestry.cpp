@@ -0,0 +1,79 @@
+// Copyright 2019-2019 the nyan authors, LGPLv3+. See copying.md for legal info.
+
+#include "ancestry.h"
+
+#include <algorithm>
+
+#include "object_state.h"
+
+
+namespace nyan {
+
+static constexpr size_t word_bits = 64;
+
+
+Ancestry::Ancestry(const std::vector<obj_id_t> &linearization) {
+	if (linearization.empty()) {
+		return;
+	}
+
+	auto range = std::minmax_element(std::begin(linearization),
+	                                 std::end(linearization));
+
+	this->first_ancestor = *range.first;
+	this->ancestors.resize((*range.second - *range.first) / word_bits + 1);
+
+	for (auto &obj : linearization) {
+		set_bit(this->ancestors, obj - this->first_ancestor);
+	}
+}
+
+
+void Ancestry::add_members(const ObjectState &state) {
+	for (auto &it : state.get_members()) {
+		set_bit(this->members, it.second.first.get_id());
+	}
+}
+
+
+bool Ancestry::extends(obj_id_t obj) const {
+	if (obj < this->first_ancestor) {
+		return false;
+	}
+
+	return test_bit(this->ancestors, obj - this->first_ancestor);
+}
+
+
+bool Ancestry::has(member_id_t member) const {
+	return test_bit(this->members, member);
+}
+
+
+size_t Ancestry::get_size() const {
+	return (sizeof(Ancestry)
+	        + (this->ancestors.capacity() + this->members.capacity()) * sizeof(word_t));
+}
+
+
+void Ancestry::set_bit(std::vector<word_t> &bits, size_t idx) {
+	size_t word = idx / word_bits;
+	if (word >= bits.size()) {
+		bits.resize(word + 1);
+	}
+
+	bits[word] |= word_t{1} << (idx % word_bits);
+}
+
+
+bool Ancestry::test_bit(const std::vector<word_t> &bits, size_t idx) {
+	size_t word = idx / word_bits;
+	if (word >= bits.size()) {
+		return false;
+	}
+
+	return bits[word] & (word_t{1} << (idx % word_bits));
+}
+
+
+} // namespace nyan
@@ -0,0 +1,76 @@
+// Copyright 2019-2019 the nyan authors, LGPLv3+. See copying.md for legal info.
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "config.h"
+
+
+namespace nyan {
+
+class ObjectState;
+
+
+/**
+ * Ancestors and members of an object for constant time lookups.
+ *
+ * Both are stored as bitsets over the dense ids.
+ * The ancestor bits only span the ids of the linearization,
+ * so the set is small even if the ids are far apart.
+ */
+class Ancestry {
+public:
+	Ancestry() = default;
+
+	/**
+	 * Create the ancestry of the object with the given linearization.
+	 * The members have to be added for each object of it.
+	 */
+	Ancestry(const std::vector<obj_id_t> &linearization);
+
+	/**
+	 * Mark the members stored in the state as present.
+	 */
+	void add_members(const ObjectState &state);
+
+	/**
+	 * Check if the object is in the linearization.
+	 */
+	bool extends(obj_id_t obj) const;
+
+	/**
+	 * Check if any object of the linearization has the member.
+	 */
+	bool has(member_id_t member) const;
+
+	/**
+	 * Return the estimated memory used for the bitsets.
+	 */
+	size_t get_size() const;
+
+protected:
+	using word_t = uint64_t;
+
+	static void set_bit(std::vector<word_t> &bits, size_t idx);
+	static bool test_bit(const std::vector<word_t> &bits, size_t idx);
+
+	/**
+	 * Lowest object id in the linearization,
+	 * which is stored in the first ancestor bit.
+	 */
+	obj_id_t first_ancestor = 0;
+
+	/**
+	 * Bit i is set if object first_ancestor + i is an ancestor.
+	 */
+	std::vector<word_t> ancestors;
+
+	/**
+	 * Bit i is set if member id i is present.
+	 */
+	std::vector<word_t> members;
+};
+
+
+} // namespace nyan
@@ -0,0 +1,136 @@
+// Copyright 2019-2019 the nyan authors, LGPLv3+. See copying.md for legal info.
+
+/**
+ * Throughput comparison of the vector based nyan::Curve
+ * against a std::map based curve for the typical access patterns.
+ *
+ * Build with `make nyanbench` and run it without arguments.
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../curve.h"
+
+
+namespace nyan::benchmark {
+
+/**
+ * Curve stored in a std::map, like nyan did before.
+ */
+template<typename T>
+class MapCurve {
+public:
+	const T &at(const order_t time) const {
+		auto it = this->container.upper_bound(time);
+		if (it == std::begin(this->container)) {
+			throw InternalError{"requested time lower than first curve entry"};
+		}
+		--it;
+		return it->second;
+	}
+
+	T &insert_drop(const order_t time, T &&value) {
+		auto it = this->container.lower_bound(time);
+		this->container.erase(it, std::end(this->container));
+		return this->container.insert({time, std::move(value)}).first->second;
+	}
+
+protected:
+	std::map<order_t, T> container;
+};
+
+
+/**
+ * Prevent the compiler from optimizing away the benchmarked reads.
+ */
+volatile uint64_t sink;
+
+
+/**
+ * Run the function and print the nanoseconds per operation.
+ */
+template<typename F>
+void measure(const std::string &name, size_t ops, F &&func) {
+	auto start = std::chrono::steady_clock::now();
+	func();
+	auto end = std::chrono::steady_clock::now();
+
+	double nsecs = std::chrono::duration<double, std::nano>(end - start).count();
+	std::cout << std::left << std::setw(32) << name
+	          << std::right << std::setw(10) << std::fixed << std::setprecision(2)
+	          << (nsecs / ops) << " ns/op" << std::endl;
+}
+
+
+template<typename C>
+void run(const std::string &name, size_t keyframes, size_t reads) {
+	std::cout << name << ", " << keyframes << " keyframes:" << std::endl;
+
+	C curve;
+	measure("  append (insert_drop)", keyframes, [&] {
+		for (order_t t = 0; t < keyframes; t++) {
+			curve.insert_drop(t * 10, uint64_t{t});
+		}
+	});
+
+	measure("  read latest", reads, [&] {
+		uint64_t sum = 0;
+		for (size_t i = 0; i < reads; i++) {
+			sum += curve.at(keyframes * 10);
+		}
+		sink = sum;
+	});
+
+	measure("  read monotonic", reads, [&] {
+		uint64_t sum = 0;
+		order_t step = (keyframes * 10) / reads + 1;
+		for (size_t i = 0; i < reads; i++) {
+			sum += curve.at((i * step) % (keyframes * 10));
+		}
+		sink = sum;
+	});
+
+	std::mt19937_64 rng{42};
+	std::vector<order_t> times(reads);
+	for (auto &time : times) {
+		time = rng() % (keyframes * 10);
+	}
+
+	measure("  read random", reads, [&] {
+		uint64_t sum = 0;
+		for (auto time : times) {
+			sum += curve.at(time);
+		}
+		sink = sum;
+	});
+
+	measure("  rewrite tail (insert_drop)", reads, [&] {
+		for (size_t i = 0; i < reads; i++) {
+			order_t time = (keyframes - 1 - (i % 4)) * 10;
+			curve.insert_drop(time, uint64_t{i});
+		}
+	});
+
+	std::cout << std::endl;
+}
+
+} // namespace nyan::benchmark
+
+
+int main() {
+	using namespace nyan::benchmark;
+
+	for (size_t keyframes : {16, 1024, 65536}) {
+		run<nyan::Curve<uint64_t>>("vector curve", keyframes, 1000000);
+		run<MapCurve<uint64_t>>("map curve", keyframes, 1000000);
+	}
+
+	return 0;
+}
@@ -1,162 +1,199 @@
-// Copyright 2016-2017 the nyan authors, LGPLv3+. See copying.md for legal info.
+// Copyright 2016-2019 the nyan authors, LGPLv3+. See copying.md for legal info.
 
 #include "c3.h"
 
+#include <unordered_map>
+
 #include "compiler.h"
 #include "object_state.h"
+#include "symbol_table.h"
 #include "util.h"
 
 
 namespace nyan {
 
 
-std::vector<fqon_t> linearize(const fqon_t &name, const objstate_fetch_t &get_obj) {
-	std::unordered_set<fqon_t> seen;
-	return linearize_recurse(name, get_obj, &seen);
+std::vector<obj_id_t> linearize(obj_id_t obj,
+                                const objstate_fetch_t &get_obj,
+                                const SymbolTable &symbols) {
+
+	// linearizations of all visited objects.
+	// map nodes are stable, so the references returned by store are, too.
+	std::unordered_map<obj_id_t, std::vector<obj_id_t>> known;
+
+	const std::vector<obj_id_t> &ret = linearize_cached(
+		obj,
+		get_obj,
+		[&known] (obj_id_t parent) -> const std::vector<obj_id_t> * {
+			auto it = known.find(parent);
+			if (it == std::end(known)) {
+				return nullptr;
+			}
+			return &it->second;
+		},
+		[&known] (obj_id_t parent, std::vector<obj_id_t> &&lin)
+		-> const std::vector<obj_id_t> & {
+			return known.emplace(parent, std::move(lin)).first->second;
+		},
+		symbols
+	);
+
+	return ret;
 }
 
 
-/*
- * Implementation of c3 inheritance linearization.
- *
- * c3 linearization of cls(a, b, ...):
- * c3(cls) = [cls] + merge(c3(a), c3(b), ..., [a, b, ...])
- *
- * merge: take first head of lists which is not in any tail of all lists.
- * that head can be the first for multiple lists, pick it from all them.
- * if valid, add to output and remove from all lists where it is head.
- * repeat until all lists are empty.
- * if all heads of the lists appear somewhere in a tail,
- * no linearization exists.
+/**
+ * Recursive walk for the cached c3 linearization.
+ * Linearizes all the unknown parents first.
  */
-std::vector<fqon_t>
-linearize_recurse(const fqon_t &name,
+static const std::vector<obj_id_t> &
+linearize_recurse(obj_id_t obj,
                   const objstate_fetch_t &get_obj,
-                  std::unordered_set<fqon_t> *seen) {
+                  const linearization_fetch_t &get_lin,
+                  const linearization_store_t &store_lin,
+                  const SymbolTable &symbols,
+                  std::unordered_set<obj_id_t> *seen) {
 
 	using namespace std::string_literals;
 
+	// linearization is known already
+	const std::vector<obj_id_t> *known = get_lin(obj);
+	if (known != nullptr) {
+		return *known;
+	}
+
 	// test for inheritance loops
-	if (seen->find(name) != std::end(*seen)) {
+	if (seen->find(obj) != std::end(*seen)) {
 		throw C3Error{
-			"recursive inheritance loop detected: '"s + name + "' already in {"
-			+ util::strjoin(", ", *seen)
+			"recursive inheritance loop detected: '"s
+			+ symbols.get_object_name(obj) + "' already in {"
+			+ util::strjoin(", ", symbols.object_names(*seen))
 			+ "}"
 		};
 	} else {
-		seen->insert(name);
+		seen->insert(obj);
 	}
 
 	// get raw ObjectState of this object at the requested time
-	const ObjectState &obj_state = get_obj(name);
-
-	// calculate a new linearization in this list
-	std::vector<fqon_t> linearization;
-
-	// The current object is always the first in the returned list
-	linearization.push_back(name);
+	const ObjectState &obj_state = get_obj(obj);
 
 	// Get parents of object.
 	const auto &parents = obj_state.get_parents();
 
-	// Calculate the parent linearization recursively
-	std::vector<std::vector<fqon_t>> par_linearizations;
-	par_linearizations.reserve(parents.size() + 1);
+	// Fetch or calculate the parent linearizations recursively
+	std::vector<const std::vector<obj_id_t> *> par_linearizations;
+	par_linearizations.reserve(parents.size());
 
 	for (auto &parent : parents) {
-		// Recursive call to get the linearization of the parent
 		par_linearizations.push_back(
-			linearize_recurse(parent, get_obj, seen)
+			&linearize_recurse(parent, get_obj, get_lin, store_lin, symbols, seen)
 		);
 	}
 
-	// And at the end, add all parents of this object to the merge-list.
-	par_linearizations.push_back(
-		{std::begin(parents), std::end(parents)}
-	);
-
 	// remove current name from the seen set
 	// we only needed it for the recursive call above.
-	seen->erase(name);
+	seen->erase(obj);
+
+	return store_lin(
+		obj,
+		linearize_merge(obj, parents, par_linearizations, symbols)
+	);
+}
+
+
+const std::vector<obj_id_t> &
+linearize_cached(obj_id_t obj,
+                 const objstate_fetch_t &get_obj,
+                 const linearization_fetch_t &get_lin,
+                 const linearization_store_t &store_lin,
+                 const SymbolTable &symbols) {
+
+	std::unordered_set<obj_id_t> seen;
+	return linearize_recurse(obj, get_obj, get_lin, store_lin, symbols, &seen);
+}
+
+
+/*
+ * Implementation of c3 inheritance linearization.
+ *
+ * c3 linearization of cls(a, b, ...):
+ * c3(cls) = [cls] + merge(c3(a), c3(b), ..., [a, b, ...])
+ *
+ * merge: take first head of lists which is not in any tail of all lists.
+ * that head can be the first for multiple lists, pick it from all them.
+ * if valid, add to output and remove from all lists where it is head.
+ * repeat until all lists are empty.
+ * if all heads of the lists appear somewhere in a tail,
+ * no linearization exists.
+ *
+ * To test if a head is in a tail, we count how often
+ * each object occurs in all the tails.
+ * When a list head advances, the new head leaves its tail.
+ */
+std::vector<obj_id_t>
+linearize_merge(obj_id_t obj,
+                const std::deque<obj_id_t> &parents,
+                const std::vector<const std::vector<obj_id_t> *> &par_linearizations,
+                const SymbolTable &symbols) {
+
+	using namespace std::string_literals;
+
+	// the parent linearizations and, at the end,
+	// all parents of this object are merged.
+	std::vector<obj_id_t> parent_list{std::begin(parents), std::end(parents)};
+
+	std::vector<const std::vector<obj_id_t> *> sublists{par_linearizations};
+	sublists.push_back(&parent_list);
+
+	// calculate a new linearization in this list
+	std::vector<obj_id_t> linearization;
+
+	// The current object is always the first in the returned list
+	linearization.push_back(obj);
 
 	// Index to start with in each list
 	// On a side note, I used {} instead of () for some time.
 	// But that, unfortunately was buggy.
 	// What the bug was is left as a fun challenge for the reader.
-	std::vector<size_t> sublists_heads(par_linearizations.size(), 0);
+	std::vector<size_t> sublists_heads(sublists.size(), 0);
+
+	// object => number of tails it is contained in
+	std::unordered_map<obj_id_t, size_t> tail_count;
+
+	size_t total_size = 0;
+	for (auto &sublist : sublists) {
+		total_size += sublist->size();
+
+		// all except the head are in the tail
+		for (size_t k = 1; k < sublist->size(); k++) {
+			tail_count[(*sublist)[k]] += 1;
+		}
+	}
+
+	linearization.reserve(total_size + 1);
 
 	// For each loop, find a candidate to add to the result.
 	while (true) {
-		const fqon_t *candidate;
-		bool candidate_ok = false;
-		size_t sublists_available = par_linearizations.size();
+		const obj_id_t *candidate = nullptr;
+		size_t sublists_available = 0;
 
 		// Try to find a head that is not element of any tail
-		for (size_t i = 0; i < par_linearizations.size(); i++) {
-			const auto &par_linearization = par_linearizations[i];
+		for (size_t i = 0; i < sublists.size(); i++) {
+			const auto &sublist = *sublists[i];
 			const size_t headpos = sublists_heads[i];
 
 			// The head position has reached the end (i.e. the list is "empty")
-			if (headpos >= par_linearization.size()) {
-				sublists_available -= 1;
+			if (headpos >= sublist.size()) {
 				continue;
 			}
 
-			// Pick a head
-			candidate = &par_linearization[headpos];
-			candidate_ok = true;
+			sublists_available += 1;
 
-			// Test if the candidate is in any tail
-			for (size_t j = 0; j < par_linearizations.size(); j++) {
-
-				// The current list will never contain the candidate again.
-				if (j == i) {
-					continue;
-				}
-
-				const auto &tail = par_linearizations[j];
-				const size_t headpos_try = sublists_heads[j];
-
-				// Start one slot after the head
-				// and check that the candidate is not in that tail.
-				for (size_t k = headpos_try + 1; k < tail.size(); k++) {
-
-					// The head is in that tail, so we fail
-					if (unlikely(*candidate == tail[k])) {
-						candidate_ok = false;
-						break;
-					}
-				}
-
-				// Don't try further tails as one already failed.
-				if (unlikely(not candidate_ok)) {
-					break;
-				}
-			}
-
-			// The candidate was not in any tail
-			if (candidate_ok) {
-				break;
-			} else {
-				// Try the next candidate,
-				// this means to select the next par_lin list.
-				continue;
-			}
-		}
-
-		// We found a candidate, add it to the return list
-		if (candidate_ok) {
-			linearization.push_back(*candidate);
-
-			// Advance all the lists where the candidate was the head
-			for (size_t i = 0; i < par_linearizations.size(); i++) {
-				const auto &par_linearization = par_linearizations[i];
-				const size_t headpos = sublists_heads[i];
-
-				if (headpos < par_linearization.size()) {
-					if (par_linearization[headpos] == *candidate) {
-						sublists_heads[i] += 1;
-					}
+			// Pick the first head that is in no tail
+			if (candidate == nullptr) {
+				auto count = tail_count.find(sublist[headpos]);
+				if (count == std::end(tail_count) or count->second == 0) {
+					candidate = &sublist[headpos];
 				}
 			}
 		}
@@ -167,12 +204,32 @@ linearize_recurse(const fqon_t &name,
 			return linearization;
 		}
 
-		if (not candidate_ok) {
+		if (unlikely(candidate == nullptr)) {
 			throw C3Error{
 				"Can't find consistent C3 resolution order for "s
-				+ name + " for bases " + util::strjoin(", ", parents)
+				+ symbols.get_object_name(obj) + " for bases "
+				+ util::strjoin(", ", symbols.object_names(parents))
 			};
 		}
+
+		// We found a candidate, add it to the return list
+		obj_id_t chosen = *candidate;
+		linearization.push_back(chosen);
+
+		// Advance all the lists where the candidate was the head
+		for (size_t i = 0; i < sublists.size(); i++) {
+			const auto &sublist = *sublists[i];
+			size_t &headpos = sublists_heads[i];
+
+			if (headpos < sublist.size() and sublist[headpos] == chosen) {
+				headpos += 1;
+
+				// the new head is no longer in this tail
+				if (headpos < sublist.size()) {
+					tail_count[sublist[headpos]] -= 1;
+				}
+			}
+		}
 	}
 
 	// should not be reached :)
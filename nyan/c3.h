@@ -1,6 +1,7 @@
-// Copyright 2016-2017 the nyan authors, LGPLv3+. See copying.md for legal info.
+// Copyright 2016-2019 the nyan authors, LGPLv3+. See copying.md for legal info.
 #pragma once
 
+#include <deque>
 #include <functional>
 #include <unordered_set>
 #include <vector>
@@ -12,28 +13,60 @@
 namespace nyan {
 
 class ObjectState;
+class SymbolTable;
 
 
 /**
  * Function to fetch an object state.
  */
-using objstate_fetch_t = std::function<const ObjectState &(const fqon_t &)>;
+using objstate_fetch_t = std::function<const ObjectState &(obj_id_t)>;
+
+/**
+ * Function to fetch an already known linearization of an object.
+ * Returns nullptr if the linearization has to be calculated.
+ */
+using linearization_fetch_t = std::function<const std::vector<obj_id_t> *(obj_id_t)>;
+
+/**
+ * Function to store a calculated linearization of an object.
+ * Returns a reference to the stored linearization,
+ * it has to stay valid until the linearization is finished.
+ */
+using linearization_store_t = std::function<const std::vector<obj_id_t> &(obj_id_t, std::vector<obj_id_t> &&)>;
 
 
 /**
  * Implements the C3 multi inheritance linearization algorithm
  * to bring the parents of an object into the "right" order.
  */
-std::vector<fqon_t> linearize(const fqon_t &name, const objstate_fetch_t &get_obj);
+std::vector<obj_id_t> linearize(obj_id_t obj,
+                                const objstate_fetch_t &get_obj,
+                                const SymbolTable &symbols);
+
+
+/**
+ * C3 linearization that reuses the known linearizations of ancestors.
+ * Each ancestor is only linearized once, unknown ones
+ * are calculated and handed over to store_lin.
+ */
+const std::vector<obj_id_t> &
+linearize_cached(obj_id_t obj,
+                 const objstate_fetch_t &get_obj,
+                 const linearization_fetch_t &get_lin,
+                 const linearization_store_t &store_lin,
+                 const SymbolTable &symbols);
 
 
 /**
- * Recursive walk for the c3 linearization implememtation.
+ * Merge step of the c3 linearization:
+ * Create the linearization of an object from the
+ * linearizations of its parents.
  */
-std::vector<fqon_t>
-linearize_recurse(const fqon_t &name,
-                  const objstate_fetch_t &get_obj,
-                  std::unordered_set<fqon_t> *seen);
+std::vector<obj_id_t>
+linearize_merge(obj_id_t obj,
+                const std::deque<obj_id_t> &parents,
+                const std::vector<const std::vector<obj_id_t> *> &par_linearizations,
+                const SymbolTable &symbols);
 
 
 /**
@@ -5,12 +5,42 @@
 
 namespace nyan {
 
-void ObjectChanges::add_parent(const fqon_t &obj) {
+void changed_members::merge(const changed_members &other) {
+	if (this->all) {
+		return;
+	}
+
+	if (other.all) {
+		this->all = true;
+		this->members.clear();
+		return;
+	}
+
+	this->members.insert(std::begin(other.members), std::end(other.members));
+}
+
+
+bool changed_members::contains_any(const std::unordered_set<member_id_t> &members) const {
+	if (this->all) {
+		return true;
+	}
+
+	for (auto &member : members) {
+		if (this->members.find(member) != std::end(this->members)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+void ObjectChanges::add_parent(obj_id_t obj) {
 	this->new_parents.push_back(obj);
 }
 
 
-const std::vector<fqon_t> &ObjectChanges::get_new_parents() const {
+const std::vector<obj_id_t> &ObjectChanges::get_new_parents() const {
 	return this->new_parents;
 }
 
@@ -20,13 +50,23 @@ bool ObjectChanges::parents_update_required() const {
 }
 
 
-ObjectChanges &ChangeTracker::track_patch(const fqon_t &target_name) {
+void ObjectChanges::add_member(member_id_t member) {
+	this->members.insert(member);
+}
+
+
+const std::unordered_set<member_id_t> &ObjectChanges::get_changed_members() const {
+	return this->members;
+}
+
+
+ObjectChanges &ChangeTracker::track_patch(obj_id_t target) {
 	// if existing, return the object change tracker
 	// else: create a new one.
-	auto it = this->changes.find(target_name);
+	auto it = this->changes.find(target);
 	if (it == std::end(this->changes)) {
 		return this->changes.emplace(
-			target_name,
+			target,
 			ObjectChanges{}
 		).first->second;
 	}
@@ -36,17 +76,25 @@ ObjectChanges &ChangeTracker::track_patch(const fqon_t &target_name) {
 }
 
 
-const std::unordered_map<fqon_t, ObjectChanges> &ChangeTracker::get_object_changes() const {
+const std::unordered_map<obj_id_t, ObjectChanges> &ChangeTracker::get_object_changes() const {
 	return this->changes;
 }
 
 
-std::unordered_set<fqon_t> ChangeTracker::get_changed_objects() const {
-	std::unordered_set<fqon_t> ret;
+changed_objects_t ChangeTracker::get_changed_objects() const {
+	changed_objects_t ret;
 	ret.reserve(this->changes.size());
 
 	for (auto &it : this->changes) {
-		ret.insert(it.first);
+		auto &obj_changes = it.second;
+		changed_members &members = ret[it.first];
+
+		if (obj_changes.parents_update_required()) {
+			members.all = true;
+		}
+		else {
+			members.members = obj_changes.get_changed_members();
+		}
 	}
 
 	return ret;
@@ -11,18 +11,62 @@
 namespace nyan {
 
 
+/**
+ * Members of an object whose values may have changed.
+ */
+struct changed_members {
+	/**
+	 * True if the values of all members may have changed,
+	 * e.g. because the object got new parents.
+	 */
+	bool all = false;
+
+	/**
+	 * Members that were patched, unless all may have changed.
+	 */
+	std::unordered_set<member_id_t> members;
+
+	/**
+	 * Add the changed members of the other object.
+	 */
+	void merge(const changed_members &other);
+
+	/**
+	 * Check if one of the given members may have changed.
+	 */
+	bool contains_any(const std::unordered_set<member_id_t> &members) const;
+};
+
+
+/**
+ * Objects whose member values may have changed.
+ */
+using changed_objects_t = std::unordered_map<obj_id_t, changed_members>;
+
+
 /**
  * Change tracking for a single object.
  */
 class ObjectChanges {
 public:
-	void add_parent(const fqon_t &obj);
+	void add_parent(obj_id_t obj);
 
-	const std::vector<fqon_t> &get_new_parents() const;
+	const std::vector<obj_id_t> &get_new_parents() const;
 	bool parents_update_required() const;
 
+	/**
+	 * Remember that a patch changed the member.
+	 */
+	void add_member(member_id_t member);
+
+	/**
+	 * Return the members that were changed by patches.
+	 */
+	const std::unordered_set<member_id_t> &get_changed_members() const;
+
 protected:
-	std::vector<fqon_t> new_parents;
+	std::vector<obj_id_t> new_parents;
+	std::unordered_set<member_id_t> members;
 };
 
 
@@ -32,14 +76,18 @@ protected:
  */
 class ChangeTracker {
 public:
-	ObjectChanges &track_patch(const fqon_t &target_name);
+	ObjectChanges &track_patch(obj_id_t target);
 
-	const std::unordered_map<fqon_t, ObjectChanges> &get_object_changes() const;
+	const std::unordered_map<obj_id_t, ObjectChanges> &get_object_changes() const;
 
-	std::unordered_set<fqon_t> get_changed_objects() const;
+	/**
+	 * Return the patched objects and their changed members.
+	 * Objects with new parents may have changed all members.
+	 */
+	changed_objects_t get_changed_objects() const;
 
 protected:
-	std::unordered_map<fqon_t, ObjectChanges> changes;
+	std::unordered_map<obj_id_t, ObjectChanges> changes;
 };
 
 } // namespace nyan
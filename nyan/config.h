@@ -8,6 +8,7 @@
 #endif
 
 #include <cstddef>
+#include <cstdint>
 #include <limits>
 #include <string>
 
@@ -32,9 +33,21 @@ using fqon_t = std::string;
 /** member name identifier type */
 using memberid_t = std::string;
 
+/** interned fully-qualified object name, assigned by the SymbolTable */
+using obj_id_t = uint32_t;
+
+/** interned member name, assigned by the SymbolTable */
+using member_id_t = uint32_t;
+
+/** storage slot of a member in object states */
+using member_slot_t = uint32_t;
+
 /** member and override nesting depth type */
 using override_depth_t = unsigned;
 
+/** commit order of transactions, unique for each committed transaction */
+using transaction_id_t = uint64_t;
+
 /** type used for nyan::Int values */
 using value_int_t = int64_t;
 
@@ -1,9 +1,13 @@
-// Copyright 2017-2017 the nyan authors, LGPLv3+. See copying.md for legal info.
+// Copyright 2017-2019 the nyan authors, LGPLv3+. See copying.md for legal info.
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <functional>
-#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
 
 #include "compiler.h"
 #include "config.h"
@@ -13,17 +17,75 @@
 
 namespace nyan {
 
+/**
+ * Values of type T recorded at points in time.
+ *
+ * The keyframes are stored sorted by time in chunks of fixed size.
+ * Copies of the curve share the chunks, a modification only copies
+ * the chunks it changes. History is usually appended at increasing
+ * times, so that's just the last chunk.
+ *
+ * History is also usually queried near the latest time, so the
+ * position of the last lookup is cached and tried first,
+ * before falling back to a binary search.
+ *
+ * References to stored values are invalidated when the curve is modified.
+ */
 template<typename T>
 class Curve {
 public:
 
-	using container_t = std::map<order_t, T>;
+	using entry_t = std::pair<order_t, T>;
 
 	using fallback_t = std::function<const T &(const order_t)>;
 
 
 	Curve() {}
 
+	Curve(const Curve &other)
+		:
+		chunks{other.chunks},
+		entry_count{other.entry_count},
+		cursor{other.cursor.load(std::memory_order_relaxed)} {
+#ifdef CURVE_FALLBACK_FUNCTION
+		this->fallback = other.fallback;
+#endif
+	}
+
+	Curve(Curve &&other) noexcept
+		:
+		chunks{std::move(other.chunks)},
+		entry_count{other.entry_count},
+		cursor{other.cursor.load(std::memory_order_relaxed)} {
+#ifdef CURVE_FALLBACK_FUNCTION
+		this->fallback = std::move(other.fallback);
+#endif
+		other.entry_count = 0;
+	}
+
+	Curve &operator =(const Curve &other) {
+		this->chunks = other.chunks;
+		this->entry_count = other.entry_count;
+		this->cursor.store(other.cursor.load(std::memory_order_relaxed),
+		                   std::memory_order_relaxed);
+#ifdef CURVE_FALLBACK_FUNCTION
+		this->fallback = other.fallback;
+#endif
+		return *this;
+	}
+
+	Curve &operator =(Curve &&other) noexcept {
+		this->chunks = std::move(other.chunks);
+		this->entry_count = other.entry_count;
+		other.entry_count = 0;
+		this->cursor.store(other.cursor.load(std::memory_order_relaxed),
+		                   std::memory_order_relaxed);
+#ifdef CURVE_FALLBACK_FUNCTION
+		this->fallback = std::move(other.fallback);
+#endif
+		return *this;
+	}
+
 #ifdef CURVE_FALLBACK_FUNCTION
 	Curve(const fallback_t &func)
 		:
@@ -43,9 +105,9 @@ public:
 	 * Get the latest value at given time.
 	 */
 	const T &at(const order_t time) const {
-		// search for element which is greater than time
-		auto it = this->container.upper_bound(time);
-		if (it == std::begin(this->container)) {
+		// number of keyframes at or before the time
+		size_t idx = this->upper_index(time);
+		if (idx == 0) {
 #ifdef CURVE_FALLBACK_FUNCTION
 			if (likely(this->fallback)) {
 				return this->fallback(time);
@@ -61,76 +123,376 @@ public:
 		}
 
 		// go one back, so it's less or equal the requested time.
-		--it;
-		return it->second;
+		return this->entry(idx - 1).second;
 	}
 
 	/**
 	 * Like `at`, but returns nullptr if no keyframe was found.
 	 */
 	const T *at_find(const order_t time) const {
-		auto it = this->container.upper_bound(time);
-		if (it == std::begin(this->container)) {
+		size_t idx = this->upper_index(time);
+		if (idx == 0) {
 			return nullptr;
 		}
-		--it;
-		return &it->second;
+		return &this->entry(idx - 1).second;
+	}
+
+	/**
+	 * Like `at_find`, but the found value can be modified.
+	 */
+	T *at_find(const order_t time) {
+		size_t idx = this->upper_index(time);
+		if (idx == 0) {
+			return nullptr;
+		}
+		return &this->writable_entry(idx - 1).second;
 	}
 
 	/**
 	 * Get the value at the exact time.
 	 */
 	const T *at_exact(const order_t time) const {
-		auto it = this->container.find(time);
-		if (it == std::end(this->container)) {
+		size_t idx = this->upper_index(time);
+		if (idx == 0 or this->entry(idx - 1).first != time) {
 			return nullptr;
 		}
 
-		return &it->second;
+		return &this->entry(idx - 1).second;
+	}
+
+	/**
+	 * Like `at_exact`, but the found value can be modified.
+	 */
+	T *at_exact(const order_t time) {
+		size_t idx = this->upper_index(time);
+		if (idx == 0 or this->entry(idx - 1).first != time) {
+			return nullptr;
+		}
+
+		return &this->writable_entry(idx - 1).second;
 	}
 
 	/**
 	 * Get the value which active earlier than given time.
 	 */
 	const T &before(const order_t time) const {
-		// search for element which is not less than the given time.
-		auto it = this->container.lower_bound(time);
-		if (it == std::begin(this->container)) {
+		size_t idx = this->count_before(time);
+		if (idx == 0) {
 			throw InternalError{"curve has no previous keyframe"};
 		}
 
 		// go one back, so it's less than the requested time.
-		--it;
-		return it->second;
+		return this->entry(idx - 1).second;
 	}
 
 	/**
 	 * No data is stored in the curve.
 	 */
 	bool empty() const {
-		return this->container.empty();
+		return this->entry_count == 0;
 	}
 
 	/**
 	 * Add a new value at the given time.
 	 */
 	T &insert_drop(const order_t time, T &&value) {
-		auto it = this->container.lower_bound(time);
-
 		// remove all elements greater or equal the requested time
-		this->container.erase(it, std::end(this->container));
+		if (not this->empty() and this->entry(this->entry_count - 1).first >= time) {
+			this->truncate(this->count_before(time));
+		}
 
 		// insert the new keyframe
-		auto ret = this->container.insert({time, std::move(value)});
-		if (unlikely(ret.second == false)) {
-			throw InternalError{"did not insert value, it existed before"};
+		return this->push_back(time, std::move(value));
+	}
+
+	/**
+	 * Add a new value at the given time, but keep all later values.
+	 * A value that existed at this exact time is replaced.
+	 */
+	T &insert(const order_t time, T &&value) {
+		size_t idx = this->upper_index(time);
+		if (idx > 0 and this->entry(idx - 1).first == time) {
+			T &ret = this->writable_entry(idx - 1).second;
+			ret = std::move(value);
+			return ret;
+		}
+
+		// the later entries are moved back by one.
+		std::vector<entry_t> later = this->take_from(idx);
+		this->push_back(time, std::move(value));
+		for (auto &entry : later) {
+			this->push_back(entry.first, std::move(entry.second));
 		}
 
-		return ret.first->second;
+		return this->writable_entry(idx).second;
+	}
+
+	/**
+	 * Remove all values later than the given time.
+	 */
+	void drop_after(const order_t time) {
+		if (this->has_after(time)) {
+			this->truncate(this->upper_index(time));
+		}
+	}
+
+	/**
+	 * Call the function for each stored value, in increasing time order.
+	 */
+	template<typename F>
+	void for_each(F &&func) const {
+		for (auto &chunk : this->chunks) {
+			for (auto &entry : *chunk) {
+				func(entry.first, entry.second);
+			}
+		}
+	}
+
+	/**
+	 * Call the function for each value stored later than the given time,
+	 * in increasing time order.
+	 */
+	template<typename F>
+	void for_each_after(const order_t time, F &&func) const {
+		if (not this->has_after(time)) {
+			return;
+		}
+
+		for (size_t idx = this->upper_index(time); idx < this->entry_count; idx++) {
+			const entry_t &entry = this->entry(idx);
+			func(entry.first, entry.second);
+		}
+	}
+
+	/**
+	 * Call the function for each value stored earlier than the given time,
+	 * in increasing time order.
+	 */
+	template<typename F>
+	void for_each_before(const order_t time, F &&func) const {
+		size_t count = this->count_before(time);
+		for (size_t idx = 0; idx < count; idx++) {
+			const entry_t &entry = this->entry(idx);
+			func(entry.first, entry.second);
+		}
+	}
+
+	/**
+	 * Remove all values earlier than the given time.
+	 * The function is called for each removed value.
+	 */
+	template<typename F>
+	void drop_before(const order_t time, F &&dropped) {
+		size_t count = this->count_before(time);
+		if (count == 0) {
+			return;
+		}
+
+		// all kept entries move to the front, so all chunks are rebuilt.
+		std::vector<entry_t> entries = this->take_from(0);
+		for (size_t idx = 0; idx < count; idx++) {
+			dropped(entries[idx].second);
+		}
+
+		for (size_t idx = count; idx < entries.size(); idx++) {
+			this->push_back(entries[idx].first, std::move(entries[idx].second));
+		}
+	}
+
+	/**
+	 * Replace all values earlier than the given time by the latest of them,
+	 * which is then stored at the base time.
+	 * The base time must be earlier than the given time.
+	 * The function is called for each removed value.
+	 */
+	template<typename F>
+	void compact_before(const order_t time, const order_t base, F &&dropped) {
+		size_t count = this->count_before(time);
+		if (count == 0) {
+			return;
+		}
+
+		if (count > 1) {
+			std::vector<entry_t> entries = this->take_from(0);
+			for (size_t idx = 0; idx < count - 1; idx++) {
+				dropped(entries[idx].second);
+			}
+
+			for (size_t idx = count - 1; idx < entries.size(); idx++) {
+				this->push_back(entries[idx].first, std::move(entries[idx].second));
+			}
+		}
+
+		this->writable_entry(0).first = base;
+	}
+
+	/**
+	 * Check if there is a value stored later than the given time.
+	 */
+	bool has_after(const order_t time) const {
+		return (not this->empty()
+		        and this->entry(this->entry_count - 1).first > time);
 	}
 
 protected:
-	container_t container;
+	/**
+	 * Number of keyframes in a chunk.
+	 * All chunks but the last one are full.
+	 */
+	static constexpr size_t chunk_size = 32;
+
+	using chunk_t = std::vector<entry_t>;
+
+	/**
+	 * Return the keyframe at the given index.
+	 */
+	const entry_t &entry(size_t idx) const {
+		return (*this->chunks[idx / chunk_size])[idx % chunk_size];
+	}
+
+	/**
+	 * Return the keyframe at the given index so it can be modified.
+	 * Its chunk is copied first if another curve shares it.
+	 */
+	entry_t &writable_entry(size_t idx) {
+		return unshare(this->chunks[idx / chunk_size])[idx % chunk_size];
+	}
+
+	/**
+	 * Make the given chunk writable.
+	 * If it is shared with other curves, it is replaced by a copy.
+	 */
+	static chunk_t &unshare(std::shared_ptr<chunk_t> &chunk) {
+		if (chunk.use_count() > 1) {
+			auto copy = std::make_shared<chunk_t>();
+			copy->reserve(chunk_size);
+			copy->insert(std::end(*copy), std::begin(*chunk), std::end(*chunk));
+			chunk = std::move(copy);
+		}
+		return *chunk;
+	}
+
+	/**
+	 * Append a keyframe, which must be later than all others.
+	 */
+	T &push_back(const order_t time, T &&value) {
+		if (this->entry_count % chunk_size == 0) {
+			auto chunk = std::make_shared<chunk_t>();
+			chunk->reserve(chunk_size);
+			this->chunks.push_back(std::move(chunk));
+		}
+
+		chunk_t &last = unshare(this->chunks.back());
+		last.emplace_back(time, std::move(value));
+		this->entry_count += 1;
+		return last.back().second;
+	}
+
+	/**
+	 * Remove all keyframes from the given index on.
+	 */
+	void truncate(size_t count) {
+		if (count >= this->entry_count) {
+			return;
+		}
+
+		this->chunks.resize((count + chunk_size - 1) / chunk_size);
+
+		size_t rest = count % chunk_size;
+		if (rest != 0) {
+			chunk_t &last = unshare(this->chunks.back());
+			last.erase(std::begin(last) + rest, std::end(last));
+		}
+
+		this->entry_count = count;
+	}
+
+	/**
+	 * Remove the keyframes from the given index on and return them.
+	 * They are moved out of the chunks no other curve shares.
+	 */
+	std::vector<entry_t> take_from(size_t idx) {
+		std::vector<entry_t> ret;
+		ret.reserve(this->entry_count - idx);
+
+		for (size_t i = idx; i < this->entry_count; i++) {
+			std::shared_ptr<chunk_t> &chunk = this->chunks[i / chunk_size];
+			if (chunk.use_count() > 1) {
+				ret.push_back((*chunk)[i % chunk_size]);
+			}
+			else {
+				ret.push_back(std::move((*chunk)[i % chunk_size]));
+			}
+		}
+
+		this->truncate(idx);
+		return ret;
+	}
+
+	/**
+	 * Return the number of keyframes earlier than the given time.
+	 */
+	size_t count_before(const order_t time) const {
+		return (time == 0) ? 0 : this->upper_index(time - 1);
+	}
+
+	/**
+	 * Return the number of keyframes at or before the given time,
+	 * i.e. the index of the first keyframe later than the time.
+	 *
+	 * The result of the previous lookup is checked first,
+	 * then its successor, so queries with the same or slowly increasing
+	 * times don't need a binary search.
+	 */
+	size_t upper_index(const order_t time) const {
+		const size_t size = this->entry_count;
+		size_t hint = this->cursor.load(std::memory_order_relaxed);
+
+		for (size_t i = 0; i < 2 and hint < size; i++, hint++) {
+			if (this->entry(hint).first > time) {
+				break;
+			}
+			if (hint + 1 == size or this->entry(hint + 1).first > time) {
+				this->cursor.store(hint, std::memory_order_relaxed);
+				return hint + 1;
+			}
+		}
+
+		// first keyframe later than the time.
+		size_t begin = 0;
+		size_t end = size;
+		while (begin < end) {
+			size_t mid = begin + (end - begin) / 2;
+			if (this->entry(mid).first > time) {
+				end = mid;
+			}
+			else {
+				begin = mid + 1;
+			}
+		}
+
+		if (begin > 0) {
+			this->cursor.store(begin - 1, std::memory_order_relaxed);
+		}
+		return begin;
+	}
+
+	/**
+	 * Keyframes, in chunks of chunk_size.
+	 * Chunks shared with other curves are not modified.
+	 */
+	std::vector<std::shared_ptr<chunk_t>> chunks;
+
+	/**
+	 * Number of stored keyframes.
+	 */
+	size_t entry_count = 0;
+
+	/**
+	 * Index of the keyframe found by the last lookup.
+	 * Only a hint, it is validated before use.
+	 */
+	mutable std::atomic<size_t> cursor{0};
 };
 
 } // namespace nyan
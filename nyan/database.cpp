@@ -2,9 +2,14 @@
 
 #include "database.h"
 
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <future>
+#include <map>
 #include <memory>
 #include <unordered_map>
-#include <queue>
+#include <unordered_set>
 
 #include "c3.h"
 #include "compiler.h"
@@ -14,9 +19,12 @@
 #include "object_state.h"
 #include "parser.h"
 #include "patch_info.h"
+#include "patch_plan.h"
+#include "snapshot.h"
 #include "state.h"
 #include "util.h"
 #include "view.h"
+#include "worker_pool.h"
 
 
 namespace nyan {
@@ -79,86 +87,157 @@ static void ast_obj_walk(const namespace_lookup_t &imports,
 
 
 void Database::load(const std::string &filename,
-                    const filefetcher_t &filefetcher) {
-
-	Parser parser;
+                    const filefetcher_t &filefetcher,
+                    size_t max_jobs) {
 
 	// tracking of imported namespaces (with aliases)
 	namespace_lookup_t imports;
 
-	// namespaces to which were requested to be imported
-	// the location is the first request origin.
-	std::unordered_map<Namespace, Location> to_import;
-
-	// push the first namespace to import
-	to_import.insert(
-		{
-			Namespace::from_filename(filename),
-			Location{" -> requested by native call to Database::load()"}
-		}
-	);
+	// all namespaces which were requested to be imported
+	std::unordered_set<Namespace> requested;
+
+	/**
+	 * A namespace whose file is fetched and parsed.
+	 */
+	struct pending_import {
+		/** namespace to import */
+		Namespace ns;
+
+		/** the first request origin */
+		Location location;
+
+		/** the parsed file, invalid until the parsing is started */
+		std::future<AST> ast;
+
+		/** the fetched file, set by the parsing once the ast is ready */
+		std::shared_ptr<File> file;
+	};
+
+	// imports which are not processed yet, in request order.
+	// the results are processed in this order, so the database
+	// content does not depend on the parsing speed of each file.
+	std::deque<pending_import> pending;
+
+	// the first imports are fetched and parsed in parallel
+	// while we process the results in order.
+	// with one job, files are parsed when their result is needed.
+	const size_t job_count = std::max<size_t>(max_jobs, 1);
+	std::unique_ptr<WorkerPool> workers;
+	if (job_count > 1) {
+		workers = std::make_unique<WorkerPool>(job_count);
+	}
 
-	while (to_import.size() > 0) {
-		auto cur_ns_it = to_import.begin();
-		const Namespace &namespace_to_import = cur_ns_it->first;
-		const Location &req_location = cur_ns_it->second;
+	auto start_parsing = [&filefetcher, &pending, &workers, job_count] () {
+		size_t jobs = 0;
+		for (auto &entry : pending) {
+			if (jobs >= job_count) {
+				break;
+			}
 
-		auto it = imports.find(namespace_to_import);
-		if (it != std::end(imports)) {
-			// this namespace is already imported!
-			continue;
-		}
+			if (not entry.ast.valid()) {
+				// deque elements stay in place, so the file can be stored.
+				auto parse = [&filefetcher, &file=entry.file, file_name=entry.ns.to_filename()] () {
+					// get the data and parse the file
+					file = filefetcher(file_name);
+					Parser parser;
+					return parser.parse(file);
+				};
 
-		std::shared_ptr<File> current_file;
-		try {
-			// get the data and parse the file
-			current_file = filefetcher(
-				namespace_to_import.to_filename()
-			);
-		}
-		catch (FileReadError &err) {
-			// the import request failed,
-			// so the nyan file structure or content is wrong.
-			throw LangError{req_location, err.str()};
+				if (workers) {
+					entry.ast = workers->submit(std::move(parse));
+				}
+				else {
+					entry.ast = std::async(std::launch::deferred, std::move(parse));
+				}
+			}
+			jobs += 1;
 		}
+	};
 
-		// create import tracking entry for this file
-		// and parse the file contents!
-		NamespaceFinder &new_ns = imports.insert({
-			namespace_to_import,                         // name of the import
-			NamespaceFinder{
-				parser.parse(current_file)  // read the ast!
+	// push the first namespace to import
+	Namespace first_ns = Namespace::from_filename(filename);
+	requested.insert(first_ns);
+	pending.push_back({
+		std::move(first_ns),
+		Location{" -> requested by native call to Database::load()"},
+		{},
+		{}
+	});
+
+	try {
+		while (pending.size() > 0) {
+			start_parsing();
+
+			pending_import &current = pending.front();
+
+			// create import tracking entry for this file
+			// and get the parsed file contents!
+			NamespaceFinder *new_ns_ptr;
+			try {
+				new_ns_ptr = &imports.insert({
+					current.ns,                          // name of the import
+					NamespaceFinder{
+						current.ast.get()            // read the ast!
+					}
+				}).first->second;
+			}
+			catch (FileReadError &err) {
+				// the import request failed,
+				// so the nyan file structure or content is wrong.
+				throw LangError{current.location, err.str()};
 			}
-		}).first->second;
 
-		// enqueue all new imports of this file
-		// and record import aliases
-		for (auto &import : new_ns.get_ast().get_imports()) {
-			Namespace request{import.get()};
+			NamespaceFinder &new_ns = *new_ns_ptr;
 
-			// either register the alias
-			if (import.has_alias()) {
-				new_ns.add_alias(import.get_alias(), request);
-			}
-			// or the plain import
-			else {
-				new_ns.add_import(request);
-			}
+			this->files.push_back({current.ns.to_filename(), current.file});
+
+			// enqueue all new imports of this file
+			// and record import aliases
+			for (auto &import : new_ns.get_ast().get_imports()) {
+				Namespace request{import.get()};
 
-			// check if this import was already requested or is known.
-			// todo: also check if that ns is already fully loaded in the db
-			auto was_imported = imports.find(request);
-			auto import_requested = to_import.find(request);
+				// either register the alias
+				if (import.has_alias()) {
+					new_ns.add_alias(import.get_alias(), request);
+				}
+				// or the plain import
+				else {
+					new_ns.add_import(request);
+				}
 
-			if (was_imported == std::end(imports) and
-			    import_requested == std::end(to_import)) {
+				// check if this import was already requested or is known.
+				// todo: also check if that ns is already fully loaded in the db
+				if (requested.find(request) == std::end(requested)) {
 
-				// add the request to the pending imports
-				to_import.insert({std::move(request), import.get()});
+					// add the request to the pending imports
+					requested.insert(request);
+					pending.push_back({std::move(request), import.get(), {}, {}});
+				}
 			}
-		}
 
-		to_import.erase(cur_ns_it);
+			pending.pop_front();
+		}
+	}
+	catch (...) {
+		// the error of the first failed file in request order is reported.
+		// the running jobs write to the pending entries, so all of them
+		// are finished and their results are consumed before the entries
+		// are destroyed. deferred parsing is never started here.
+		if (workers) {
+			workers->cancel();
+
+			for (auto &entry : pending) {
+				if (entry.ast.valid()) {
+					try {
+						entry.ast.get();
+					}
+					catch (...) {
+						// only the first error is rethrown.
+					}
+				}
+			}
+		}
+		throw;
 	}
 
 
@@ -171,11 +250,11 @@ void Database::load(const std::string &filename,
 	                                this, &new_obj_count,
 	                                _1, _2, _3, _4));
 
-	std::vector<fqon_t> new_objects;
+	std::vector<obj_id_t> new_objects;
 	new_objects.reserve(new_obj_count);
 
 	// map object => new children.
-	std::unordered_map<fqon_t, std::unordered_set<fqon_t>> obj_children;
+	std::unordered_map<obj_id_t, std::unordered_set<obj_id_t>> obj_children;
 
 	// now, all new object infos need to be filled with types
 	ast_obj_walk(imports, std::bind(&Database::create_obj_content,
@@ -187,11 +266,14 @@ void Database::load(const std::string &filename,
 	// linearize the parents of all new objects
 	this->linearize_new(new_objects);
 
+	// find storage slots for the new members
+	this->assign_member_slots(new_objects);
+
 	// resolve the types of members to their definition
 	this->resolve_types(new_objects);
 
 	// these objects were uses as values at some file location.
-	std::vector<std::pair<fqon_t, Location>> objs_in_values;
+	std::vector<std::pair<obj_id_t, Location>> objs_in_values;
 
 	// state value creation
 	ast_obj_walk(imports, std::bind(&Database::create_obj_state,
@@ -214,10 +296,77 @@ void Database::load(const std::string &filename,
 		info->set_children(std::move(children));
 	}
 
+	// the new objects are descendants of existing ones.
+	this->index_descendants();
+	this->index_ancestries();
+
+	// the new patches may target the objects of existing patches.
+	this->compile_patch_plans();
+
 	// TODO: check pending objectvalues (probably not needed as they're all loaded)
 }
 
 
+bool Database::load_snapshot(const std::string &filename,
+                             const filefetcher_t &filefetcher) {
+
+	if (unlikely(this->files.size() > 0 or
+	             this->meta_info.get_objects().size() > 0)) {
+		throw InternalError{"snapshots can only be loaded into an empty database"};
+	}
+
+	std::shared_ptr<File> snapshot;
+	try {
+		snapshot = std::make_shared<File>(filename);
+	}
+	catch (FileReadError &) {
+		// no snapshot was created yet.
+		return false;
+	}
+
+	bool restored = Snapshot::restore(
+		snapshot->get_content(),
+		filefetcher,
+		this->files,
+		this->meta_info,
+		*this->state
+	);
+
+	if (not restored) {
+		return false;
+	}
+
+	try {
+		this->index_descendants();
+		this->index_ancestries();
+		this->compile_patch_plans();
+	}
+	catch (Error &) {
+		// the snapshot content is inconsistent,
+		// so the database is empty again and the files have to be loaded.
+		this->files.clear();
+		this->meta_info = MetaInfo{};
+		this->state = std::make_shared<State>();
+		return false;
+	}
+
+	return true;
+}
+
+
+void Database::store_snapshot(const std::string &filename) const {
+	std::string data = Snapshot::create(this->files, this->meta_info, *this->state);
+
+	std::ofstream output{filename, std::ofstream::out | std::ofstream::binary};
+	output.write(data.data(), static_cast<std::streamsize>(data.size()));
+	output.close();
+
+	if (not output) {
+		throw Error{"failed writing snapshot file '" + filename + "'"};
+	}
+}
+
+
 void Database::create_obj_info(size_t *counter,
                                const NamespaceFinder &current_file,
                                const Namespace &,
@@ -245,17 +394,17 @@ void Database::create_obj_info(size_t *counter,
 }
 
 
-void Database::create_obj_content(std::vector<fqon_t> *new_objs,
-                                  std::unordered_map<fqon_t, std::unordered_set<fqon_t>> *child_assignments,
+void Database::create_obj_content(std::vector<obj_id_t> *new_objs,
+                                  std::unordered_map<obj_id_t, std::unordered_set<obj_id_t>> *child_assignments,
                                   const NamespaceFinder &scope,
                                   const Namespace &ns,
                                   const Namespace &objname,
                                   const ASTObject &astobj) {
 
-	fqon_t obj_fqon = objname.to_fqon();
-	new_objs->push_back(obj_fqon);
+	obj_id_t obj_id = this->get_object_id(objname.to_fqon());
+	new_objs->push_back(obj_id);
 
-	ObjectInfo *info = this->meta_info.get_object(obj_fqon);
+	ObjectInfo *info = this->meta_info.get_object(obj_id);
 	if (unlikely(info == nullptr)) {
 		throw InternalError{"object info could not be retrieved"};
 	}
@@ -263,35 +412,41 @@ void Database::create_obj_content(std::vector<fqon_t> *new_objs,
 	// save the patch target, has to be alias-expanded
 	const IDToken &target = astobj.target;
 	if (target.exists()) {
-		fqon_t target_id = scope.find(ns, target, this->meta_info);
-		info->add_patch(std::make_shared<PatchInfo>(std::move(target_id)), true);
+		obj_id_t target_id = this->get_object_id(
+			scope.find(ns, target, this->meta_info)
+		);
+		info->add_patch(std::make_shared<PatchInfo>(target_id), true);
 	}
 
 	// a patch may add inheritance parents
 	for (auto &change : astobj.inheritance_change) {
 		inher_change_t change_type = change.get_type();
-		fqon_t new_parent_id = scope.find(ns, change.get_target(), this->meta_info);
-		info->add_inheritance_change(InheritanceChange{change_type, std::move(new_parent_id)});
+		obj_id_t new_parent_id = this->get_object_id(
+			scope.find(ns, change.get_target(), this->meta_info)
+		);
+		info->add_inheritance_change(InheritanceChange{change_type, new_parent_id});
 	}
 
 	// parents are stored in the object data state
-	std::deque<fqon_t> object_parents;
+	std::deque<obj_id_t> object_parents;
 	for (auto &parent : astobj.parents) {
-		fqon_t parent_id = scope.find(ns, parent, this->meta_info);
+		obj_id_t parent_id = this->get_object_id(
+			scope.find(ns, parent, this->meta_info)
+		);
 
 		// this object is therefore a child of the parent one.
 		auto ins = child_assignments->emplace(
 			parent_id,
-			std::unordered_set<fqon_t>{}
+			std::unordered_set<obj_id_t>{}
 		);
-		ins.first->second.insert(obj_fqon);
+		ins.first->second.insert(obj_id);
 
-		object_parents.push_back(std::move(parent_id));
+		object_parents.push_back(parent_id);
 	}
 
 	// fill initial state:
 	this->state->add_object(
-		obj_fqon,
+		obj_id,
 		std::make_shared<ObjectState>(
 			std::move(object_parents)
 		)
@@ -304,7 +459,7 @@ void Database::create_obj_content(std::vector<fqon_t> *new_objs,
 		//       for conflict resolving
 
 		MemberInfo &member_info = info->add_member(
-			astmember.name.str(),
+			this->meta_info.get_symbols().add_member(astmember.name.str()),
 			MemberInfo{astmember.name}
 		);
 
@@ -326,35 +481,212 @@ void Database::create_obj_content(std::vector<fqon_t> *new_objs,
 }
 
 
-void Database::linearize_new(const std::vector<fqon_t> &new_objects) {
-	// linearize the parents of all newly created objects
+obj_id_t Database::get_object_id(const fqon_t &name) const {
+	const obj_id_t *id = this->meta_info.get_object_id(name);
+	if (unlikely(id == nullptr)) {
+		throw InternalError{"object id could not be retrieved"};
+	}
+	return *id;
+}
+
+
+const MemberKey &Database::get_member_key(member_id_t member) const {
+	const MemberKey *key = this->meta_info.get_member_key(member);
+	if (unlikely(key == nullptr)) {
+		throw InternalError{"member has no storage slot"};
+	}
+	return *key;
+}
 
-	for (auto &obj : new_objects) {
-		std::unordered_set<fqon_t> seen;
 
+void Database::linearize_new(const std::vector<obj_id_t> &new_objects) {
+	// linearize the parents of all newly created objects.
+	// parents are linearized before their children,
+	// so the linearizations stored in the object infos
+	// are reused and each object is only linearized once.
+
+	auto get_info = [this] (obj_id_t obj) -> ObjectInfo & {
 		ObjectInfo *obj_info = this->meta_info.get_object(obj);
 		if (unlikely(obj_info == nullptr)) {
 			throw InternalError{"object information not retrieved"};
 		}
+		return *obj_info;
+	};
 
-		obj_info->set_linearization(
-			linearize_recurse(
-				obj,
-				[this] (const fqon_t &name) -> const ObjectState & {
-					return **this->state->get(name);
-				},
-				&seen
-			)
+	for (auto &obj : new_objects) {
+		linearize_cached(
+			obj,
+			[this] (obj_id_t parent) -> const ObjectState & {
+				return **this->state->get(parent);
+			},
+			[&get_info] (obj_id_t parent) -> const std::vector<obj_id_t> * {
+				// a linearization always contains the object itself,
+				// so it's empty only if it wasn't calculated yet.
+				const auto &lin = get_info(parent).get_linearization();
+				if (lin.empty()) {
+					return nullptr;
+				}
+				return &lin;
+			},
+			[&get_info] (obj_id_t parent, std::vector<obj_id_t> &&lin)
+			-> const std::vector<obj_id_t> & {
+				ObjectInfo &parent_info = get_info(parent);
+				parent_info.set_linearization(std::move(lin));
+				return parent_info.get_linearization();
+			},
+			this->meta_info.get_symbols()
 		);
 	}
 }
 
 
+void Database::compile_patch_plans() {
+	const size_t obj_count = this->meta_info.get_objects().size();
+
+	// objects that are patched can change in a view.
+	std::unordered_set<obj_id_t> targets;
+	for (obj_id_t obj = 0; obj < obj_count; obj++) {
+		const ObjectInfo *obj_info = this->meta_info.get_object(obj);
+		if (unlikely(obj_info == nullptr)) {
+			throw InternalError{"object information not retrieved"};
+		}
+
+		if (obj_info->is_patch()) {
+			targets.insert(obj_info->get_patch()->get_target());
+		}
+	}
+
+	for (obj_id_t obj = 0; obj < obj_count; obj++) {
+		ObjectInfo *obj_info = this->meta_info.get_object(obj);
+		if (unlikely(obj_info == nullptr)) {
+			throw InternalError{"object information not retrieved"};
+		}
+
+		if (not obj_info->is_patch()) {
+			continue;
+		}
+
+		// the linearization contains all objects the patch depends on.
+		const auto &linearization = obj_info->get_linearization();
+
+		bool can_change = false;
+		for (auto &parent : linearization) {
+			if (targets.find(parent) != std::end(targets)) {
+				can_change = true;
+				break;
+			}
+		}
+
+		if (can_change) {
+			obj_info->set_patch_plan(nullptr);
+			continue;
+		}
+
+		auto plan = std::make_shared<PatchPlan>();
+		for (auto &parent : linearization) {
+			const std::shared_ptr<ObjectState> *parent_state = this->state->get(parent);
+			if (unlikely(parent_state == nullptr)) {
+				throw InternalError{"patch parent has no initial state"};
+			}
+
+			const ObjectInfo *parent_info = this->meta_info.get_object(parent);
+			if (unlikely(parent_info == nullptr)) {
+				throw InternalError{"object information not retrieved"};
+			}
+			plan->add_object(*parent_info, **parent_state);
+		}
+
+		obj_info->set_patch_plan(std::move(plan));
+	}
+}
+
+
+void Database::assign_member_slots(const std::vector<obj_id_t> &new_objects) {
+	// object => members that can be stored in its state:
+	// its own members and all members of patches that target it.
+	std::unordered_map<obj_id_t, std::unordered_set<member_id_t>> stored_members;
+
+	auto add_members = [this, &stored_members] (obj_id_t target, obj_id_t obj) {
+		const ObjectInfo *obj_info = this->meta_info.get_object(obj);
+		if (unlikely(obj_info == nullptr)) {
+			throw InternalError{"object information not retrieved"};
+		}
+
+		auto &target_members = stored_members[target];
+		for (auto &it : obj_info->get_members()) {
+			target_members.insert(it.first);
+		}
+	};
+
+	for (auto &obj : new_objects) {
+		add_members(obj, obj);
+
+		const ObjectInfo *obj_info = this->meta_info.get_object(obj);
+		const auto &linearization = obj_info->get_linearization();
+
+		// the patch target is declared by the object itself
+		// or by the first patch in the linearization.
+		const PatchInfo *patch_info = nullptr;
+		for (auto &parent : linearization) {
+			const ObjectInfo *parent_info = this->meta_info.get_object(parent);
+			if (parent_info->is_initial_patch()) {
+				patch_info = parent_info->get_patch().get();
+				break;
+			}
+		}
+
+		if (patch_info == nullptr) {
+			continue;
+		}
+
+		// each object of the patch linearization is applied to the target
+		obj_id_t target = patch_info->get_target();
+		add_members(target, target);
+		for (auto &parent : linearization) {
+			add_members(target, parent);
+		}
+	}
+
+	// member => other members stored together with it.
+	// ordered so the slot assignment is deterministic.
+	std::map<member_id_t, std::unordered_set<member_id_t>> conflicts;
+
+	for (auto &it : stored_members) {
+		auto &members = it.second;
+		for (auto &member : members) {
+			if (this->meta_info.get_member_key(member) == nullptr) {
+				conflicts[member].insert(std::begin(members), std::end(members));
+			}
+		}
+	}
+
+	// greedy coloring: take the lowest slot that no conflicting
+	// member has. the members already assigned keep their slots.
+	for (auto &it : conflicts) {
+		std::unordered_set<member_slot_t> used_slots;
+
+		for (auto &other : it.second) {
+			const MemberKey *other_key = this->meta_info.get_member_key(other);
+			if (other_key != nullptr) {
+				used_slots.insert(other_key->get_slot());
+			}
+		}
+
+		member_slot_t slot = 0;
+		while (used_slots.find(slot) != std::end(used_slots)) {
+			slot += 1;
+		}
+
+		this->meta_info.add_member_key(it.first, slot);
+	}
+}
+
+
 void Database::find_member(bool skip_first,
-                           const memberid_t &member_id,
-                           const std::vector<fqon_t> &search_objs,
+                           const MemberKey &member_key,
+                           const std::vector<obj_id_t> &search_objs,
                            const ObjectInfo &obj_info,
-                           const std::function<bool(const fqon_t &,
+                           const std::function<bool(obj_id_t,
                                                     const MemberInfo &,
                                                     const Member *)> &member_found) {
 
@@ -374,7 +706,7 @@ void Database::find_member(bool skip_first,
 		if (unlikely(obj_info == nullptr)) {
 			throw InternalError{"object information not retrieved"};
 		}
-		const MemberInfo *obj_member_info = obj_info->get_member(member_id);
+		const MemberInfo *obj_member_info = obj_info->get_member(member_key.get_id());
 
 		// obj doesn't have this member
 		if (not obj_member_info) {
@@ -385,7 +717,7 @@ void Database::find_member(bool skip_first,
 		if (unlikely(par_state == nullptr)) {
 			throw InternalError{"object state not retrieved"};
 		}
-		const Member *member = par_state->get(member_id);
+		const Member *member = par_state->get(member_key);
 
 		finished = member_found(obj, *obj_member_info, member);
 
@@ -396,7 +728,7 @@ void Database::find_member(bool skip_first,
 
 	// recurse into the patch target
 	if (not finished and obj_info.is_patch()) {
-		const fqon_t &target = obj_info.get_patch()->get_target();
+		obj_id_t target = obj_info.get_patch()->get_target();
 		const ObjectInfo *obj_info = this->meta_info.get_object(target);
 		if (unlikely(obj_info == nullptr)) {
 			throw InternalError{"target not found in metainfo"};
@@ -405,14 +737,14 @@ void Database::find_member(bool skip_first,
 		// recurse into the target.
 		// check if the patch defines the member as well -> error.
 		// otherwise, infer type from patch.
-		this->find_member(false, member_id,
+		this->find_member(false, member_key,
 		                  obj_info->get_linearization(),
 		                  *obj_info, member_found);
 	}
 }
 
 
-void Database::resolve_types(const std::vector<fqon_t> &new_objects) {
+void Database::resolve_types(const std::vector<obj_id_t> &new_objects) {
 
 	using namespace std::string_literals;
 
@@ -465,7 +797,7 @@ void Database::resolve_types(const std::vector<fqon_t> &new_objects) {
 
 		// resolve the type for each member
 		for (auto &it : obj_info->get_members()) {
-			const memberid_t &member_id = it.first;
+			member_id_t member_id = it.first;
 			MemberInfo &member_info = it.second;
 
 			// if the member already defines it, we found it already.
@@ -476,9 +808,9 @@ void Database::resolve_types(const std::vector<fqon_t> &new_objects) {
 			// which includes the recursion into patch targets.
 			this->find_member(
 				true,  // make sure the object we search the type for isn't checked with itself.
-				member_id, linearization, *obj_info,
-				[&member_info, &type_found, &member_id]
-				(const fqon_t &parent,
+				this->get_member_key(member_id), linearization, *obj_info,
+				[this, &member_info, &type_found, &member_id]
+				(obj_id_t parent,
 				 const MemberInfo &source_member_info,
 				 const Member *) {
 
@@ -494,11 +826,14 @@ void Database::resolve_types(const std::vector<fqon_t> &new_objects) {
 							// another parent defines this type,
 							// which is disallowed!
 
+							const SymbolTable &symbols = this->meta_info.get_symbols();
+
 							// TODO: show location of infringing type instead of member
 							throw LangError{
 								member_info.get_location(),
-								("parent '"s + parent
-								 + "' already defines type of '" + member_id + "'"),
+								("parent '"s + symbols.get_object_name(parent)
+								 + "' already defines type of '"
+								 + symbols.get_member_name(member_id) + "'"),
 								{{source_member_info.get_location(), "parent that declares the member"}}
 							};
 						}
@@ -517,7 +852,8 @@ void Database::resolve_types(const std::vector<fqon_t> &new_objects) {
 			if (unlikely(not type_found)) {
 				throw TypeError{
 					member_info.get_location(),
-					"could not infer type of '"s + member_id
+					"could not infer type of '"s
+					+ this->meta_info.get_symbols().get_member_name(member_id)
 					+ "' from parents or patch target"
 				};
 			}
@@ -526,7 +862,7 @@ void Database::resolve_types(const std::vector<fqon_t> &new_objects) {
 }
 
 
-void Database::create_obj_state(std::vector<std::pair<fqon_t, Location>> *objs_in_values,
+void Database::create_obj_state(std::vector<std::pair<obj_id_t, Location>> *objs_in_values,
                                 const NamespaceFinder &scope,
                                 const Namespace &,
                                 const Namespace &objname,
@@ -539,14 +875,14 @@ void Database::create_obj_state(std::vector<std::pair<fqon_t, Location>> *objs_i
 		return;
 	}
 
-	ObjectInfo *info = this->meta_info.get_object(objname.to_fqon());
+	obj_id_t obj_id = this->get_object_id(objname.to_fqon());
+
+	ObjectInfo *info = this->meta_info.get_object(obj_id);
 	if (unlikely(info == nullptr)) {
 		throw InternalError{"object info could not be retrieved"};
 	}
 
-	ObjectState &objstate = **this->state->get(objname.to_fqon());
-
-	std::unordered_map<memberid_t, Member> members;
+	ObjectState &objstate = **this->state->get(obj_id);
 
 	// create member values
 	for (auto &astmember : astobj.members) {
@@ -557,9 +893,12 @@ void Database::create_obj_state(std::vector<std::pair<fqon_t, Location>> *objs_i
 		}
 
 		// TODO: the member name may need some resolution for conflicts
-		const memberid_t &memberid = astmember.name.str();
+		const member_id_t *memberid = this->meta_info.get_symbols().get_member_id(astmember.name.str());
+		if (unlikely(memberid == nullptr)) {
+			throw InternalError{"member id could not be retrieved"};
+		}
 
-		const MemberInfo *member_info = info->get_member(memberid);
+		const MemberInfo *member_info = info->get_member(*memberid);
 		if (unlikely(member_info == nullptr)) {
 			throw InternalError{"member info could not be retrieved"};
 		}
@@ -577,8 +916,8 @@ void Database::create_obj_state(std::vector<std::pair<fqon_t, Location>> *objs_i
 		}
 
 		// create the member with operation and value
-		Member &new_member = members.emplace(
-			memberid,
+		Member &new_member = objstate.add_member(
+			this->get_member_key(*memberid),
 			Member{
 				0,          // TODO: get override depth from AST (the @-count)
 				operation,
@@ -590,7 +929,8 @@ void Database::create_obj_state(std::vector<std::pair<fqon_t, Location>> *objs_i
 					 const IDToken &token) -> fqon_t {
 
 						// find the desired object in the scope of the object
-						fqon_t obj_id = scope.find(objname, token, this->meta_info);
+						fqon_t obj_name = scope.find(objname, token, this->meta_info);
+						obj_id_t obj_id = this->get_object_id(obj_name);
 
 						ObjectInfo *obj_info = this->meta_info.get_object(obj_id);
 						if (unlikely(obj_info == nullptr)) {
@@ -598,14 +938,15 @@ void Database::create_obj_state(std::vector<std::pair<fqon_t, Location>> *objs_i
 						}
 
 						const auto &obj_lin = obj_info->get_linearization();
+						obj_id_t type_id = this->get_object_id(target_type.get_target());
 
 						// check if the type of the value is okay
 						// (i.e. it's in the linearization)
-						if (unlikely(not util::contains(obj_lin, target_type.get_target()))) {
+						if (unlikely(not util::contains(obj_lin, type_id))) {
 
 							throw TypeError{
 								token,
-								"value (resolved as "s + obj_id
+								"value (resolved as "s + obj_name
 								+ ") does not match type " + target_type.get_target()
 							};
 						}
@@ -613,11 +954,11 @@ void Database::create_obj_state(std::vector<std::pair<fqon_t, Location>> *objs_i
 						// remember to check if this object can be used as value
 						objs_in_values->push_back({obj_id, Location{token}});
 
-						return obj_id;
+						return obj_name;
 					}
 				)
 			}
-		).first->second;
+		);
 
 		// let the value determine if it can work together
 		// with the member type.
@@ -654,12 +995,11 @@ void Database::create_obj_state(std::vector<std::pair<fqon_t, Location>> *objs_i
 		}
 	}
 
-	objstate.set_members(std::move(members));
 }
 
 
-void Database::check_hierarchy(const std::vector<fqon_t> &new_objs,
-                               const std::vector<std::pair<fqon_t, Location>> &objs_in_values) {
+void Database::check_hierarchy(const std::vector<obj_id_t> &new_objs,
+                               const std::vector<std::pair<obj_id_t, Location>> &objs_in_values) {
 	using namespace std::string_literals;
 
 	for (auto &obj : new_objs) {
@@ -691,9 +1031,9 @@ void Database::check_hierarchy(const std::vector<fqon_t> &new_objs,
 			bool other_op = false;
 
 			this->find_member(
-				false, it.first, linearization, *obj_info,
+				false, it.second.first, linearization, *obj_info,
 				[&assign_ok, &other_op]
-				(const fqon_t &,
+				(obj_id_t,
 				 const MemberInfo &,
 				 const Member *member) {
 					// member has no value
@@ -718,7 +1058,7 @@ void Database::check_hierarchy(const std::vector<fqon_t> &new_objs,
 			);
 
 			if (unlikely(other_op and not assign_ok)) {
-				const MemberInfo *member_info = obj_info->get_member(it.first);
+				const MemberInfo *member_info = obj_info->get_member(it.second.first.get_id());
 				throw LangError{
 					member_info->get_location(),
 					"this member was never assigned a value."
@@ -731,10 +1071,10 @@ void Database::check_hierarchy(const std::vector<fqon_t> &new_objs,
 	}
 
 
-	std::unordered_set<fqon_t> obj_values_ok;
+	std::unordered_set<obj_id_t> obj_values_ok;
 
 	for (auto &it : objs_in_values) {
-		const fqon_t &obj_id = it.first;
+		obj_id_t obj_id = it.first;
 
 		if (obj_values_ok.find(obj_id) != std::end(obj_values_ok)) {
 			// the object is non-abstract.
@@ -747,7 +1087,7 @@ void Database::check_hierarchy(const std::vector<fqon_t> &new_objs,
 		}
 
 		const auto &lin = obj_info->get_linearization();
-		std::unordered_set<fqon_t> pending_members;
+		std::unordered_set<member_id_t> pending_members;
 
 		for (auto obj = std::rbegin(lin); obj != std::rend(lin); ++obj) {
 			const ObjectInfo *obj_info = this->meta_info.get_object(*obj);
@@ -765,17 +1105,17 @@ void Database::check_hierarchy(const std::vector<fqon_t> &new_objs,
 			// but not in the state.
 
 			for (auto &it : obj_info->get_members()) {
-				const memberid_t &member_id = it.first;
+				member_id_t member_id = it.first;
 
-				if (state_members.find(member_id) == std::end(state_members)) {
+				if (not obj_state->has(this->get_member_key(member_id))) {
 					// member is not in the state.
 					pending_members.insert(member_id);
 				}
 			}
 
 			for (auto &it : state_members) {
-				const memberid_t &member_id = it.first;
-				const Member &member = it.second;
+				member_id_t member_id = it.second.first.get_id();
+				const Member &member = *it.second.second;
 				nyan_op op = member.get_operation();
 
 				// member has = operation, so it's no longer pending.
@@ -794,7 +1134,12 @@ void Database::check_hierarchy(const std::vector<fqon_t> &new_objs,
 			throw TypeError{
 				loc,
 				"this object has members without values: "s
-				+ util::strjoin(", ", pending_members)
+				+ util::strjoin(
+					", ", pending_members,
+					[this] (const member_id_t &member) {
+						return this->meta_info.get_symbols().get_member_name(member);
+					}
+				)
 			};
 		}
 	}
@@ -813,4 +1158,52 @@ std::shared_ptr<View> Database::new_view() {
 }
 
 
+void Database::index_descendants() {
+	const size_t obj_count = this->meta_info.get_objects().size();
+
+	// an object is a descendant of every other object in its linearization.
+	// the ids are visited in ascending order, so the lists end up sorted.
+	std::vector<std::vector<obj_id_t>> descendants(obj_count);
+	for (obj_id_t obj = 0; obj < obj_count; obj++) {
+		const ObjectInfo *obj_info = this->meta_info.get_object(obj);
+		if (unlikely(obj_info == nullptr)) {
+			throw InternalError{"object information not retrieved"};
+		}
+
+		const auto &linearization = obj_info->get_linearization();
+		for (size_t i = 1; i < linearization.size(); i++) {
+			descendants[linearization[i]].push_back(obj);
+		}
+	}
+
+	for (obj_id_t obj = 0; obj < obj_count; obj++) {
+		this->meta_info.get_object(obj)->set_descendants(std::move(descendants[obj]));
+	}
+}
+
+
+void Database::index_ancestries() {
+	const size_t obj_count = this->meta_info.get_objects().size();
+
+	for (obj_id_t obj = 0; obj < obj_count; obj++) {
+		ObjectInfo *obj_info = this->meta_info.get_object(obj);
+		if (unlikely(obj_info == nullptr)) {
+			throw InternalError{"object information not retrieved"};
+		}
+
+		const auto &linearization = obj_info->get_linearization();
+
+		Ancestry ancestry{linearization};
+		for (auto &parent : linearization) {
+			const std::shared_ptr<ObjectState> *parent_state = this->state->get(parent);
+			if (unlikely(parent_state == nullptr)) {
+				throw InternalError{"object parent has no initial state"};
+			}
+			ancestry.add_members(**parent_state);
+		}
+
+		obj_info->set_ancestry(std::move(ancestry));
+	}
+}
+
 } // namespace nyan
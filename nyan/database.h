@@ -2,6 +2,7 @@
 #pragma once
 
 #include <memory>
+#include <mutex>
 #include <string>
 #include <utility>
 #include <vector>
@@ -56,12 +57,50 @@ public:
 	 */
 	using filefetcher_t = std::function<std::shared_ptr<File>(const std::string &filename)>;
 
+	/**
+	 * Files loaded into the database, in load order.
+	 * Stores the name the file was fetched with and the file.
+	 */
+	using loaded_files_t = std::vector<std::pair<std::string, std::shared_ptr<File>>>;
+
 	/**
 	 * Load a nyan file.
 	 * This loads imported files as well.
+	 *
+	 * With max_jobs > 1, up to that many imported files
+	 * are fetched and parsed in parallel, so the filefetcher
+	 * has to be thread safe. The loaded database content
+	 * is the same for any number of jobs.
 	 */
 	void load(const std::string &filename,
-	          const filefetcher_t &filefetcher);
+	          const filefetcher_t &filefetcher,
+	          size_t max_jobs=1);
+
+	/**
+	 * Load the database content from a snapshot file
+	 * created by store_snapshot().
+	 * This skips parsing and checking the nyan files,
+	 * they are only fetched to verify that they haven't changed.
+	 *
+	 * Returns false if the snapshot is missing or outdated,
+	 * then the files have to be loaded with load().
+	 * Snapshots can only be loaded into an empty database.
+	 */
+	bool load_snapshot(const std::string &filename,
+	                   const filefetcher_t &filefetcher);
+
+	/**
+	 * Store the content loaded into the database in a snapshot file.
+	 * Changes done in views are not part of the snapshot.
+	 */
+	void store_snapshot(const std::string &filename) const;
+
+	/**
+	 * Return the files loaded into the database.
+	 */
+	const loaded_files_t &get_files() const {
+		return this->files;
+	}
 
 	/**
 	 * Return a new view to the database, it allows changes.
@@ -82,6 +121,14 @@ public:
 		return this->meta_info;
 	}
 
+	/**
+	 * Return the lock that serializes the modifications
+	 * of the views of this database.
+	 */
+	std::recursive_mutex &get_write_mutex() const {
+		return this->write_mutex;
+	}
+
 protected:
 
 	void create_obj_info(
@@ -93,8 +140,8 @@ protected:
 	);
 
 	void create_obj_content(
-		std::vector<fqon_t> *new_objs,
-		std::unordered_map<fqon_t, std::unordered_set<fqon_t>> *child_assignments,
+		std::vector<obj_id_t> *new_objs,
+		std::unordered_map<obj_id_t, std::unordered_set<obj_id_t>> *child_assignments,
 		const NamespaceFinder &current_file,
 		const Namespace &ns,
 		const Namespace &objname,
@@ -102,27 +149,61 @@ protected:
 	);
 
 	void create_obj_state(
-		std::vector<std::pair<fqon_t, Location>> *objs_in_values,
+		std::vector<std::pair<obj_id_t, Location>> *objs_in_values,
 		const NamespaceFinder &current_file,
 		const Namespace &ns,
 		const Namespace &objname,
 		const ASTObject &astobj
 	);
 
-	void linearize_new(const std::vector<fqon_t> &new_objs);
+	/**
+	 * Return the id of an object that has been found by name.
+	 */
+	obj_id_t get_object_id(const fqon_t &name) const;
+
+	/**
+	 * Return the lookup key of a member that has a slot.
+	 */
+	const MemberKey &get_member_key(member_id_t member) const;
+
+	void linearize_new(const std::vector<obj_id_t> &new_objs);
+
+	/**
+	 * Give each new member a slot in the object states.
+	 * Members that can be stored in the same object state
+	 * get different slots.
+	 */
+	void assign_member_slots(const std::vector<obj_id_t> &new_objs);
+
+	/**
+	 * Precompile the application of each patch that can't change,
+	 * as no patch targets any object of its linearization.
+	 */
+	void compile_patch_plans();
+
+	/**
+	 * Store the transitive children of each object in its info,
+	 * derived from the linearizations of all objects.
+	 */
+	void index_descendants();
+
+	/**
+	 * Store the ancestors and members of each object in its info.
+	 */
+	void index_ancestries();
 
 	void find_member(
 		bool skip_first,
-		const memberid_t &member_id,
-		const std::vector<fqon_t> &search_objs,
+		const MemberKey &member_key,
+		const std::vector<obj_id_t> &search_objs,
 		const ObjectInfo &obj_info,
-		const std::function<bool(const fqon_t &, const MemberInfo &, const Member *)> &member_found
+		const std::function<bool(obj_id_t, const MemberInfo &, const Member *)> &member_found
 	);
 
-	void resolve_types(const std::vector<fqon_t> &new_objs);
+	void resolve_types(const std::vector<obj_id_t> &new_objs);
 
-	void check_hierarchy(const std::vector<fqon_t> &new_objs,
-	                     const std::vector<std::pair<fqon_t, Location>> &objs_in_values);
+	void check_hierarchy(const std::vector<obj_id_t> &new_objs,
+	                     const std::vector<std::pair<obj_id_t, Location>> &objs_in_values);
 
 	/**
 	 * Database start state.
@@ -134,6 +215,17 @@ protected:
 	 * Tracks type information and locations of the database content etc.
 	 */
 	MetaInfo meta_info;
+
+	/**
+	 * All files which were loaded, in load order.
+	 */
+	loaded_files_t files;
+
+	/**
+	 * Serializes the modifications of the views of this database:
+	 * commits, resets, compactions and new child views.
+	 */
+	mutable std::recursive_mutex write_mutex;
 };
 
 } // namespace nyan
@@ -0,0 +1,8 @@
+// Copyright 2019-2019 the nyan authors, LGPLv3+. See copying.md for legal info.
+
+#include "mpsc_queue.h"
+
+namespace nyan::datastructure {
+
+
+} // namespace nyan::datastructure
@@ -0,0 +1,120 @@
+// Copyright 2019-2019 the nyan authors, LGPLv3+. See copying.md for legal info.
+#pragma once
+
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+
+namespace nyan::datastructure {
+
+
+/**
+ * Lock-free queue with multiple producers and a single consumer.
+ *
+ * Producers push onto a linked stack with a compare-and-swap.
+ * The consumer takes the whole stack at once and processes
+ * it in insertion order, so it drains the queue in batches.
+ */
+template <typename T>
+class MPSCQueue {
+public:
+	MPSCQueue()
+		:
+		head{nullptr} {}
+
+	~MPSCQueue() {
+		this->clear();
+	}
+
+	MPSCQueue(const MPSCQueue &other) = delete;
+	MPSCQueue(MPSCQueue &&other) = delete;
+	MPSCQueue &operator =(const MPSCQueue &other) = delete;
+	MPSCQueue &operator =(MPSCQueue &&other) = delete;
+
+	/**
+	 * Append a value. Can be called from any thread.
+	 */
+	void push(T &&value) {
+		Node *node = new Node{std::move(value), this->head.load(std::memory_order_relaxed)};
+
+		while (not this->head.compare_exchange_weak(node->next, node,
+		                                            std::memory_order_release,
+		                                            std::memory_order_relaxed)) {
+			// node->next was updated to the current head, try again.
+		}
+	}
+
+	/**
+	 * Remove all values pushed so far and call the function
+	 * for each of them in the order they were pushed.
+	 * Only one thread may consume at a time.
+	 * Returns the number of values consumed.
+	 */
+	template <typename F>
+	size_t consume_all(F &&func) {
+		Node *node = this->head.exchange(nullptr, std::memory_order_acquire);
+
+		// the stack is newest first.
+		Node *ordered = nullptr;
+		while (node != nullptr) {
+			Node *next = node->next;
+			node->next = ordered;
+			ordered = node;
+			node = next;
+		}
+
+		size_t count = 0;
+		try {
+			while (ordered != nullptr) {
+				std::unique_ptr<Node> current{ordered};
+				ordered = current->next;
+				count += 1;
+
+				func(std::move(current->value));
+			}
+		}
+		catch (...) {
+			// the values after the failed one are dropped.
+			while (ordered != nullptr) {
+				std::unique_ptr<Node> current{ordered};
+				ordered = current->next;
+			}
+			throw;
+		}
+
+		return count;
+	}
+
+	/**
+	 * Drop all values pushed so far.
+	 * Must not run concurrently with a consumer.
+	 */
+	void clear() {
+		this->consume_all([] (T &&) {});
+	}
+
+	/**
+	 * Check if there are no values to consume.
+	 * Only a hint if other threads are pushing.
+	 */
+	bool empty() const {
+		return this->head.load(std::memory_order_acquire) == nullptr;
+	}
+
+protected:
+	struct Node {
+		T value;
+		Node *next;
+	};
+
+	/**
+	 * The most recently pushed value.
+	 */
+	std::atomic<Node *> head;
+};
+
+
+} // namespace nyan::datastructure
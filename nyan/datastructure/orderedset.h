@@ -2,6 +2,7 @@
 #pragma once
 
 
+#include <cstddef>
 #include <list>
 #include <unordered_map>
 
@@ -0,0 +1,8 @@
+// Copyright 2019-2019 the nyan authors, LGPLv3+. See copying.md for legal info.
+
+#include "persistent_map.h"
+
+namespace nyan::datastructure {
+
+
+} // namespace nyan::datastructure
@@ -0,0 +1,395 @@
+// Copyright 2019-2019 the nyan authors, LGPLv3+. See copying.md for legal info.
+#pragma once
+
+
+#include <bitset>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <variant>
+#include <vector>
+
+
+namespace nyan::datastructure {
+
+
+/**
+ * Persistent map from integer keys to values.
+ *
+ * Implemented as hash array mapped trie, which uses the key bits
+ * directly as hash, since the keys are dense ids.
+ *
+ * Copies of the map share their nodes. A modification only copies
+ * the shared nodes on the path to the modified entry,
+ * so it needs O(log n) new memory instead of a full copy.
+ *
+ * The depth is limited by the key bits. Below the last level
+ * that still has key bits, entries are kept in a collision bucket.
+ */
+template <typename T>
+class PersistentMap {
+public:
+	using key_type = uint32_t;
+
+	/**
+	 * Entry stored in the map.
+	 */
+	using value_type = std::pair<key_type, T>;
+
+	PersistentMap() = default;
+	~PersistentMap() = default;
+
+	// copies are cheap, they share all nodes.
+	PersistentMap(const PersistentMap &other) = default;
+	PersistentMap(PersistentMap &&other) noexcept = default;
+	PersistentMap &operator =(const PersistentMap &other) = default;
+	PersistentMap &operator =(PersistentMap &&other) noexcept = default;
+
+protected:
+	/**
+	 * Number of key bits used in each trie level.
+	 */
+	static constexpr unsigned level_bits = 5;
+	static constexpr key_type level_mask = (key_type{1} << level_bits) - 1;
+
+	/**
+	 * Number of bits in a key.
+	 * Nodes at this shift or deeper are collision buckets.
+	 */
+	static constexpr unsigned key_bits = sizeof(key_type) * 8;
+
+	/**
+	 * Return the bitmap bit of the key in a node at the given shift.
+	 * Must only be used for shifts below key_bits,
+	 * shifting by the full width is undefined.
+	 */
+	static uint32_t position(key_type key, unsigned shift) {
+		return uint32_t{1} << ((key >> shift) & level_mask);
+	}
+
+	/**
+	 * Check if a node at the given shift is a collision bucket.
+	 * Its slots are unordered entries that are searched linearly,
+	 * the bitmap is unused.
+	 */
+	static constexpr bool is_bucket(unsigned shift) {
+		return shift >= key_bits;
+	}
+
+	struct Node;
+
+	/**
+	 * Position in a node: either a stored entry or a deeper node.
+	 */
+	using slot_t = std::variant<value_type, std::shared_ptr<Node>>;
+
+	/**
+	 * Trie node.
+	 * Only the used positions are stored, the bitmap tells which ones.
+	 */
+	struct Node {
+		uint32_t bitmap = 0;
+		std::vector<slot_t> slots;
+
+		/**
+		 * Position of the given bit in the slot list.
+		 */
+		size_t index(uint32_t bit) const {
+			return std::bitset<32>{this->bitmap & (bit - 1)}.count();
+		}
+	};
+
+	/**
+	 * Make the given node writable.
+	 * If it is shared with other maps, it is replaced by a copy.
+	 */
+	static Node &unshare(std::shared_ptr<Node> &node) {
+		if (not node) {
+			node = std::make_shared<Node>();
+		}
+		else if (node.use_count() > 1) {
+			node = std::make_shared<Node>(*node);
+		}
+		return *node;
+	}
+
+	/**
+	 * Return the slot for the key,
+	 * copying all shared nodes on the path.
+	 * Returns nullptr if the key is not in the map.
+	 */
+	value_type *find_writable(key_type key) {
+		if (not this->root) {
+			return nullptr;
+		}
+
+		Node *node = &unshare(this->root);
+		for (unsigned shift = 0; ; shift += level_bits) {
+			if (is_bucket(shift)) {
+				for (auto &slot : node->slots) {
+					auto &entry = std::get<value_type>(slot);
+					if (entry.first == key) {
+						return &entry;
+					}
+				}
+				return nullptr;
+			}
+
+			uint32_t bit = position(key, shift);
+			if (not (node->bitmap & bit)) {
+				return nullptr;
+			}
+
+			slot_t &slot = node->slots[node->index(bit)];
+			if (auto *entry = std::get_if<value_type>(&slot)) {
+				return (entry->first == key) ? entry : nullptr;
+			}
+
+			node = &unshare(std::get<std::shared_ptr<Node>>(slot));
+		}
+	}
+
+public:
+	/**
+	 * Return the value stored for the key,
+	 * or nullptr if the key is not in the map.
+	 */
+	const T *get(key_type key) const {
+		const Node *node = this->root.get();
+		for (unsigned shift = 0; node != nullptr; shift += level_bits) {
+			if (is_bucket(shift)) {
+				for (auto &slot : node->slots) {
+					auto &entry = std::get<value_type>(slot);
+					if (entry.first == key) {
+						return &entry.second;
+					}
+				}
+				return nullptr;
+			}
+
+			uint32_t bit = position(key, shift);
+			if (not (node->bitmap & bit)) {
+				return nullptr;
+			}
+
+			const slot_t &slot = node->slots[node->index(bit)];
+			if (auto *entry = std::get_if<value_type>(&slot)) {
+				return (entry->first == key) ? &entry->second : nullptr;
+			}
+
+			node = std::get<std::shared_ptr<Node>>(slot).get();
+		}
+		return nullptr;
+	}
+
+	/**
+	 * Return the value stored for the key so it can be modified,
+	 * or nullptr if the key is not in the map.
+	 * Other copies of the map are not affected by the modification.
+	 */
+	T *get_writable(key_type key) {
+		value_type *entry = this->find_writable(key);
+		if (entry == nullptr) {
+			return nullptr;
+		}
+		return &entry->second;
+	}
+
+	/**
+	 * Store the value for the key.
+	 * An existing value for the key is replaced.
+	 * The returned reference is valid until the map is modified.
+	 */
+	T &insert(key_type key, T &&value) {
+		Node *node = &unshare(this->root);
+
+		for (unsigned shift = 0; ; shift += level_bits) {
+			if (is_bucket(shift)) {
+				for (auto &slot : node->slots) {
+					auto &entry = std::get<value_type>(slot);
+					if (entry.first == key) {
+						entry.second = std::move(value);
+						return entry.second;
+					}
+				}
+
+				node->slots.emplace_back(std::in_place_type<value_type>, key, std::move(value));
+				this->entry_count += 1;
+				return std::get<value_type>(node->slots.back()).second;
+			}
+
+			uint32_t bit = position(key, shift);
+			size_t idx = node->index(bit);
+
+			// free position: store the entry here.
+			if (not (node->bitmap & bit)) {
+				node->bitmap |= bit;
+				auto ins = node->slots.emplace(
+					std::begin(node->slots) + idx,
+					std::in_place_type<value_type>, key, std::move(value)
+				);
+				this->entry_count += 1;
+				return std::get<value_type>(*ins).second;
+			}
+
+			slot_t &slot = node->slots[idx];
+			if (auto *entry = std::get_if<value_type>(&slot)) {
+				if (entry->first == key) {
+					entry->second = std::move(value);
+					return entry->second;
+				}
+
+				// another key is stored at this position:
+				// move it one level down and continue there.
+				// without key bits left, the level below is a bucket.
+				auto child = std::make_shared<Node>();
+				if (not is_bucket(shift + level_bits)) {
+					child->bitmap = position(entry->first, shift + level_bits);
+				}
+				child->slots.emplace_back(std::move(*entry));
+				slot = std::move(child);
+			}
+
+			node = &unshare(std::get<std::shared_ptr<Node>>(slot));
+		}
+	}
+
+	/**
+	 * Remove the value stored for the key.
+	 * Returns false if the key was not in the map.
+	 * Nodes emptied by the removal are kept.
+	 */
+	bool erase(key_type key) {
+		if (this->get(key) == nullptr) {
+			return false;
+		}
+
+		Node *node = &unshare(this->root);
+		for (unsigned shift = 0; ; shift += level_bits) {
+			if (is_bucket(shift)) {
+				for (auto it = std::begin(node->slots); it != std::end(node->slots); ++it) {
+					if (std::get<value_type>(*it).first == key) {
+						node->slots.erase(it);
+						this->entry_count -= 1;
+						return true;
+					}
+				}
+				return false;
+			}
+
+			uint32_t bit = position(key, shift);
+			size_t idx = node->index(bit);
+
+			slot_t &slot = node->slots[idx];
+			if (std::holds_alternative<value_type>(slot)) {
+				node->slots.erase(std::begin(node->slots) + idx);
+				node->bitmap &= ~bit;
+				this->entry_count -= 1;
+				return true;
+			}
+
+			node = &unshare(std::get<std::shared_ptr<Node>>(slot));
+		}
+	}
+
+	/**
+	 * Return the number of entries in the map.
+	 */
+	size_t size() const {
+		return this->entry_count;
+	}
+
+	/**
+	 * Iterator over all entries of the map.
+	 * The entries are ordered by the trie layout, not by key.
+	 */
+	class ConstIterator {
+	public:
+		ConstIterator() = default;
+
+		explicit ConstIterator(const Node *root) {
+			if (root != nullptr) {
+				this->path.push_back({root, 0});
+				this->advance();
+			}
+		}
+
+		ConstIterator &operator ++() {
+			this->path.back().second += 1;
+			this->advance();
+			return *this;
+		}
+
+		const value_type &operator *() const {
+			auto &pos = this->path.back();
+			return std::get<value_type>(pos.first->slots[pos.second]);
+		}
+
+		const value_type *operator ->() const {
+			return &**this;
+		}
+
+		bool operator ==(const ConstIterator &other) const {
+			return this->path == other.path;
+		}
+
+		bool operator !=(const ConstIterator &other) const {
+			return not (*this == other);
+		}
+
+	protected:
+		/**
+		 * Move to the next entry, starting at the current position.
+		 */
+		void advance() {
+			while (not this->path.empty()) {
+				auto &pos = this->path.back();
+
+				if (pos.second >= pos.first->slots.size()) {
+					// node done, continue in the parent.
+					this->path.pop_back();
+					if (not this->path.empty()) {
+						this->path.back().second += 1;
+					}
+					continue;
+				}
+
+				const slot_t &slot = pos.first->slots[pos.second];
+				if (std::holds_alternative<value_type>(slot)) {
+					return;
+				}
+
+				this->path.push_back({std::get<std::shared_ptr<Node>>(slot).get(), 0});
+			}
+		}
+
+		/**
+		 * Nodes from the root to the current entry,
+		 * with the slot index in each node.
+		 */
+		std::vector<std::pair<const Node *, size_t>> path;
+	};
+
+	using const_iterator = ConstIterator;
+
+	const_iterator begin() const {
+		return const_iterator{this->root.get()};
+	}
+
+	const_iterator end() const {
+		return const_iterator{};
+	}
+
+protected:
+	/**
+	 * Root node, nullptr if the map is empty.
+	 */
+	std::shared_ptr<Node> root;
+
+	/**
+	 * Number of stored entries.
+	 */
+	size_t entry_count = 0;
+};
+
+} // namespace nyan::datastructure
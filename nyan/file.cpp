@@ -2,6 +2,18 @@
 
 #include "file.h"
 
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #include "error.h"
 #include "util.h"
 
@@ -20,21 +32,136 @@ File::File(const std::string &virtual_name, std::string &&data)
 
 File::File(const std::string &path)
 	:
-	File{path, util::read_file(path)} {
+	name{path} {
+
+	if (not this->map_file(path)) {
+		// util::read_file throws a FileReadError if unsuccessful.
+		this->data = util::read_file(path);
+	}
+
+	this->extract_lines();
+}
+
+
+File::File(File &&other) noexcept
+	:
+	name{std::move(other.name)},
+	data{std::move(other.data)},
+	mapping{other.mapping},
+	mapping_size{other.mapping_size},
+	mapping_length{other.mapping_length},
+	line_ends{std::move(other.line_ends)} {
+
+	other.mapping = nullptr;
+	other.mapping_size = 0;
+	other.mapping_length = 0;
+}
+
+
+File &File::operator =(File &&other) noexcept {
+	if (this != &other) {
+		this->unmap_file();
+
+		this->name = std::move(other.name);
+		this->data = std::move(other.data);
+		this->mapping = other.mapping;
+		this->mapping_size = other.mapping_size;
+		this->mapping_length = other.mapping_length;
+		this->line_ends = std::move(other.line_ends);
+
+		other.mapping = nullptr;
+		other.mapping_size = 0;
+		other.mapping_length = 0;
+	}
+	return *this;
+}
+
+
+File::~File() {
+	this->unmap_file();
+}
+
+
+bool File::map_file(const std::string &path) {
+#ifdef _WIN32
+	(void)path;
+	return false;
+#else
+	// on any failure, the file is read instead,
+	// which also reports the errors of unreadable files.
+	int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return false;
+	}
+
+	struct stat info;
+	if (fstat(fd, &info) != 0 or not S_ISREG(info.st_mode) or info.st_size <= 0) {
+		// empty files, pipes and files without a known size
+		// (like those in /proc) can't be mapped.
+		close(fd);
+		return false;
+	}
+
+	size_t size = static_cast<size_t>(info.st_size);
+
+	// the content has to be null-terminated for c_str(), but a file
+	// mapping ends at the file size. so first an anonymous zeroed
+	// area one byte larger than the file is reserved, then the file
+	// is mapped over its start with MAP_FIXED. the byte after the
+	// content is either the zero-filled rest of the last file page
+	// or, if the size is a multiple of the page size, the first byte
+	// of the anonymous page behind the file mapping.
+	size_t length = size + 1;
+	void *area = mmap(nullptr, length, PROT_READ,
+	                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (area == MAP_FAILED) {
+		close(fd);
+		return false;
+	}
+
+	void *content = mmap(area, size, PROT_READ,
+	                     MAP_PRIVATE | MAP_FIXED, fd, 0);
+	close(fd);
 
-	// util::read_file throws a FileReadError if unsuccessful.
+	if (content == MAP_FAILED) {
+		// the reserved area is still mapped.
+		munmap(area, length);
+		return false;
+	}
+
+	this->mapping = static_cast<char *>(content);
+	this->mapping_size = size;
+	this->mapping_length = length;
+	return true;
+#endif
+}
+
+
+void File::unmap_file() {
+#ifndef _WIN32
+	if (this->mapping != nullptr) {
+		// the file mapping and the rest of the reserved area
+		// are adjacent, so one call releases both.
+		munmap(this->mapping, this->mapping_length);
+		this->mapping = nullptr;
+		this->mapping_size = 0;
+		this->mapping_length = 0;
+	}
+#endif
 }
 
 
 void File::extract_lines() {
+	std::string_view content = this->get_content();
+
 	this->line_ends = { std::string::npos };
 
-	for (size_t i = 0; i < this->data.size(); i++) {
-		if (this->data[i] == '\n') {
+	for (size_t i = 0; i < content.size(); i++) {
+		if (content[i] == '\n') {
 			this->line_ends.push_back(i);
 		}
 	}
-	this->line_ends.push_back(data.size());
+	this->line_ends.push_back(content.size());
 }
 
 
@@ -43,7 +170,10 @@ const std::string &File::get_name() const {
 }
 
 
-const std::string &File::get_content() const {
+std::string_view File::get_content() const {
+	if (this->mapping != nullptr) {
+		return {this->mapping, this->mapping_size};
+	}
 	return this->data;
 }
 
@@ -51,17 +181,20 @@ const std::string &File::get_content() const {
 std::string File::get_line(size_t n) const {
 	size_t begin = this->line_ends[n - 1] + 1;
 	size_t len = this->line_ends[n] - begin;
-	return this->data.substr(begin, len);
+	return std::string{this->get_content().substr(begin, len)};
 }
 
 
 const char *File::c_str() const {
+	if (this->mapping != nullptr) {
+		return this->mapping;
+	}
 	return this->data.c_str();
 }
 
 
 size_t File::size() const {
-	return this->data.size();
+	return this->get_content().size();
 }
 
 
@@ -3,6 +3,7 @@
 
 
 #include <string>
+#include <string_view>
 #include <vector>
 
 
@@ -14,18 +15,23 @@ namespace nyan {
  */
 class File {
 public:
+	/**
+	 * Open the file at the given path.
+	 * Where supported, the file is memory-mapped instead of
+	 * being copied into memory.
+	 */
 	File(const std::string &path);
 	File(const std::string &virtual_name, std::string &&data);
 
 	// moving allowed
-	File(File &&other) noexcept = default;
-	File& operator =(File &&other) noexcept = default;
+	File(File &&other) noexcept;
+	File& operator =(File &&other) noexcept;
 
 	// no copies
 	File(const File &other) = delete;
 	File &operator =(const File &other) = delete;
 
-	virtual ~File() = default;
+	virtual ~File();
 
 	/**
 	 * Return the file name.
@@ -34,8 +40,9 @@ public:
 
 	/**
 	 * Return the file content.
+	 * It is valid as long as this file exists.
 	 */
-	const std::string &get_content() const;
+	std::string_view get_content() const;
 
 	/**
 	 * Return the given line number of the file.
@@ -66,9 +73,41 @@ protected:
 	 */
 	void extract_lines();
 
+	/**
+	 * Map the file at the given path into memory.
+	 * Return false if the file can't be opened or mapped,
+	 * then it has to be read instead.
+	 */
+	bool map_file(const std::string &path);
+
+	/**
+	 * Remove the memory mapping of the file, if there is one.
+	 */
+	void unmap_file();
+
 	std::string name;
+
+	/**
+	 * File content if the file is not memory-mapped.
+	 */
 	std::string data;
 
+	/**
+	 * Start of the memory-mapped file content, or nullptr.
+	 * The mapping is followed by a null byte.
+	 */
+	char *mapping = nullptr;
+
+	/**
+	 * Size of the memory-mapped file content.
+	 */
+	size_t mapping_size = 0;
+
+	/**
+	 * Size of the whole mapped area, including the null byte.
+	 */
+	size_t mapping_length = 0;
+
 	/**
 	 * Stores the offsets of line endings in the file content.
 	 */
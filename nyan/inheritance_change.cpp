@@ -4,10 +4,10 @@
 
 namespace nyan {
 
-InheritanceChange::InheritanceChange(inher_change_t type, fqon_t &&target)
+InheritanceChange::InheritanceChange(inher_change_t type, obj_id_t target)
 	:
 	type{type},
-	target{std::move(target)} {}
+	target{target} {}
 
 
 inher_change_t InheritanceChange::get_type() const {
@@ -15,7 +15,7 @@ inher_change_t InheritanceChange::get_type() const {
 }
 
 
-const fqon_t &InheritanceChange::get_target() const {
+obj_id_t InheritanceChange::get_target() const {
 	return this->target;
 }
 
@@ -12,14 +12,14 @@ namespace nyan {
  */
 class InheritanceChange {
 public:
-	InheritanceChange(inher_change_t type, fqon_t &&target);
+	InheritanceChange(inher_change_t type, obj_id_t target);
 
 	inher_change_t get_type() const;
-	const fqon_t &get_target() const;
+	obj_id_t get_target() const;
 
 protected:
 	inher_change_t type;
-	fqon_t target;
+	obj_id_t target;
 };
 
 
@@ -2,6 +2,9 @@
 
 #include "impl.h"
 
+#include <algorithm>
+#include <cstring>
+
 #define YY_NO_UNISTD_H
 #include "flex.gen.h"
 
@@ -68,8 +71,11 @@ int Impl::read_input(char *buffer, int max_size) {
 		return 0;
 	}
 
-	this->input.read(buffer, static_cast<std::streamsize>(max_size));
-	return static_cast<int>(this->input.gcount());
+	size_t count = std::min(this->input.size(), static_cast<size_t>(max_size));
+	std::memcpy(buffer, this->input.data(), count);
+	this->input.remove_prefix(count);
+
+	return static_cast<int>(count);
 }
 
 void Impl::endline() {
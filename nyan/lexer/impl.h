@@ -3,6 +3,7 @@
 
 #include <queue>
 #include <stack>
+#include <string_view>
 
 #include "bracket.h"
 #include "../lang_error.h"
@@ -69,8 +70,11 @@ protected:
 	/** Input file used for tokenization. */
 	std::shared_ptr<File> file;
 
-	/** String stream which is fed into the lexer. */
-	std::istringstream input;
+	/**
+	 * File content which was not yet fed into the lexer.
+	 * Points directly into the file, so nothing is copied beforehand.
+	 */
+	std::string_view input;
 
 	/** Available tokens. */
 	std::queue<Token> tokens;
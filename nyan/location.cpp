@@ -47,6 +47,10 @@ const std::string &Location::get_msg() const {
 	return this->msg;
 }
 
+const std::shared_ptr<File> &Location::get_file() const {
+	return this->file;
+}
+
 int Location::get_line() const {
 	return this->line;
 }
@@ -29,6 +29,7 @@ public:
 
 	bool is_builtin() const;
 	const std::string &get_msg() const;
+	const std::shared_ptr<File> &get_file() const;
 	int get_line() const;
 	int get_line_offset() const;
 	int get_length() const;
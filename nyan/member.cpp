@@ -48,6 +48,11 @@ Member &Member::operator =(Member &&other) noexcept {
 }
 
 
+override_depth_t Member::get_override_depth() const {
+	return this->override_depth;
+}
+
+
 nyan_op Member::get_operation() const {
 	return this->operation;
 }
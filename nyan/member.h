@@ -39,6 +39,11 @@ public:
 	 */
 	nyan_op get_operation() const;
 
+	/**
+	 * Provide the number of @ chars before the operation.
+	 */
+	override_depth_t get_override_depth() const;
+
 	/**
 	 * Return the value stored in this member.
 	 */
@@ -0,0 +1,49 @@
+// Copyright 2019-2019 the nyan authors, LGPLv3+. See copying.md for legal info.
+#pragma once
+
+#include "config.h"
+
+
+namespace nyan {
+
+
+/**
+ * Prepared lookup key for a member.
+ * Get it once from the View by member name,
+ * then access member values without hashing the name.
+ */
+class MemberKey {
+public:
+	MemberKey(member_id_t id, member_slot_t slot)
+		:
+		id{id},
+		slot{slot} {}
+
+	/**
+	 * Return the interned member name.
+	 */
+	member_id_t get_id() const {
+		return this->id;
+	}
+
+	/**
+	 * Return the preferred storage slot in object states.
+	 */
+	member_slot_t get_slot() const {
+		return this->slot;
+	}
+
+protected:
+	/**
+	 * Interned member name.
+	 */
+	member_id_t id;
+
+	/**
+	 * Slot the member is stored at in each object state.
+	 * Members that can be in the same object state have distinct slots.
+	 */
+	member_slot_t slot;
+};
+
+} // namespace nyan
@@ -4,25 +4,31 @@
 
 #include <sstream>
 
+#include "compiler.h"
 #include "lang_error.h"
 
 
 namespace nyan {
 
 ObjectInfo &MetaInfo::add_object(const fqon_t &name, ObjectInfo &&obj) {
-	// copy location so we can use it after obj was moved.
-	Location loc = obj.get_location();
-
-	auto ret = this->object_info.insert({name, std::move(obj)});
-	if (ret.second == false) {
+	const obj_id_t *existing = this->get_object_id(name);
+	if (existing != nullptr) {
 		throw LangError{
-			loc,
+			obj.get_location(),
 			"object already defined",
-			{{ret.first->second.get_location(), "first defined here"}}
+			{{this->object_info[*existing].get_location(), "first defined here"}}
 		};
 	}
 
-	return ret.first->second;
+	// object ids are only handed out here,
+	// so they're the index in the info storage.
+	obj_id_t id = this->symbols.add_object(name);
+	if (unlikely(id != this->object_info.size())) {
+		throw InternalError{"object id doesn't match the info storage"};
+	}
+
+	this->object_info.push_back(std::move(obj));
+	return this->object_info.back();
 }
 
 
@@ -32,34 +38,105 @@ const MetaInfo::obj_info_t &MetaInfo::get_objects() const {
 
 
 ObjectInfo *MetaInfo::get_object(const fqon_t &name) {
-	auto it = this->object_info.find(name);
-	if (it == std::end(this->object_info)) {
+	const obj_id_t *id = this->get_object_id(name);
+	if (id == nullptr) {
 		return nullptr;
 	}
-	return &it->second;
+	return &this->object_info[*id];
 }
 
 
-// Thanks C++ for the beautiful duplication
 const ObjectInfo *MetaInfo::get_object(const fqon_t &name) const {
-	auto it = this->object_info.find(name);
-	if (it == std::end(this->object_info)) {
+	const obj_id_t *id = this->get_object_id(name);
+	if (id == nullptr) {
+		return nullptr;
+	}
+	return &this->object_info[*id];
+}
+
+
+ObjectInfo *MetaInfo::get_object(obj_id_t id) {
+	if (id >= this->object_info.size()) {
+		return nullptr;
+	}
+	return &this->object_info[id];
+}
+
+
+// Thanks C++ for the beautiful duplication
+const ObjectInfo *MetaInfo::get_object(obj_id_t id) const {
+	if (id >= this->object_info.size()) {
 		return nullptr;
 	}
-	return &it->second;
+	return &this->object_info[id];
+}
+
+
+const obj_id_t *MetaInfo::get_object_id(const fqon_t &name) const {
+	return this->symbols.get_object_id(name);
 }
 
 
 bool MetaInfo::has_object(const fqon_t &name) const {
-	return (this->object_info.find(name) != std::end(this->object_info));
+	return this->get_object_id(name) != nullptr;
+}
+
+
+const MemberKey &MetaInfo::add_member_key(member_id_t member, member_slot_t slot) {
+	if (member >= this->member_keys.size()) {
+		this->member_keys.resize(member + 1);
+	}
+
+	auto &key = this->member_keys[member];
+	if (unlikely(key.has_value())) {
+		throw InternalError{"member slot was already assigned"};
+	}
+
+	key.emplace(member, slot);
+	return *key;
+}
+
+
+const MemberKey *MetaInfo::get_member_key(member_id_t member) const {
+	if (member >= this->member_keys.size()) {
+		return nullptr;
+	}
+
+	const auto &key = this->member_keys[member];
+	if (not key.has_value()) {
+		return nullptr;
+	}
+	return &*key;
+}
+
+
+const MemberKey *MetaInfo::get_member_key(const memberid_t &name) const {
+	const member_id_t *member = this->symbols.get_member_id(name);
+	if (member == nullptr) {
+		return nullptr;
+	}
+	return this->get_member_key(*member);
+}
+
+
+SymbolTable &MetaInfo::get_symbols() {
+	return this->symbols;
+}
+
+
+const SymbolTable &MetaInfo::get_symbols() const {
+	return this->symbols;
 }
 
 
 std::string MetaInfo::str() const {
 	std::ostringstream builder;
 
-	for (auto &it : this->get_objects()) {
-		builder << it.first << " -> " << it.second.str() << std::endl;
+	obj_id_t id = 0;
+	for (auto &info : this->get_objects()) {
+		builder << this->symbols.get_object_name(id) << " -> "
+		        << info.str(this->symbols) << std::endl;
+		id += 1;
 	}
 
 	return builder.str();
@@ -1,12 +1,16 @@
-// Copyright 2017-2017 the nyan authors, LGPLv3+. See copying.md for legal info.
+// Copyright 2017-2019 the nyan authors, LGPLv3+. See copying.md for legal info.
 #pragma once
 
+#include <deque>
 #include <memory>
-#include <unordered_map>
+#include <optional>
 #include <string>
+#include <vector>
 
 #include "config.h"
+#include "member_key.h"
 #include "object_info.h"
+#include "symbol_table.h"
 
 
 namespace nyan {
@@ -17,11 +21,18 @@ namespace nyan {
  */
 class MetaInfo {
 public:
-	using obj_info_t = std::unordered_map<fqon_t, ObjectInfo>;
+	/**
+	 * Object infos, indexed by object id.
+	 * A deque so references stay valid when objects are added.
+	 */
+	using obj_info_t = std::deque<ObjectInfo>;
 
 	MetaInfo() = default;
 	~MetaInfo() = default;
 
+	MetaInfo(MetaInfo &&other) noexcept = default;
+	MetaInfo &operator =(MetaInfo &&other) noexcept = default;
+
 	ObjectInfo &add_object(const fqon_t &name, ObjectInfo &&obj);
 
 	const obj_info_t &get_objects() const;
@@ -29,16 +40,50 @@ public:
 	ObjectInfo *get_object(const fqon_t &name);
 	const ObjectInfo *get_object(const fqon_t &name) const;
 
+	ObjectInfo *get_object(obj_id_t id);
+	const ObjectInfo *get_object(obj_id_t id) const;
+
+	/**
+	 * Return a pointer to the id of the object,
+	 * or nullptr if no such object is known.
+	 */
+	const obj_id_t *get_object_id(const fqon_t &name) const;
+
 	bool has_object(const fqon_t &name) const;
 
+	/**
+	 * Assign the storage slot of a member.
+	 */
+	const MemberKey &add_member_key(member_id_t member, member_slot_t slot);
+
+	/**
+	 * Return the lookup key of a member,
+	 * or nullptr if the member has no slot.
+	 */
+	const MemberKey *get_member_key(member_id_t member) const;
+	const MemberKey *get_member_key(const memberid_t &name) const;
+
+	SymbolTable &get_symbols();
+	const SymbolTable &get_symbols() const;
+
 	std::string str() const;
 
 protected:
+	/**
+	 * Interned object and member names.
+	 */
+	SymbolTable symbols;
+
 	/**
 	 * Location and type information for the objects.
 	 * This is for displaying error messages and line information.
 	 */
 	obj_info_t object_info;
+
+	/**
+	 * Lookup keys of the members, indexed by member id.
+	 */
+	std::vector<std::optional<MemberKey>> member_keys;
 };
 
 } // namespace nyan
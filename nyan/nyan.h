@@ -16,10 +16,12 @@
 #include "file.h"
 #include "lexer/lexer.h"
 #include "member.h"
+#include "member_key.h"
 #include "namespace.h"
 #include "object.h"
 #include "ops.h"
 #include "parser.h"
+#include "symbol_table.h"
 #include "token.h"
 #include "type.h"
 #include "util.h"
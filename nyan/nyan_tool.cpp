@@ -14,16 +14,38 @@
 
 namespace nyan {
 
-int test_parser(const std::string &base_path, const std::string &filename) {
-	int ret = 0;
+/**
+ * Load a nyan file and its imports into a new database.
+ * If a snapshot filename is given, the snapshot is used if it is
+ * up to date, otherwise it is recreated after loading the files.
+ */
+std::shared_ptr<Database> load_database(const std::string &base_path,
+                                        const std::string &filename,
+                                        const std::string &snapshot) {
 	auto db = Database::create();
 
-	db->load(
-		filename,
-		[&base_path] (const std::string &filename) {
-			return std::make_shared<File>(base_path + "/" + filename);
-		}
-	);
+	auto filefetcher = [&base_path] (const std::string &filename) {
+		return std::make_shared<File>(base_path + "/" + filename);
+	};
+
+	if (snapshot.size() > 0 and db->load_snapshot(snapshot, filefetcher)) {
+		return db;
+	}
+
+	db->load(filename, filefetcher);
+
+	if (snapshot.size() > 0) {
+		db->store_snapshot(snapshot);
+	}
+
+	return db;
+}
+
+
+int test_parser(const std::string &base_path, const std::string &filename,
+                const std::string &snapshot) {
+	int ret = 0;
+	auto db = load_database(base_path, filename, snapshot);
 
 	std::shared_ptr<View> root = db->new_view();
 
@@ -127,13 +149,18 @@ int test_parser(const std::string &base_path, const std::string &filename) {
 
 int run(flags_t flags, params_t params) {
 	try {
-		if (flags[option_flag::TEST_PARSER]) {
+		if (flags[option_flag::TEST_PARSER] or flags[option_flag::CREATE_SNAPSHOT]) {
 			const std::string &filename = params[option_param::FILE];
+			const std::string &snapshot = params[option_param::SNAPSHOT];
 
 			if (filename.size() == 0) {
 				throw Error{"empty filename given"};
 			}
 
+			if (flags[option_flag::CREATE_SNAPSHOT] and snapshot.size() == 0) {
+				throw Error{"no snapshot filename given"};
+			}
+
 			std::vector<std::string> parts = util::split(filename, '/');
 
 			// first file is assumed to be in the root.
@@ -144,7 +171,21 @@ int run(flags_t flags, params_t params) {
 			std::string base_path = util::strjoin("/", parts);
 
 			try {
-				return nyan::test_parser(base_path, first_file);
+				if (flags[option_flag::CREATE_SNAPSHOT]) {
+					auto db = Database::create();
+					db->load(
+						first_file,
+						[&base_path] (const std::string &filename) {
+							return std::make_shared<File>(base_path + "/" + filename);
+						}
+					);
+					db->store_snapshot(snapshot);
+					std::cout << "stored snapshot in " << snapshot << std::endl;
+				}
+
+				if (flags[option_flag::TEST_PARSER]) {
+					return nyan::test_parser(base_path, first_file, snapshot);
+				}
 			}
 			catch (LangError &err) {
 				std::cout << "\x1b[33;1mfile error:\x1b[m\n"
@@ -178,8 +219,10 @@ void help() {
 	          << "usage:" << std::endl
 	          << "-h --help                  -- show this" << std::endl
 	          << "-f --file <filename>       -- file to load" << std::endl
+	          << "-s --snapshot <filename>   -- load from this snapshot if it is up to date" << std::endl
 	          << "-b --break                 -- debug-break on error" << std::endl
 	          << "   --test-parser           -- test the parser" << std::endl
+	          << "   --create-snapshot       -- load the file and store the snapshot" << std::endl
 	          << "   --echo                  -- print the ast" << std::endl
 	          << "" << std::endl;
 }
@@ -187,12 +230,14 @@ void help() {
 
 std::pair<flags_t, params_t> argparse(int argc, char** argv) {
 	flags_t flags{
+		{option_flag::CREATE_SNAPSHOT, false},
 		{option_flag::ECHO, false},
 		{option_flag::TEST_PARSER, false}
 	};
 
 	params_t params{
-		{option_param::FILE, ""}
+		{option_param::FILE, ""},
+		{option_param::SNAPSHOT, ""}
 	};
 
 	for (int option_index = 1; option_index < argc; ++option_index) {
@@ -210,6 +255,15 @@ std::pair<flags_t, params_t> argparse(int argc, char** argv) {
 			}
 			params[option_param::FILE] = argv[option_index];
 		}
+		else if (arg == "-s" or arg == "--snapshot") {
+			++option_index;
+			if (option_index == argc) {
+				std::cerr << "Snapshot filename not specified" << std::endl;
+				help();
+				exit(-1);
+			}
+			params[option_param::SNAPSHOT] = argv[option_index];
+		}
 		else if (arg == "-b" or arg == "--break") {
 			Error::enable_break(true);
 		}
@@ -219,6 +273,9 @@ std::pair<flags_t, params_t> argparse(int argc, char** argv) {
 		else if (arg == "--test-parser") {
 			flags[option_flag::TEST_PARSER] = true;
 		}
+		else if (arg == "--create-snapshot") {
+			flags[option_flag::CREATE_SNAPSHOT] = true;
+		}
 		else {
 			std::cerr << "Unused argument: " << arg << std::endl;
 		}
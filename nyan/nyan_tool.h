@@ -2,6 +2,7 @@
 #pragma once
 
 
+#include <string>
 #include <unordered_map>
 
 namespace nyan {
@@ -10,6 +11,7 @@ namespace nyan {
  * boolean flags to be set by cmdline options
  */
 enum class option_flag {
+	CREATE_SNAPSHOT,
 	ECHO,
 	TEST_PARSER
 };
@@ -18,7 +20,8 @@ enum class option_flag {
  * string arguments to be set by cmdline options
  */
 enum class option_param {
-	FILE
+	FILE,
+	SNAPSHOT
 };
 
 using flags_t = std::unordered_map<option_flag, bool>;
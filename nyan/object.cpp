@@ -5,6 +5,7 @@
 #include <unordered_set>
 #include <vector>
 
+#include "ancestry.h"
 #include "c3.h"
 #include "compiler.h"
 #include "database.h"
@@ -12,7 +13,10 @@
 #include "object_info.h"
 #include "object_state.h"
 #include "patch_info.h"
+#include "state_history.h"
+#include "symbol_table.h"
 #include "util.h"
+#include "value_cache.h"
 #include "value/boolean.h"
 #include "value/file.h"
 #include "value/number.h"
@@ -25,17 +29,26 @@
 
 namespace nyan {
 
-Object::Object(const fqon_t &name, const std::shared_ptr<View> &origin)
+Object::Object(obj_id_t id, const std::shared_ptr<View> &origin)
 	:
 	origin{origin},
-	name{name} {}
+	id{id} {}
 
 
 Object::~Object() = default;
 
 
 const fqon_t &Object::get_name() const {
-	return this->name;
+	if (unlikely(not this->origin)) {
+		throw InvalidObjectError{};
+	}
+
+	return this->origin->get_symbols().get_object_name(this->id);
+}
+
+
+obj_id_t Object::get_id() const {
+	return this->id;
 }
 
 
@@ -45,70 +58,165 @@ const std::shared_ptr<View> &Object::get_view() const {
 
 
 ValueHolder Object::get_value(const memberid_t &member, order_t t) const {
-	return this->calculate_value(member, t);
+	return this->get_value(this->get_member_key(member), t);
+}
+
+
+ValueHolder Object::get_value(const MemberKey &key, order_t t) const {
+	if (unlikely(not this->origin)) {
+		throw InvalidObjectError{};
+	}
+
+	View::ReadGuard guard{*this->origin};
+
+	// the value may have been calculated already
+	ValueCache &cache = this->origin->get_value_cache(this->id, t);
+	const ValueHolder *cached = cache.get(key.get_id());
+	if (cached != nullptr) {
+		return *cached;
+	}
+
+	ValueHolder value = this->calculate_value(key, t);
+	cache.insert(key.get_id(), value);
+	return value;
 }
 
 
 value_int_t Object::get_int(const memberid_t &member, order_t t) const {
-	return this->get_number<Int>(member, t);
+	return this->get_int(this->get_member_key(member), t);
+}
+
+
+value_int_t Object::get_int(const MemberKey &key, order_t t) const {
+	return this->get_number<Int>(key, t);
 }
 
 
 value_float_t Object::get_float(const memberid_t &member, order_t t) const {
-	return this->get_number<Float>(member, t);
+	return this->get_float(this->get_member_key(member), t);
+}
+
+
+value_float_t Object::get_float(const MemberKey &key, order_t t) const {
+	return this->get_number<Float>(key, t);
+}
+
+
+std::string Object::get_text(const memberid_t &member, order_t t) const {
+	return this->get_text(this->get_member_key(member), t);
 }
 
 
-const std::string &Object::get_text(const memberid_t &member, order_t t) const {
-	return *this->get<Text>(member, t);
+std::string Object::get_text(const MemberKey &key, order_t t) const {
+	ValueHolder value = this->get_value(key, t);
+	return this->value_as<Text>(key, value).get();
 }
 
 
 bool Object::get_bool(const memberid_t &member, order_t t) const {
-	return *this->get<Boolean>(member, t);
+	return this->get_bool(this->get_member_key(member), t);
+}
+
+
+bool Object::get_bool(const MemberKey &key, order_t t) const {
+	ValueHolder value = this->get_value(key, t);
+	return this->value_as<Boolean>(key, value);
+}
+
+
+set_t Object::get_set(const memberid_t &member, order_t t) const {
+	return this->get_set(this->get_member_key(member), t);
+}
+
+
+set_t Object::get_set(const MemberKey &key, order_t t) const {
+	ValueHolder value = this->get_value(key, t);
+	return this->value_as<Set>(key, value).get();
 }
 
 
-const set_t &Object::get_set(const memberid_t &member, order_t t) const {
-	return this->get<Set>(member, t)->get();
+ordered_set_t Object::get_orderedset(const memberid_t &member, order_t t) const {
+	return this->get_orderedset(this->get_member_key(member), t);
 }
 
 
-const ordered_set_t &Object::get_orderedset(const memberid_t &member, order_t t) const {
-	return this->get<OrderedSet>(member, t)->get();
+ordered_set_t Object::get_orderedset(const MemberKey &key, order_t t) const {
+	ValueHolder value = this->get_value(key, t);
+	return this->value_as<OrderedSet>(key, value).get();
 }
 
 
-const std::string &Object::get_file(const memberid_t &member, order_t t) const {
-	return this->get<Filename>(member, t)->get();
+std::string Object::get_file(const memberid_t &member, order_t t) const {
+	return this->get_file(this->get_member_key(member), t);
+}
+
+
+std::string Object::get_file(const MemberKey &key, order_t t) const {
+	ValueHolder value = this->get_value(key, t);
+	return this->value_as<Filename>(key, value).get();
 }
 
 
 Object Object::get_object(const memberid_t &member, order_t t) const {
-	return *this->get<Object>(member, t);
+	return this->get_object(this->get_member_key(member), t);
+}
+
+
+Object Object::get_object(const MemberKey &key, order_t t) const {
+	return *this->get<Object>(key, t);
 }
 
 
 template <>
-std::shared_ptr<Object> Object::get<Object>(const memberid_t &member, order_t t) const {
-	auto obj_val = this->get<ObjectValue>(member, t);
-	fqon_t fqon = obj_val->get();
+std::shared_ptr<Object> Object::get<Object>(const MemberKey &key, order_t t) const {
+	ValueHolder value = this->get_value(key, t);
+	const ObjectValue &obj_val = this->value_as<ObjectValue>(key, value);
+	const obj_id_t *obj_id = this->origin->get_database().get_info().get_object_id(obj_val.get());
+	if (unlikely(obj_id == nullptr)) {
+		throw InternalError{"object value refers to unknown object"};
+	}
+
 	std::shared_ptr<Object> ret = std::make_shared<Object>(Object::Restricted{},
-	                                                       fqon, this->origin);
+	                                                       *obj_id, this->origin);
 	return ret;
 }
 
 
-ValueHolder Object::calculate_value(const memberid_t &member, order_t t) const {
+MemberKey Object::get_member_key(const memberid_t &member) const {
+	if (unlikely(not this->origin)) {
+		throw InvalidObjectError{};
+	}
+
+	// the member name is unknown or no object stores it.
+	const MemberKey *key = this->origin->get_member_key(member);
+	if (unlikely(key == nullptr)) {
+		throw MemberNotFoundError{this->get_name(), member};
+	}
+
+	return *key;
+}
+
+
+const memberid_t &Object::get_member_name(const MemberKey &key) const {
+	return this->origin->get_symbols().get_member_name(key.get_id());
+}
+
+
+ValueHolder Object::copy_value(const ValueHolder &value) {
+	return value->copy();
+}
+
+
+ValueHolder Object::calculate_value(const MemberKey &key, order_t t) const {
 	using namespace std::string_literals;
 
 	// TODO: don't allow calculating values for patches?
 	// it's impossible as they may have members without =
 
 	// get references to all parentobject-states
-	std::vector<std::shared_ptr<ObjectState>> parents;
+	std::vector<std::shared_ptr<const ObjectState>> parents;
 
-	const std::vector<fqon_t> &linearization = this->get_linearized(t);
+	const std::vector<obj_id_t> &linearization = this->get_linearized_ids(t);
 
 	// find the last value assigning with =
 	// it sets the base value where we apply the modifications then
@@ -118,7 +226,7 @@ ValueHolder Object::calculate_value(const memberid_t &member, order_t t) const {
 	for (auto &obj : linearization) {
 		parents.push_back(this->origin->get_raw(obj, t));
 		const ObjectState *obj_raw = parents.back().get();
-		const Member *obj_member = obj_raw->get(member);
+		const Member *obj_member = obj_raw->get(key);
 		// if the object has the member, check if it's the =
 		if (obj_member != nullptr) {
 			if (obj_member->get_operation() == nyan_op::ASSIGN) {
@@ -133,7 +241,10 @@ ValueHolder Object::calculate_value(const memberid_t &member, order_t t) const {
 	// -> no parent assigned a value.
 	// errors in the data files are detected at load time already.
 	if (unlikely(defined_by >= linearization.size() or base_value == nullptr)) {
-		throw MemberNotFoundError{this->name, member};
+		throw MemberNotFoundError{
+			this->get_name(),
+			this->get_member_name(key)
+		};
 	}
 
 	// if this object defines the value, no aggregation is needed.
@@ -146,7 +257,7 @@ ValueHolder Object::calculate_value(const memberid_t &member, order_t t) const {
 
 	// walk back and apply the value changes
 	while (true) {
-		const Member *change = parents[defined_by]->get(member);
+		const Member *change = parents[defined_by]->get(key);
 		if (change != nullptr) {
 			result->apply(*change);
 		}
@@ -160,51 +271,69 @@ ValueHolder Object::calculate_value(const memberid_t &member, order_t t) const {
 }
 
 
-const std::deque<fqon_t> &Object::get_parents(order_t t) const {
-	return this->get_raw(t)->get_parents();
+std::deque<fqon_t> Object::get_parents(order_t t) const {
+	if (unlikely(not this->origin)) {
+		throw InvalidObjectError{};
+	}
+
+	View::ReadGuard guard{*this->origin};
+	std::shared_ptr<const ObjectState> state = this->get_raw(t);
+	const std::deque<obj_id_t> &parents = state->get_parents();
+	const SymbolTable &symbols = this->origin->get_symbols();
+
+	std::deque<fqon_t> ret;
+	for (auto &parent : parents) {
+		ret.push_back(symbols.get_object_name(parent));
+	}
+	return ret;
 }
 
 
 bool Object::has(const memberid_t &member, order_t t) const {
-	// TODO: cache?
-
-	const std::vector<fqon_t> &lin = this->get_linearized(t);
+	if (unlikely(not this->origin)) {
+		throw InvalidObjectError{};
+	}
 
-	for (auto &obj : lin) {
-		if (this->origin->get_raw(obj, t)->get(member) != nullptr) {
-			return true;
-		}
+	const MemberKey *key = this->origin->get_member_key(member);
+	if (key == nullptr) {
+		return false;
 	}
 
-	return false;
+	return this->has(*key, t);
 }
 
 
-bool Object::extends(fqon_t other_fqon, order_t t) const {
-	if (this->name == other_fqon) {
-		return true;
+bool Object::has(const MemberKey &key, order_t t) const {
+	if (unlikely(not this->origin)) {
+		throw InvalidObjectError{};
 	}
 
-	// TODO cache?
+	View::ReadGuard guard{*this->origin};
+	return this->origin->get_ancestry(this->id, t).has(key.get_id());
+}
 
-	auto &linearization = this->get_linearized(t);
 
-	for (auto &obj : linearization) {
-		if (obj == other_fqon) {
-			return true;
-		}
+bool Object::extends(fqon_t other_fqon, order_t t) const {
+	if (unlikely(not this->origin)) {
+		throw InvalidObjectError{};
 	}
 
-	return false;
+	const obj_id_t *other = this->origin->get_database().get_info().get_object_id(other_fqon);
+	if (other == nullptr) {
+		return false;
+	}
+
+	View::ReadGuard guard{*this->origin};
+	return this->origin->get_ancestry(this->id, t).extends(*other);
 }
 
 
 const ObjectInfo &Object::get_info() const {
-	if (unlikely(not this->name.size())) {
+	if (unlikely(not this->origin)) {
 		throw InvalidObjectError{};
 	}
 
-	const ObjectInfo *ret = this->origin->get_database().get_info().get_object(this->get_name());
+	const ObjectInfo *ret = this->origin->get_database().get_info().get_object(this->id);
 	if (unlikely(ret == nullptr)) {
 		throw InternalError{"object info unavailable for object handle"};
 	}
@@ -223,34 +352,66 @@ const fqon_t *Object::get_target() const {
 	if (unlikely(patch_info == nullptr)) {
 		return nullptr;
 	}
-	return &patch_info->get_target();
+	return &this->origin->get_symbols().get_object_name(patch_info->get_target());
+}
+
+
+std::vector<fqon_t> Object::get_linearized(order_t t) const {
+	if (unlikely(not this->origin)) {
+		throw InvalidObjectError{};
+	}
+
+	View::ReadGuard guard{*this->origin};
+	const std::vector<obj_id_t> &lin = this->get_linearized_ids(t);
+	return this->origin->get_symbols().object_names(lin);
 }
 
 
-const std::vector<fqon_t> &Object::get_linearized(order_t t) const {
-	if (unlikely(not this->name.size())) {
+const std::vector<obj_id_t> &Object::get_linearized_ids(order_t t) const {
+	if (unlikely(not this->origin)) {
 		throw InvalidObjectError{};
 	}
 
-	return this->origin->get_linearization(this->name, t);
+	return this->origin->get_linearization(this->id, t);
 }
 
+
 std::shared_ptr<ObjectNotifier>
 Object::subscribe(const update_cb_t &callback) {
-	if (unlikely(not this->name.size())) {
+	if (unlikely(not this->origin)) {
 		throw InvalidObjectError{};
 	}
 
-	return this->origin->create_notifier(this->name, callback);
+	return this->origin->create_notifier(this->id, callback);
+}
+
+
+std::shared_ptr<ObjectNotifier>
+Object::subscribe(const std::vector<memberid_t> &members,
+                  const update_cb_t &callback) {
+	if (unlikely(not this->origin)) {
+		throw InvalidObjectError{};
+	}
+
+	std::unordered_set<member_id_t> member_ids;
+	for (auto &member : members) {
+		const MemberKey *key = this->origin->get_member_key(member);
+		if (unlikely(key == nullptr)) {
+			throw MemberNotFoundError{this->get_name(), member};
+		}
+		member_ids.insert(key->get_id());
+	}
+
+	return this->origin->create_notifier(this->id, callback, std::move(member_ids));
 }
 
 
-const std::shared_ptr<ObjectState> &Object::get_raw(order_t t) const {
-	if (unlikely(not this->name.size())) {
+std::shared_ptr<const ObjectState> Object::get_raw(order_t t) const {
+	if (unlikely(not this->origin)) {
 		throw InvalidObjectError{};
 	}
 
-	return this->origin->get_raw(this->name, t);
+	return this->origin->get_raw(this->id, t);
 }
 
 } // namespace nyan
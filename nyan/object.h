@@ -11,6 +11,7 @@
 
 #include "api_error.h"
 #include "config.h"
+#include "member_key.h"
 #include "value/set_types.h"
 #include "value/value_holder.h"
 #include "object_notifier_types.h"
@@ -37,7 +38,7 @@ protected:
 	 * Create a nyan-object handle. This is never invoked by the user,
 	 * as handles are generated internally and then handed over.
 	 */
-	Object(const fqon_t &name, const std::shared_ptr<View> &origin);
+	Object(obj_id_t id, const std::shared_ptr<View> &origin);
 	class Restricted {};
 
 public:
@@ -49,8 +50,8 @@ public:
 	// This constructor is public, but can't be invoked since the Restricted
 	// class is not available. We use this to be able to invoke make_shared
 	// within this class, but not outside of it.
-	Object(Object::Restricted, const fqon_t &name, const std::shared_ptr<View> &origin)
-		: Object(name, origin) {};
+	Object(Object::Restricted, obj_id_t id, const std::shared_ptr<View> &origin)
+		: Object(id, origin) {};
 	~Object();
 
 	/**
@@ -58,6 +59,11 @@ public:
 	 */
 	const fqon_t &get_name() const;
 
+	/**
+	 * Return the interned id of this object in the database.
+	 */
+	obj_id_t get_id() const;
+
 	/**
 	 * Return the view this object was retrieved from.
 	 */
@@ -65,47 +71,75 @@ public:
 
 	/**
 	 * Get a calculated member value.
+	 * The value is cached in the view until the object is patched,
+	 * it is shared with the cache and must not be modified.
 	 */
 	ValueHolder get_value(const memberid_t &member, order_t t=LATEST_T) const;
 
+	/**
+	 * Get a calculated member value by a prepared member key.
+	 * This avoids the lookup of the member name.
+	 * Obtain the key with View::get_member_key.
+	 */
+	ValueHolder get_value(const MemberKey &key, order_t t=LATEST_T) const;
+
 	/**
 	 * Invokes the get_value function and then does a cast.
 	 * There's a special variant for T=nyan::Object which creates
 	 * an object handle.
-	 *
-	 * TODO: either return a stored variant reference or the shared ptr of the holder
+	 * The returned value is a copy, so it can be modified
+	 * without affecting the cached value.
 	 */
 	template <typename T>
 	std::shared_ptr<T> get(const memberid_t &member, order_t t=LATEST_T) const;
 
+	template <typename T>
+	std::shared_ptr<T> get(const MemberKey &key, order_t t=LATEST_T) const;
+
 	template<typename T, typename ret=typename T::storage_type>
 	ret get_number(const memberid_t &member, order_t t=LATEST_T) const;
 
+	template<typename T, typename ret=typename T::storage_type>
+	ret get_number(const MemberKey &key, order_t t=LATEST_T) const;
+
 	value_int_t get_int(const memberid_t &member, order_t t=LATEST_T) const;
+	value_int_t get_int(const MemberKey &key, order_t t=LATEST_T) const;
 
 	value_float_t get_float(const memberid_t &member, order_t t=LATEST_T) const;
+	value_float_t get_float(const MemberKey &key, order_t t=LATEST_T) const;
 
-	const std::string &get_text(const memberid_t &member, order_t t=LATEST_T) const;
+	/**
+	 * The container and text getters return copies, as the cached
+	 * value they are taken from is dropped when the object is patched.
+	 */
+	std::string get_text(const memberid_t &member, order_t t=LATEST_T) const;
+	std::string get_text(const MemberKey &key, order_t t=LATEST_T) const;
 
 	bool get_bool(const memberid_t &member, order_t t=LATEST_T) const;
+	bool get_bool(const MemberKey &key, order_t t=LATEST_T) const;
 
-	const set_t &get_set(const memberid_t &member, order_t t=LATEST_T) const;
+	set_t get_set(const memberid_t &member, order_t t=LATEST_T) const;
+	set_t get_set(const MemberKey &key, order_t t=LATEST_T) const;
 
-	const ordered_set_t &get_orderedset(const memberid_t &member, order_t t=LATEST_T) const;
+	ordered_set_t get_orderedset(const memberid_t &member, order_t t=LATEST_T) const;
+	ordered_set_t get_orderedset(const MemberKey &key, order_t t=LATEST_T) const;
 
-	const std::string &get_file(const memberid_t &member, order_t t=LATEST_T) const;
+	std::string get_file(const memberid_t &member, order_t t=LATEST_T) const;
+	std::string get_file(const MemberKey &key, order_t t=LATEST_T) const;
 
 	Object get_object(const memberid_t &fqon, order_t t=LATEST_T) const;
+	Object get_object(const MemberKey &key, order_t t=LATEST_T) const;
 
 	/**
 	 * Return the parents of the object.
 	 */
-	const std::deque<fqon_t> &get_parents(order_t t=LATEST_T) const;
+	std::deque<fqon_t> get_parents(order_t t=LATEST_T) const;
 
 	/**
 	 * Test if this object has a member of given name.
 	 */
 	bool has(const memberid_t &member, order_t t=LATEST_T) const;
+	bool has(const MemberKey &key, order_t t=LATEST_T) const;
 
 	/**
 	 * Test if this object is a child of the given parent.
@@ -133,7 +167,7 @@ public:
 	/**
 	 * Return the linearization of this object and its parent objects.
 	 */
-	const std::vector<fqon_t> &get_linearized(order_t t=LATEST_T) const;
+	std::vector<fqon_t> get_linearized(order_t t=LATEST_T) const;
 
 	/**
 	 * Register a function that will be called when this object changes in its current view.
@@ -144,18 +178,58 @@ public:
 	 */
 	std::shared_ptr<ObjectNotifier> subscribe(const update_cb_t &callback);
 
+	/**
+	 * Register a function that will be called when the value of one
+	 * of the given members of this object may have changed.
+	 * Patches of other members don't trigger it.
+	 */
+	std::shared_ptr<ObjectNotifier> subscribe(const std::vector<memberid_t> &members,
+	                                          const update_cb_t &callback);
+
 protected:
 
 	/**
 	 * Return the object state for a given time.
+	 * States are shared between the states of the view history
+	 * and its copies, so they are only handed out as const.
+	 */
+	std::shared_ptr<const ObjectState> get_raw(order_t t=LATEST_T) const;
+
+	/**
+	 * Return the ids of this object and its linearized parents.
 	 */
-	const std::shared_ptr<ObjectState> &get_raw(order_t t=LATEST_T) const;
+	const std::vector<obj_id_t> &get_linearized_ids(order_t t=LATEST_T) const;
+
+	/**
+	 * Return the lookup key for a member name.
+	 * Throws MemberNotFoundError if no object has this member.
+	 */
+	MemberKey get_member_key(const memberid_t &member) const;
+
+	/**
+	 * Return the name of a member for error messages.
+	 */
+	const memberid_t &get_member_name(const MemberKey &key) const;
+
+	/**
+	 * Cast a member value to the requested value type.
+	 * Throws a MemberTypeError if the value has another type.
+	 */
+	template <typename T>
+	const T &value_as(const MemberKey &key, const ValueHolder &value) const;
+
+	/**
+	 * Return a copy of a value the caller may modify.
+	 * Values are shared with the value cache, so they are not
+	 * handed out directly.
+	 */
+	static ValueHolder copy_value(const ValueHolder &value);
 
 	/**
 	 * Calculate a member value of this object.
 	 * This performs tree traversal for value calculations.
 	 */
-	ValueHolder calculate_value(const memberid_t &member, order_t t=LATEST_T) const;
+	ValueHolder calculate_value(const MemberKey &key, order_t t=LATEST_T) const;
 
 	/**
 	 * View the object was created from.
@@ -163,35 +237,59 @@ protected:
 	std::shared_ptr<View> origin;
 
 	/**
-	 * The name of this object.
+	 * The id of this object, its name is stored in the symbol table.
 	 */
-	fqon_t name;
+	obj_id_t id = 0;
 };
 
 
 // TODO: use concepts...
 template <typename T>
 std::shared_ptr<T> Object::get(const memberid_t &member, order_t t) const {
-	std::shared_ptr<Value> value = this->get_value(member, t).get_ptr();
-	auto ret = std::dynamic_pointer_cast<T>(value);
+	return this->get<T>(this->get_member_key(member), t);
+}
+
+
+template <typename T>
+std::shared_ptr<T> Object::get(const MemberKey &key, order_t t) const {
+	ValueHolder value = this->get_value(key, t);
+
+	// check the type first, so only valid values are copied.
+	this->value_as<T>(key, value);
+
+	return std::static_pointer_cast<T>(copy_value(value).get_ptr());
+}
+
+
+template <typename T>
+const T &Object::value_as(const MemberKey &key, const ValueHolder &value) const {
+	auto ret = dynamic_cast<const T *>(value.get_value());
 
 	if (not ret) {
 		throw MemberTypeError{
-			this->name,
-			member,
-			util::typestring(value.get()),
+			this->get_name(),
+			this->get_member_name(key),
+			util::typestring(value.get_value()),
 			util::typestring<T>()
 		};
 	}
 
-	return ret;
+	return *ret;
 }
 
 
 // TODO: use concepts...
 template<typename T, typename ret>
 ret Object::get_number(const memberid_t &member, order_t t) const {
-	return *this->get<T>(member, t);
+	return this->get_number<T, ret>(this->get_member_key(member), t);
+}
+
+
+template<typename T, typename ret>
+ret Object::get_number(const MemberKey &key, order_t t) const {
+	// numbers are stored inline, so this doesn't allocate.
+	ValueHolder value = this->get_value(key, t);
+	return this->value_as<T>(key, value);
 }
 
 
@@ -200,6 +298,6 @@ ret Object::get_number(const memberid_t &member, order_t t) const {
  * from the ObjectValue that is stored in a value.
  */
 template <>
-std::shared_ptr<Object> Object::get<Object>(const memberid_t &member, order_t t) const;
+std::shared_ptr<Object> Object::get<Object>(const MemberKey &key, order_t t) const;
 
 } // namespace nyan
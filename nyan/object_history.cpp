@@ -2,37 +2,111 @@
 
 #include "object_history.h"
 
-#include "compiler.h"
-
 
 namespace nyan {
 
+/**
+ * Estimated memory used by a curve entry and the data it owns.
+ * Allocator overhead is not included.
+ */
+template <typename T>
+static size_t entry_size(const std::vector<T> &value) {
+	return sizeof(std::pair<order_t, std::vector<T>>) + value.capacity() * sizeof(T);
+}
 
-void ObjectHistory::insert_change(const order_t time) {
-	auto it = this->changes.lower_bound(time);
+template <typename K, typename V>
+static size_t entry_size(const std::unordered_map<K, V> &value) {
+	return (sizeof(std::pair<order_t, std::unordered_map<K, V>>)
+	        + value.size() * (sizeof(std::pair<const K, V>) + sizeof(void *))
+	        + value.bucket_count() * sizeof(void *));
+}
 
-	// remove all newer entries
-	this->changes.erase(it, std::end(this->changes));
+template <typename K>
+static size_t entry_size(const std::unordered_set<K> &value) {
+	return (sizeof(std::pair<order_t, std::unordered_set<K>>)
+	        + value.size() * (sizeof(K) + sizeof(void *))
+	        + value.bucket_count() * sizeof(void *));
+}
 
-	auto ret = this->changes.insert(time);
-	if (unlikely(ret.second == false)) {
-		throw InternalError{"did not insert change point, it existed before"};
+static size_t entry_size(const std::shared_ptr<ValueCache> &value) {
+	size_t size = sizeof(std::pair<order_t, std::shared_ptr<ValueCache>>);
+
+	// the cache is only released if no other history shares it.
+	if (value.use_count() == 1) {
+		size += (sizeof(ValueCache)
+		         + value->size() * (sizeof(std::pair<const member_id_t, ValueHolder>)
+		                            + sizeof(void *)));
 	}
+	return size;
+}
+
+static size_t entry_size(const order_t &) {
+	return sizeof(std::pair<order_t, order_t>);
+}
+
+static size_t entry_size(const Ancestry &value) {
+	return sizeof(std::pair<order_t, Ancestry>) - sizeof(Ancestry) + value.get_size();
+}
+
+
+void ObjectHistory::insert_change(const order_t time) {
+	// remove all newer entries
+	this->changes.insert_drop(time, order_t{time});
 }
 
 
 std::optional<order_t> ObjectHistory::last_change_before(order_t t) const {
-	// get the iterator to the first element greater than t
-	auto it = this->changes.upper_bound(t);
-	if (it == std::begin(this->changes)) {
+	const order_t *change = this->changes.at_find(t);
+	if (change == nullptr) {
 		// the requested ordering point is not in this history
 		return {};
 	}
 
-	// go one back, this is the item we're looking for
-	--it;
+	return *change;
+}
+
+
+void ObjectHistory::drop_after(order_t t) {
+	this->changes.drop_after(t);
+	this->values.drop_after(t);
+	this->linearizations.drop_after(t);
+	this->children.drop_after(t);
+	this->descendants.drop_after(t);
+	this->ancestries.drop_after(t);
+}
+
+
+size_t ObjectHistory::compact_before(order_t horizon) {
+	size_t reclaimed = 0;
+
+	auto count_dropped = [&reclaimed] (const auto &value) {
+		reclaimed += entry_size(value);
+	};
+
+	this->values.compact_before(horizon, DEFAULT_T, count_dropped);
+	this->linearizations.compact_before(horizon, DEFAULT_T, count_dropped);
+	this->children.compact_before(horizon, DEFAULT_T, count_dropped);
+	this->descendants.compact_before(horizon, DEFAULT_T, count_dropped);
+	this->ancestries.compact_before(horizon, DEFAULT_T, count_dropped);
+
+	// the folded object state is stored at DEFAULT_T.
+	this->changes.compact_before(horizon, DEFAULT_T, count_dropped);
+	order_t *first_change = this->changes.at_exact(DEFAULT_T);
+	if (first_change != nullptr) {
+		*first_change = DEFAULT_T;
+	}
+
+	return reclaimed;
+}
+
 
-	return *it;
+bool ObjectHistory::empty() const {
+	return (this->changes.empty() and
+	        this->values.empty() and
+	        this->linearizations.empty() and
+	        this->children.empty() and
+	        this->descendants.empty() and
+	        this->ancestries.empty());
 }
 
 } // namespace nyan
@@ -1,14 +1,17 @@
 // Copyright 2017-2019 the nyan authors, LGPLv3+. See copying.md for legal info.
 #pragma once
 
+#include <memory>
 #include <optional>
-#include <set>
+#include <unordered_map>
 #include <unordered_set>
 #include <utility>
 #include <vector>
 
+#include "ancestry.h"
 #include "config.h"
 #include "curve.h"
+#include "value_cache.h"
 
 
 namespace nyan {
@@ -37,25 +40,67 @@ public:
 	 */
 	std::optional<order_t> last_change_before(order_t t) const;
 
-	// TODO: curve for value cache: memberid_t => curve<valueholder>
+	/**
+	 * Remove all records later than t:
+	 * changes, cached values, linearizations, children, descendants
+	 * and ancestries.
+	 */
+	void drop_after(order_t t);
+
+	/**
+	 * Fold all records earlier than the horizon into one record
+	 * at DEFAULT_T, which holds the latest of them.
+	 * Returns the estimated number of bytes released.
+	 */
+	size_t compact_before(order_t horizon);
+
+	/**
+	 * Check if this history has no records at all.
+	 */
+	bool empty() const;
+
+	/**
+	 * Value cache for the members of this object.
+	 * A new empty cache is inserted whenever the object or one
+	 * of its parents is patched, the values are then calculated on demand.
+	 * So each cache is valid from its time until the next entry.
+	 * Copies of the history share the caches, the values of the
+	 * shared entries are the same in all of them.
+	 */
+	Curve<std::shared_ptr<ValueCache>> values;
 
 	/**
 	 * Stores the parent linearization of this object over time.
 	 */
-	Curve<std::vector<fqon_t>> linearizations;
+	Curve<std::vector<obj_id_t>> linearizations;
 
 	/**
 	 * Stores the direct children an object has over time.
 	 */
-	Curve<std::unordered_set<fqon_t>> children;
+	Curve<std::unordered_set<obj_id_t>> children;
+
+	/**
+	 * Stores all transitive children of this object over time,
+	 * sorted by id.
+	 */
+	Curve<std::vector<obj_id_t>> descendants;
+
+	/**
+	 * Stores the ancestors and the present members of this object
+	 * over time. Updated with the linearization and whenever the
+	 * object or a parent gets a new member.
+	 */
+	Curve<Ancestry> ancestries;
 
 protected:
 	/**
 	 * History of order points where this object was modified.
 	 * This is used to quickly find the matching order for an
 	 * object state in the state history.
+	 * Each keyframe stores its own time, as the curve lookups
+	 * only return the values.
 	 */
-	std::set<order_t> changes;
+	Curve<order_t> changes;
 };
 
 
@@ -7,7 +7,10 @@
 #include "lang_error.h"
 #include "util.h"
 #include "patch_info.h"
+#include "patch_plan.h"
 #include "state.h"
+#include "symbol_table.h"
+#include "value_cache.h"
 
 
 namespace nyan {
@@ -15,7 +18,8 @@ namespace nyan {
 ObjectInfo::ObjectInfo(const Location &location)
 	:
 	location{location},
-	initial_patch{false} {}
+	initial_patch{false},
+	initial_values{std::make_shared<ValueCache>()} {}
 
 
 const Location &ObjectInfo::get_location() const {
@@ -23,7 +27,7 @@ const Location &ObjectInfo::get_location() const {
 }
 
 
-MemberInfo &ObjectInfo::add_member(const memberid_t &name,
+MemberInfo &ObjectInfo::add_member(member_id_t name,
                                    MemberInfo &&member) {
 
 	// copy the location so it's still valid if the insert fails.
@@ -51,7 +55,7 @@ const ObjectInfo::member_info_t &ObjectInfo::get_members() const {
 }
 
 
-const MemberInfo *ObjectInfo::get_member(const memberid_t &name) const {
+const MemberInfo *ObjectInfo::get_member(member_id_t name) const {
 	auto it = this->member_info.find(name);
 
 	if (it == std::end(this->member_info)) {
@@ -94,33 +98,68 @@ const std::vector<InheritanceChange> &ObjectInfo::get_inheritance_change() const
 }
 
 
-void ObjectInfo::set_linearization(std::vector<fqon_t> &&lin) {
+void ObjectInfo::set_patch_plan(std::shared_ptr<const PatchPlan> &&plan) {
+	this->patch_plan = std::move(plan);
+}
+
+
+const PatchPlan *ObjectInfo::get_patch_plan() const {
+	return this->patch_plan.get();
+}
+
+
+ValueCache &ObjectInfo::get_initial_values() const {
+	return *this->initial_values;
+}
+
+
+void ObjectInfo::set_linearization(std::vector<obj_id_t> &&lin) {
 	this->initial_linearization = std::move(lin);
 }
 
 
-const std::vector<fqon_t> &ObjectInfo::get_linearization() const {
+const std::vector<obj_id_t> &ObjectInfo::get_linearization() const {
 	return this->initial_linearization;
 }
 
 
-void ObjectInfo::set_children(std::unordered_set<fqon_t> &&children) {
+void ObjectInfo::set_children(std::unordered_set<obj_id_t> &&children) {
 	this->initial_children = std::move(children);
 }
 
 
-const std::unordered_set<fqon_t> &ObjectInfo::get_children() const {
+const std::unordered_set<obj_id_t> &ObjectInfo::get_children() const {
 	return this->initial_children;
 }
 
 
-std::string ObjectInfo::str() const {
+void ObjectInfo::set_descendants(std::vector<obj_id_t> &&descendants) {
+	this->initial_descendants = std::move(descendants);
+}
+
+
+const std::vector<obj_id_t> &ObjectInfo::get_descendants() const {
+	return this->initial_descendants;
+}
+
+
+void ObjectInfo::set_ancestry(Ancestry &&ancestry) {
+	this->initial_ancestry = std::move(ancestry);
+}
+
+
+const Ancestry &ObjectInfo::get_ancestry() const {
+	return this->initial_ancestry;
+}
+
+
+std::string ObjectInfo::str(const SymbolTable &symbols) const {
 	std::ostringstream builder;
 
 	builder << "ObjectInfo";
 
 	if (this->is_patch()) {
-		builder << " " << this->patch_info->str();
+		builder << " " << this->patch_info->str(symbols);
 	}
 
 	if (this->inheritance_change.size() > 0) {
@@ -136,11 +175,11 @@ std::string ObjectInfo::str() const {
 
 			switch (change.get_type()) {
 			case inher_change_t::ADD_FRONT:
-				builder << change.get_target() << "+";
+				builder << symbols.get_object_name(change.get_target()) << "+";
 				break;
 
 			case inher_change_t::ADD_BACK:
-				builder << "+" << change.get_target();
+				builder << "+" << symbols.get_object_name(change.get_target());
 				break;
 
 			default:
@@ -161,7 +200,7 @@ std::string ObjectInfo::str() const {
 		const auto &memberid = it.first;
 		const auto &memberinfo = it.second;
 
-		builder << " -> " << memberid;
+		builder << " -> " << symbols.get_member_name(memberid);
 		builder << " : " << memberinfo.str() << std::endl;
 	}
 
@@ -1,10 +1,12 @@
 // Copyright 2017-2017 the nyan authors, LGPLv3+. See copying.md for legal info.
 #pragma once
 
+#include <memory>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
+#include "ancestry.h"
 #include "config.h"
 #include "inheritance_change.h"
 #include "location.h"
@@ -15,7 +17,10 @@
 namespace nyan {
 
 class PatchInfo;
+class PatchPlan;
 class State;
+class SymbolTable;
+class ValueCache;
 
 
 /**
@@ -24,20 +29,20 @@ class State;
  */
 class ObjectInfo {
 public:
-	using member_info_t = std::unordered_map<memberid_t, MemberInfo>;
+	using member_info_t = std::unordered_map<member_id_t, MemberInfo>;
 
 	explicit ObjectInfo(const Location &location);
 	~ObjectInfo() = default;
 
 	const Location &get_location() const;
 
-	MemberInfo &add_member(const memberid_t &name,
+	MemberInfo &add_member(member_id_t name,
 	                       MemberInfo &&member);
 
 	member_info_t &get_members();
 	const member_info_t &get_members() const;
 
-	const MemberInfo *get_member(const memberid_t &name) const;
+	const MemberInfo *get_member(member_id_t name) const;
 
 	PatchInfo &add_patch(const std::shared_ptr<PatchInfo> &info, bool initial);
 	const std::shared_ptr<PatchInfo> &get_patch() const;
@@ -45,16 +50,43 @@ public:
 	void add_inheritance_change(InheritanceChange &&change);
 	const std::vector<InheritanceChange> &get_inheritance_change() const;
 
-	void set_linearization(std::vector<fqon_t> &&lin);
-	const std::vector<fqon_t> &get_linearization() const;
+	void set_linearization(std::vector<obj_id_t> &&lin);
+	const std::vector<obj_id_t> &get_linearization() const;
 
-	void set_children(std::unordered_set<fqon_t> &&children);
-	const std::unordered_set<fqon_t> &get_children() const;
+	void set_children(std::unordered_set<obj_id_t> &&children);
+	const std::unordered_set<obj_id_t> &get_children() const;
+
+	/**
+	 * Store all transitive children of the object, sorted by id.
+	 */
+	void set_descendants(std::vector<obj_id_t> &&descendants);
+	const std::vector<obj_id_t> &get_descendants() const;
+
+	void set_ancestry(Ancestry &&ancestry);
+	const Ancestry &get_ancestry() const;
+
+	/**
+	 * Store the precompiled application of this patch.
+	 */
+	void set_patch_plan(std::shared_ptr<const PatchPlan> &&plan);
+
+	/**
+	 * Return the precompiled application of this patch,
+	 * or nullptr if it has to be applied object by object.
+	 */
+	const PatchPlan *get_patch_plan() const;
+
+	/**
+	 * Return the cache for the member values of the object
+	 * as it was loaded. The views use it for the times
+	 * the object and its parents are unchanged in them.
+	 */
+	ValueCache &get_initial_values() const;
 
 	bool is_patch() const;
 	bool is_initial_patch() const;
 
-	std::string str() const;
+	std::string str(const SymbolTable &symbols) const;
 
 protected:
 	/**
@@ -74,6 +106,11 @@ protected:
 	 */
 	std::shared_ptr<PatchInfo> patch_info;
 
+	/**
+	 * Precompiled patch application, if the patch can't change.
+	 */
+	std::shared_ptr<const PatchPlan> patch_plan;
+
 	/**
 	 * List of objects to add to the patch target.
 	 */
@@ -87,12 +124,27 @@ protected:
 	/**
 	 * Linearizations for the object when it was initially loaded.
 	 */
-	std::vector<fqon_t> initial_linearization;
+	std::vector<obj_id_t> initial_linearization;
 
 	/**
 	 * Direct children of the object at load time.
 	 */
-	std::unordered_set<fqon_t> initial_children;
+	std::unordered_set<obj_id_t> initial_children;
+
+	/**
+	 * All transitive children of the object at load time, sorted by id.
+	 */
+	std::vector<obj_id_t> initial_descendants;
+
+	/**
+	 * Ancestors and members of the object at load time.
+	 */
+	Ancestry initial_ancestry;
+
+	/**
+	 * Member values of the object at load time, calculated on demand.
+	 */
+	std::shared_ptr<ValueCache> initial_values;
 };
 
 
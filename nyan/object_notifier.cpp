@@ -7,9 +7,11 @@
 
 namespace nyan {
 
-ObjectNotifierHandle::ObjectNotifierHandle(const update_cb_t &func)
+ObjectNotifierHandle::ObjectNotifierHandle(const update_cb_t &func,
+                                           std::unordered_set<member_id_t> &&members)
 	:
-	func{func} {}
+	func{func},
+	members{std::move(members)} {}
 
 
 void ObjectNotifierHandle::fire(order_t t, const fqon_t &fqon, const ObjectState &state) const {
@@ -17,17 +19,27 @@ void ObjectNotifierHandle::fire(order_t t, const fqon_t &fqon, const ObjectState
 }
 
 
-ObjectNotifier::ObjectNotifier(const fqon_t &fqon,
+bool ObjectNotifierHandle::is_interested(const changed_members &changes) const {
+	if (this->members.empty()) {
+		return true;
+	}
+
+	return changes.contains_any(this->members);
+}
+
+
+ObjectNotifier::ObjectNotifier(obj_id_t obj,
                                const update_cb_t &func,
+                               std::unordered_set<member_id_t> &&members,
                                const std::shared_ptr<View> &view)
 	:
-	fqon{fqon},
+	obj{obj},
 	view{view},
-	handle{std::make_shared<ObjectNotifierHandle>(func)} {}
+	handle{std::make_shared<ObjectNotifierHandle>(func, std::move(members))} {}
 
 
 ObjectNotifier::~ObjectNotifier() {
-	this->view->deregister_notifier(this->fqon, this->handle);
+	this->view->deregister_notifier(this->obj, this->handle);
 }
 
 
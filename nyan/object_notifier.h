@@ -4,7 +4,9 @@
 #include <cstdint>
 #include <functional>
 #include <memory>
+#include <unordered_set>
 
+#include "change_tracker.h"
 #include "object_notifier_types.h"
 
 
@@ -17,23 +19,35 @@ class View;
  */
 class ObjectNotifierHandle {
 public:
-	ObjectNotifierHandle(const update_cb_t &func);
+	ObjectNotifierHandle(const update_cb_t &func,
+	                     std::unordered_set<member_id_t> &&members);
 
 	void fire(order_t t, const fqon_t &fqon, const ObjectState &state) const;
 
+	/**
+	 * Check if the callback has to be called for the changed members.
+	 */
+	bool is_interested(const changed_members &changes) const;
+
 protected:
 	/**
 	 * The user function which is called when the object is changed.
 	 */
 	update_cb_t func;
+
+	/**
+	 * Members whose changes are reported, all if empty.
+	 */
+	std::unordered_set<member_id_t> members;
 };
 
 
 class ObjectNotifier {
 public:
 
-	ObjectNotifier(const fqon_t &fqon,
+	ObjectNotifier(obj_id_t obj,
 	               const update_cb_t &func,
+	               std::unordered_set<member_id_t> &&members,
 	               const std::shared_ptr<View> &view);
 	~ObjectNotifier();
 
@@ -43,7 +57,7 @@ protected:
 	/**
 	 * Which object the notifier is for.
 	 */
-	fqon_t fqon;
+	obj_id_t obj;
 
 	/**
 	 * View this notifier is active in.
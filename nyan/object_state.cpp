@@ -8,13 +8,15 @@
 #include "change_tracker.h"
 #include "compiler.h"
 #include "object_info.h"
+#include "patch_plan.h"
+#include "symbol_table.h"
 #include "util.h"
 
 
 namespace nyan {
 
 
-ObjectState::ObjectState(std::deque<fqon_t> &&parents)
+ObjectState::ObjectState(std::deque<obj_id_t> &&parents)
 	:
 	parents{std::move(parents)} {}
 
@@ -23,58 +25,15 @@ void ObjectState::apply(const std::shared_ptr<ObjectState> &mod,
                         const ObjectInfo &mod_info,
                         ObjectChanges &tracker) {
 
-	const auto &inher_changes = mod_info.get_inheritance_change();
-	if (inher_changes.size() > 0) {
-		for (auto &change : inher_changes) {
-
-			bool parent_exists = (
-				std::find(
-					std::begin(this->parents),
-					std::end(this->parents),
-					change.get_target()
-				) != std::end(this->parents)
-			);
-
-			// only add the parent if it does not exist.
-			// maybe we may want to relocate it in the future?
-			if (not parent_exists) {
-				switch (change.get_type()) {
-				case inher_change_t::ADD_FRONT:
-					this->parents.push_front(change.get_target());
-					tracker.add_parent(change.get_target());
-					break;
-				case inher_change_t::ADD_BACK:
-					this->parents.push_back(change.get_target());
-					tracker.add_parent(change.get_target());
-					break;
-				default:
-					throw InternalError{"unsupported inheritance change type"};
-				}
-			}
-		}
+	for (auto &change : mod_info.get_inheritance_change()) {
+		this->apply_parent_change(change, tracker);
 	}
 
 	// change each member in this object by the member of the patch.
-	// other->members: maps memberid_t name => Member
+	// other->members: map of slot => (MemberKey, Member)
 	for (auto &it : mod->members) {
-		auto search = this->members.find(it.first);
-		if (search == std::end(this->members)) {
-			// copy the member from the modification object,
-			// if it is a patch.
-			// that way a child object without the member
-			// can get the modifications.
-			if (likely(mod_info.is_patch())) {
-				this->members.emplace(it.first, it.second);
-			}
-			else {
-				throw InternalError{
-					"a non-patch tried to change a nonexisting member"
-				};
-			}
-		}
-		else {
-			search->second.apply(it.second);
-		}
+		this->apply_member_change(it.second.first, *it.second.second,
+		                          mod_info.is_patch(), tracker);
 
 		// TODO optimization: we could now calculate the resulting value!
 		// TODO: invalidate value cache with the change tracker
@@ -82,50 +41,127 @@ void ObjectState::apply(const std::shared_ptr<ObjectState> &mod,
 }
 
 
+void ObjectState::apply(const PatchPlan &plan, ObjectChanges &tracker) {
+	for (auto &change : plan.get_parent_changes()) {
+		this->apply_parent_change(change, tracker);
+	}
+
+	for (auto &change : plan.get_member_changes()) {
+		this->apply_member_change(change.key, *change.change, change.may_add, tracker);
+	}
+}
+
+
+void ObjectState::apply_parent_change(const InheritanceChange &change,
+                                      ObjectChanges &tracker) {
+	bool parent_exists = (
+		std::find(
+			std::begin(this->parents),
+			std::end(this->parents),
+			change.get_target()
+		) != std::end(this->parents)
+	);
+
+	// only add the parent if it does not exist.
+	// maybe we may want to relocate it in the future?
+	if (parent_exists) {
+		return;
+	}
+
+	switch (change.get_type()) {
+	case inher_change_t::ADD_FRONT:
+		this->parents.push_front(change.get_target());
+		tracker.add_parent(change.get_target());
+		break;
+	case inher_change_t::ADD_BACK:
+		this->parents.push_back(change.get_target());
+		tracker.add_parent(change.get_target());
+		break;
+	default:
+		throw InternalError{"unsupported inheritance change type"};
+	}
+}
+
+
+void ObjectState::apply_member_change(const MemberKey &key,
+                                      const Member &change,
+                                      bool may_add,
+                                      ObjectChanges &tracker) {
+	tracker.add_member(key.get_id());
+
+	Member *search = this->get(key);
+	if (search == nullptr) {
+		// copy the member from the modification object,
+		// if it is a patch.
+		// that way a child object without the member
+		// can get the modifications.
+		if (likely(may_add)) {
+			this->add_member(key, Member{change});
+		}
+		else {
+			throw InternalError{
+				"a non-patch tried to change a nonexisting member"
+			};
+		}
+	}
+	else {
+		search->apply(change);
+	}
+}
+
+
 std::shared_ptr<ObjectState> ObjectState::copy() const {
 	return std::make_shared<ObjectState>(*this);
 }
 
 
-const std::deque<fqon_t> &ObjectState::get_parents() const {
+const std::deque<obj_id_t> &ObjectState::get_parents() const {
 	return this->parents;
 }
 
 
-bool ObjectState::has(const memberid_t &name) const {
-	return this->members.find(name) != std::end(this->members);
+bool ObjectState::has(const MemberKey &key) const {
+	return this->find(key) != 0;
 }
 
 
-Member *ObjectState::get(const memberid_t &name) {
-	auto it = this->members.find(name);
-	if (it == std::end(this->members)) {
+Member *ObjectState::get(const MemberKey &key) {
+	uint32_t pos = this->find(key);
+	if (pos == 0) {
 		return nullptr;
 	}
-	return &it->second;
+
+	// copy the path to the member in the storage.
+	member_entry_t *entry = this->members.get_writable(pos - 1);
+
+	// and the member itself, if other states still use it.
+	if (entry->second.use_count() > 1) {
+		entry->second = std::make_shared<Member>(*entry->second);
+	}
+
+	return entry->second.get();
 }
 
 
-// Thanks C++, always redundancy free!
-const Member *ObjectState::get(const memberid_t &name) const {
-	auto it = this->members.find(name);
-	if (it == std::end(this->members)) {
+const Member *ObjectState::get(const MemberKey &key) const {
+	uint32_t pos = this->find(key);
+	if (pos == 0) {
 		return nullptr;
 	}
-	return &it->second;
+	return this->members.get(pos - 1)->second.get();
 }
 
 
-const std::unordered_map<memberid_t, Member> &ObjectState::get_members() const {
+const ObjectState::members_t &ObjectState::get_members() const {
 	return this->members;
 }
 
 
-std::string ObjectState::str() const {
+std::string ObjectState::str(const SymbolTable &symbols) const {
 	std::ostringstream builder;
 
 	builder << "ObjectState("
-	        << util::strjoin(", ", this->parents)
+	        << util::strjoin(", ", symbols.object_names(this->parents))
 	        << ")"
 	        << std::endl;
 
@@ -134,16 +170,48 @@ std::string ObjectState::str() const {
 	}
 
 	for (auto &it : this->members) {
-		builder << "    " << it.first
-		        << " -> " << it.second.str() << std::endl;
+		builder << "    " << symbols.get_member_name(it.second.first.get_id())
+		        << " -> " << it.second.second->str() << std::endl;
 	}
 
 	return builder.str();
 }
 
 
-void ObjectState::set_members(std::unordered_map<memberid_t, Member> &&members) {
-	this->members = std::move(members);
+Member &ObjectState::add_member(const MemberKey &key, Member &&member) {
+	uint32_t slot = key.get_slot();
+
+	// members are never removed, so the first free slot
+	// ends the probe sequence of each member.
+	const member_entry_t *entry;
+	while ((entry = this->members.get(slot)) != nullptr) {
+		if (unlikely(entry->first.get_id() == key.get_id())) {
+			throw InternalError{"member is already in the object state"};
+		}
+		slot += 1;
+	}
+
+	auto stored = std::make_shared<Member>(std::move(member));
+	Member &ret = *stored;
+	this->members.insert(slot, member_entry_t{key, std::move(stored)});
+
+	return ret;
+}
+
+
+uint32_t ObjectState::find(const MemberKey &key) const {
+	for (uint32_t slot = key.get_slot(); ; slot++) {
+		const member_entry_t *entry = this->members.get(slot);
+
+		// a free slot: the member was never stored.
+		if (entry == nullptr) {
+			return 0;
+		}
+
+		if (entry->first.get_id() == key.get_id()) {
+			return slot + 1;
+		}
+	}
 }
 
 } // namespace nyan
@@ -4,14 +4,21 @@
 #include <deque>
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
+#include "datastructure/persistent_map.h"
 #include "member.h"
+#include "member_key.h"
 
 
 namespace nyan {
 
+class InheritanceChange;
 class ObjectChanges;
 class ObjectInfo;
+class PatchPlan;
+class SymbolTable;
 
 
 /**
@@ -19,11 +26,24 @@ class ObjectInfo;
  */
 class ObjectState {
 	friend class Database;
+	friend class Snapshot;
 public:
+	/**
+	 * A stored member and its lookup key.
+	 * Members are shared between copies of the object state
+	 * until they are modified.
+	 */
+	using member_entry_t = std::pair<MemberKey, std::shared_ptr<Member>>;
+
+	/**
+	 * Maps the storage slots to the members stored there.
+	 */
+	using members_t = datastructure::PersistentMap<member_entry_t>;
+
 	/**
 	 * Creation of an initial object state.
 	 */
-	ObjectState(std::deque<fqon_t> &&parents);
+	ObjectState(std::deque<obj_id_t> &&parents);
 
 	/**
 	 * Patch application.
@@ -32,33 +52,66 @@ public:
 	           const ObjectInfo &mod_info,
 	           ObjectChanges &tracker);
 
+	/**
+	 * Patch application with a precompiled patch.
+	 */
+	void apply(const PatchPlan &plan, ObjectChanges &tracker);
+
+	/**
+	 * Copy the object state.
+	 * The copy shares the member storage until members are modified.
+	 */
 	std::shared_ptr<ObjectState> copy() const;
 
-	const std::deque<fqon_t> &get_parents() const;
+	const std::deque<obj_id_t> &get_parents() const;
 
-	bool has(const memberid_t &name) const;
-	Member *get(const memberid_t &name);
-	const Member *get(const memberid_t &name) const;
-	const std::unordered_map<memberid_t, Member> &get_members() const;
+	bool has(const MemberKey &key) const;
 
-	std::string str() const;
+	/**
+	 * Get a member so it can be modified.
+	 * A member shared with other object states is copied first.
+	 */
+	Member *get(const MemberKey &key);
+	const Member *get(const MemberKey &key) const;
+	const members_t &get_members() const;
+
+	std::string str(const SymbolTable &symbols) const;
 
 private:
 	/**
-	 * Replace the member map.
-	 * Used for creating initial object states.
+	 * Store a new member at its slot, or the next free one after it.
+	 * Used for creating initial object states and patching.
+	 */
+	Member &add_member(const MemberKey &key, Member &&member);
+
+	/**
+	 * Add a parent requested by a patch, unless it's a parent already.
+	 */
+	void apply_parent_change(const InheritanceChange &change, ObjectChanges &tracker);
+
+	/**
+	 * Apply the change to the member with the given key.
+	 * If this object doesn't have the member, it is added if allowed.
+	 */
+	void apply_member_change(const MemberKey &key, const Member &change,
+	                         bool may_add, ObjectChanges &tracker);
+
+	/**
+	 * Find the slot + 1 where a member is stored.
+	 * Returns 0 if the member isn't stored in this state.
 	 */
-	void set_members(std::unordered_map<memberid_t, Member> &&members);
+	uint32_t find(const MemberKey &key) const;
 
 	/**
 	 * Parent objects.
 	 */
-	std::deque<fqon_t> parents;
+	std::deque<obj_id_t> parents;
 
 	/**
-	 * Member storage.
+	 * Member storage, indexed by slot.
+	 * The slots are probed linearly from the slot in the member key.
 	 */
-	std::unordered_map<memberid_t, Member> members;
+	members_t members;
 
 	// The object location is stored in the metainfo-database.
 };
@@ -5,25 +5,26 @@
 #include <sstream>
 
 #include "error.h"
+#include "symbol_table.h"
 #include "util.h"
 
 
 namespace nyan {
 
-PatchInfo::PatchInfo(fqon_t &&target)
+PatchInfo::PatchInfo(obj_id_t target)
 	:
-	target{std::move(target)} {}
+	target{target} {}
 
 
-const fqon_t &PatchInfo::get_target() const {
+obj_id_t PatchInfo::get_target() const {
 	return this->target;
 }
 
 
-std::string PatchInfo::str() const {
+std::string PatchInfo::str(const SymbolTable &symbols) const {
 	std::ostringstream builder;
 
-	builder << "<" << this->target << ">";
+	builder << "<" << symbols.get_object_name(this->target) << ">";
 	return builder.str();
 }
 
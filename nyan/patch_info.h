@@ -5,25 +5,29 @@
 
 #include "config.h"
 
+
 namespace nyan {
 
+class SymbolTable;
+
+
 /**
  * Information about a patch.
  */
 class PatchInfo {
 public:
-	explicit PatchInfo(fqon_t &&target);
+	explicit PatchInfo(obj_id_t target);
 	~PatchInfo() = default;
 
-	const fqon_t &get_target() const;
+	obj_id_t get_target() const;
 
-	std::string str() const;
+	std::string str(const SymbolTable &symbols) const;
 
 protected:
 	/**
-	 * Patch target name.
+	 * Patch target object.
 	 */
-	fqon_t target;
+	obj_id_t target;
 };
 
 
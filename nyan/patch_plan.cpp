@@ -0,0 +1,34 @@
+// Copyright 2019-2019 the nyan authors, LGPLv3+. See copying.md for legal info.
+
+#include "patch_plan.h"
+
+#include "object_info.h"
+#include "object_state.h"
+
+
+namespace nyan {
+
+void PatchPlan::add_object(const ObjectInfo &info, const ObjectState &state) {
+	const auto &inher_changes = info.get_inheritance_change();
+	this->parent_changes.insert(std::end(this->parent_changes),
+	                            std::begin(inher_changes),
+	                            std::end(inher_changes));
+
+	for (auto &it : state.get_members()) {
+		const ObjectState::member_entry_t &entry = it.second;
+		this->member_changes.push_back({entry.first, entry.second, info.is_patch()});
+	}
+}
+
+
+const std::vector<InheritanceChange> &PatchPlan::get_parent_changes() const {
+	return this->parent_changes;
+}
+
+
+const std::vector<PatchPlan::member_change> &PatchPlan::get_member_changes() const {
+	return this->member_changes;
+}
+
+
+} // namespace nyan
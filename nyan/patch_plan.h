@@ -0,0 +1,67 @@
+// Copyright 2019-2019 the nyan authors, LGPLv3+. See copying.md for legal info.
+#pragma once
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "config.h"
+#include "inheritance_change.h"
+#include "member_key.h"
+
+
+namespace nyan {
+
+class Member;
+class ObjectInfo;
+class ObjectState;
+
+
+/**
+ * Precompiled application of a patch.
+ *
+ * Holds the changes of all objects in the patch linearization,
+ * in the order they are applied to the patch target.
+ * The member changes are shared with the database state.
+ */
+class PatchPlan {
+public:
+	/**
+	 * Change of one member of the patch target.
+	 */
+	struct member_change {
+		MemberKey key;
+		std::shared_ptr<Member> change;
+
+		/**
+		 * True if the member is added to a target that doesn't have it,
+		 * which is allowed for patches only.
+		 */
+		bool may_add;
+	};
+
+	PatchPlan() = default;
+	~PatchPlan() = default;
+
+	/**
+	 * Append the changes of the next object of the patch linearization.
+	 */
+	void add_object(const ObjectInfo &info, const ObjectState &state);
+
+	/**
+	 * Parents to add to the target, in order.
+	 */
+	const std::vector<InheritanceChange> &get_parent_changes() const;
+
+	/**
+	 * Member changes to apply to the target, in order.
+	 */
+	const std::vector<member_change> &get_member_changes() const;
+
+protected:
+	std::vector<InheritanceChange> parent_changes;
+	std::vector<member_change> member_changes;
+};
+
+
+} // namespace nyan
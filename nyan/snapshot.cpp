@@ -0,0 +1,615 @@
+// Copyright 2019-2019 the nyan authors, LGPLv3+. See copying.md for legal info.
+
+#include "snapshot.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "compiler.h"
+#include "error.h"
+#include "file.h"
+#include "location.h"
+#include "member.h"
+#include "meta_info.h"
+#include "object_info.h"
+#include "object_state.h"
+#include "patch_info.h"
+#include "state.h"
+#include "type.h"
+#include "value/boolean.h"
+#include "value/file.h"
+#include "value/number.h"
+#include "value/object.h"
+#include "value/orderedset.h"
+#include "value/set.h"
+#include "value/text.h"
+
+
+namespace nyan {
+
+/**
+ * Marks the start of a snapshot.
+ */
+static constexpr char snapshot_magic[8] = {'n', 'y', 'a', 'n', 's', 'n', 'a', 'p'};
+
+/**
+ * Increase when the snapshot format changes.
+ */
+static constexpr uint32_t snapshot_version = 1;
+
+
+/**
+ * FNV-1a hash of the given data.
+ * Used to detect modified input files and damaged snapshots.
+ */
+static uint64_t content_hash(std::string_view data) {
+	uint64_t hash = 0xcbf29ce484222325;
+	for (char c : data) {
+		hash ^= static_cast<unsigned char>(c);
+		hash *= 0x100000001b3;
+	}
+	return hash;
+}
+
+
+std::string Snapshot::create(const Database::loaded_files_t &files,
+                             const MetaInfo &meta_info,
+                             const State &state) {
+	Snapshot snapshot;
+
+	snapshot.output.append(snapshot_magic, sizeof(snapshot_magic));
+	snapshot.write(snapshot_version);
+
+	snapshot.write_files(files);
+	snapshot.write_info(meta_info);
+	snapshot.write_state(meta_info, state);
+
+	// the snapshot content is verified before it is restored.
+	snapshot.write(content_hash(snapshot.output));
+
+	return std::move(snapshot.output);
+}
+
+
+bool Snapshot::restore(std::string_view data,
+                       const Database::filefetcher_t &filefetcher,
+                       Database::loaded_files_t &files,
+                       MetaInfo &meta_info,
+                       State &state) {
+
+	if (data.size() < sizeof(snapshot_magic) + sizeof(snapshot_version) + sizeof(uint64_t)) {
+		return false;
+	}
+
+	if (std::memcmp(data.data(), snapshot_magic, sizeof(snapshot_magic)) != 0) {
+		return false;
+	}
+
+	Snapshot snapshot;
+
+	// the stored hash covers everything before it.
+	snapshot.input = data.substr(data.size() - sizeof(uint64_t));
+	std::string_view content = data.substr(0, data.size() - sizeof(uint64_t));
+	if (snapshot.read<uint64_t>() != content_hash(content)) {
+		return false;
+	}
+
+	snapshot.input = content.substr(sizeof(snapshot_magic));
+	if (snapshot.read<uint32_t>() != snapshot_version) {
+		return false;
+	}
+
+	MetaInfo new_meta_info;
+	State new_state;
+
+	try {
+		if (not snapshot.read_files(filefetcher)) {
+			return false;
+		}
+
+		snapshot.read_info(new_meta_info);
+		snapshot.read_state(new_meta_info, new_state);
+	}
+	catch (Error &) {
+		// the snapshot is damaged or an input file can't be fetched.
+		// damaged content can also make the metainfo and state
+		// raise their errors for invalid objects and members.
+		return false;
+	}
+
+	if (unlikely(snapshot.input.size() > 0)) {
+		return false;
+	}
+
+	files = std::move(snapshot.files);
+	meta_info = std::move(new_meta_info);
+	state = std::move(new_state);
+
+	return true;
+}
+
+
+void Snapshot::write_files(const Database::loaded_files_t &files) {
+	this->write(static_cast<uint32_t>(files.size()));
+
+	for (auto &it : files) {
+		const std::string &name = it.first;
+		const std::shared_ptr<File> &file = it.second;
+
+		this->file_index.emplace(file.get(), static_cast<uint32_t>(this->file_index.size()));
+
+		this->write_string(name);
+		this->write(static_cast<uint64_t>(file->size()));
+		this->write(content_hash(file->get_content()));
+	}
+}
+
+
+void Snapshot::write_info(const MetaInfo &meta_info) {
+	const SymbolTable &symbols = meta_info.get_symbols();
+
+	// members are interned in id order.
+	uint32_t member_count = static_cast<uint32_t>(symbols.get_member_count());
+	this->write(member_count);
+	for (member_id_t member = 0; member < member_count; member++) {
+		this->write_string(symbols.get_member_name(member));
+
+		const MemberKey *key = meta_info.get_member_key(member);
+		this->write(static_cast<uint8_t>(key != nullptr));
+		if (key != nullptr) {
+			this->write(key->get_slot());
+		}
+	}
+
+	// objects get their ids in this order when they are restored.
+	const MetaInfo::obj_info_t &objects = meta_info.get_objects();
+	this->write(static_cast<uint32_t>(objects.size()));
+	for (obj_id_t obj = 0; obj < objects.size(); obj++) {
+		this->write_string(symbols.get_object_name(obj));
+		this->write_object_info(objects[obj]);
+	}
+}
+
+
+void Snapshot::write_state(const MetaInfo &meta_info, const State &state) {
+	const auto &objects = state.get_objects();
+	this->write(static_cast<uint32_t>(objects.size()));
+
+	// write in id order, so the snapshot doesn't depend on the hashing.
+	size_t object_count = meta_info.get_objects().size();
+	for (obj_id_t obj = 0; obj < object_count; obj++) {
+		const std::shared_ptr<ObjectState> *obj_state = state.get(obj);
+		if (obj_state == nullptr) {
+			continue;
+		}
+
+		this->write(obj);
+
+		const auto &parents = (*obj_state)->get_parents();
+		this->write(static_cast<uint32_t>(parents.size()));
+		for (auto &parent : parents) {
+			this->write(parent);
+		}
+
+		const auto &members = (*obj_state)->get_members();
+		this->write(static_cast<uint32_t>(members.size()));
+		for (auto &it : members) {
+			const MemberKey &key = it.second.first;
+			const Member &member = *it.second.second;
+
+			this->write(key.get_id());
+			this->write(key.get_slot());
+			this->write(member.get_override_depth());
+			this->write(static_cast<uint8_t>(member.get_operation()));
+			this->write_value(member.get_value());
+		}
+	}
+}
+
+
+void Snapshot::write_object_info(const ObjectInfo &info) {
+	this->write_location(info.get_location());
+	this->write(static_cast<uint8_t>(info.is_initial_patch()));
+
+	const std::shared_ptr<PatchInfo> &patch = info.get_patch();
+	this->write(static_cast<uint8_t>(patch != nullptr));
+	if (patch != nullptr) {
+		this->write(patch->get_target());
+	}
+
+	const auto &inheritance_change = info.get_inheritance_change();
+	this->write(static_cast<uint32_t>(inheritance_change.size()));
+	for (auto &change : inheritance_change) {
+		this->write(static_cast<uint8_t>(change.get_type()));
+		this->write(change.get_target());
+	}
+
+	const auto &members = info.get_members();
+	this->write(static_cast<uint32_t>(members.size()));
+	for (auto &it : members) {
+		const MemberInfo &member_info = it.second;
+
+		this->write(it.first);
+		this->write_location(member_info.get_location());
+		this->write(static_cast<uint8_t>(member_info.is_initial_def()));
+
+		const std::shared_ptr<Type> &type = member_info.get_type();
+		this->write(static_cast<uint8_t>(type != nullptr));
+		if (type != nullptr) {
+			this->write_type(*type);
+		}
+	}
+
+	const auto &linearization = info.get_linearization();
+	this->write(static_cast<uint32_t>(linearization.size()));
+	for (auto &obj : linearization) {
+		this->write(obj);
+	}
+
+	const auto &children = info.get_children();
+	this->write(static_cast<uint32_t>(children.size()));
+	for (auto &obj : children) {
+		this->write(obj);
+	}
+}
+
+
+void Snapshot::write_location(const Location &location) {
+	this->write(static_cast<uint8_t>(location.is_builtin()));
+
+	if (location.is_builtin()) {
+		this->write_string(location.get_msg());
+		return;
+	}
+
+	uint32_t file = std::numeric_limits<uint32_t>::max();
+	if (location.get_file() != nullptr) {
+		auto it = this->file_index.find(location.get_file().get());
+		if (unlikely(it == std::end(this->file_index))) {
+			throw InternalError{"location refers to a file that was not loaded"};
+		}
+		file = it->second;
+	}
+
+	this->write(file);
+	this->write(static_cast<int32_t>(location.get_line()));
+	this->write(static_cast<int32_t>(location.get_line_offset()));
+	this->write(static_cast<int32_t>(location.get_length()));
+}
+
+
+void Snapshot::write_type(const Type &type) {
+	this->write(static_cast<uint8_t>(type.basic_type.primitive_type));
+	this->write(static_cast<uint8_t>(type.basic_type.container_type));
+	this->write_string(type.target);
+
+	const Type *element_type = type.get_element_type();
+	this->write(static_cast<uint8_t>(element_type != nullptr));
+	if (element_type != nullptr) {
+		this->write_type(*element_type);
+	}
+}
+
+
+void Snapshot::write_value(const Value &value) {
+	const BasicType &type = value.get_type();
+
+	this->write(static_cast<uint8_t>(type.primitive_type));
+	this->write(static_cast<uint8_t>(type.container_type));
+
+	switch (type.primitive_type) {
+	case primitive_t::BOOLEAN:
+		this->write(static_cast<uint8_t>(dynamic_cast<const Boolean &>(value).get()));
+		break;
+
+	case primitive_t::TEXT:
+		this->write_string(dynamic_cast<const Text &>(value).get());
+		break;
+
+	case primitive_t::FILENAME:
+		this->write_string(dynamic_cast<const Filename &>(value).get());
+		break;
+
+	case primitive_t::INT:
+		this->write(dynamic_cast<const Int &>(value).get());
+		break;
+
+	case primitive_t::FLOAT:
+		this->write(dynamic_cast<const Float &>(value).get());
+		break;
+
+	case primitive_t::OBJECT:
+		this->write_string(dynamic_cast<const ObjectValue &>(value).get());
+		break;
+
+	case primitive_t::CONTAINER:
+		switch (type.container_type) {
+		case container_t::SET: {
+			const set_t &values = dynamic_cast<const Set &>(value).get();
+			this->write(static_cast<uint32_t>(values.size()));
+			for (auto &element : values) {
+				this->write_value(*element);
+			}
+			break;
+		}
+		case container_t::ORDEREDSET: {
+			const ordered_set_t &values = dynamic_cast<const OrderedSet &>(value).get();
+			this->write(static_cast<uint32_t>(values.size()));
+			for (auto &element : values) {
+				this->write_value(*element);
+			}
+			break;
+		}
+		default:
+			throw InternalError{"unhandled container type in snapshot"};
+		}
+		break;
+	}
+}
+
+
+void Snapshot::write_string(const std::string &text) {
+	this->write(static_cast<uint32_t>(text.size()));
+	this->output.append(text);
+}
+
+
+bool Snapshot::read_files(const Database::filefetcher_t &filefetcher) {
+	uint32_t count = this->read<uint32_t>();
+
+	for (uint32_t i = 0; i < count; i++) {
+		std::string name = this->read_string();
+		uint64_t size = this->read<uint64_t>();
+		uint64_t hash = this->read<uint64_t>();
+
+		// the filefetcher throws a FileReadError if the file is gone.
+		std::shared_ptr<File> file = filefetcher(name);
+
+		if (file->size() != size or content_hash(file->get_content()) != hash) {
+			// the file was modified since the snapshot was created.
+			return false;
+		}
+
+		this->files.push_back({std::move(name), std::move(file)});
+	}
+
+	return true;
+}
+
+
+void Snapshot::read_info(MetaInfo &meta_info) {
+	SymbolTable &symbols = meta_info.get_symbols();
+
+	this->member_count = this->read<uint32_t>();
+	for (member_id_t member = 0; member < this->member_count; member++) {
+		std::string name = this->read_string();
+		if (unlikely(symbols.add_member(name) != member)) {
+			throw FileReadError{"snapshot contains a duplicate member name"};
+		}
+
+		if (this->read<uint8_t>()) {
+			meta_info.add_member_key(member, this->read<member_slot_t>());
+		}
+	}
+
+	// objects refer to those stored after them.
+	this->object_count = this->read<uint32_t>();
+	for (obj_id_t obj = 0; obj < this->object_count; obj++) {
+		std::string name = this->read_string();
+		meta_info.add_object(name, this->read_object_info());
+	}
+}
+
+
+void Snapshot::read_state(const MetaInfo &meta_info, State &state) {
+	uint32_t count = this->read<uint32_t>();
+
+	for (uint32_t i = 0; i < count; i++) {
+		obj_id_t obj = this->read_object_id();
+
+		std::deque<obj_id_t> parents;
+		uint32_t parent_count = this->read<uint32_t>();
+		for (uint32_t j = 0; j < parent_count; j++) {
+			parents.push_back(this->read_object_id());
+		}
+
+		auto obj_state = std::make_shared<ObjectState>(std::move(parents));
+
+		uint32_t member_count = this->read<uint32_t>();
+		for (uint32_t j = 0; j < member_count; j++) {
+			member_id_t member = this->read_member_id();
+			member_slot_t slot = this->read<member_slot_t>();
+			override_depth_t depth = this->read<override_depth_t>();
+			nyan_op operation = this->read_enum(nyan_op::UNION_ASSIGN);
+
+			// lookups probe from the slot of the member key.
+			const MemberKey *key = meta_info.get_member_key(member);
+			if (unlikely(key == nullptr or key->get_slot() != slot)) {
+				throw FileReadError{"snapshot member slot doesn't match its key"};
+			}
+
+			obj_state->add_member(
+				MemberKey{member, slot},
+				Member{depth, operation, this->read_value()}
+			);
+		}
+
+		state.add_object(obj, std::move(obj_state));
+	}
+}
+
+
+ObjectInfo Snapshot::read_object_info() {
+	ObjectInfo info{this->read_location()};
+
+	bool initial_patch = this->read<uint8_t>();
+	if (this->read<uint8_t>()) {
+		info.add_patch(
+			std::make_shared<PatchInfo>(this->read_object_id()),
+			initial_patch
+		);
+	}
+
+	uint32_t change_count = this->read<uint32_t>();
+	for (uint32_t i = 0; i < change_count; i++) {
+		auto type = this->read_enum(inher_change_t::ADD_BACK);
+		info.add_inheritance_change(InheritanceChange{type, this->read_object_id()});
+	}
+
+	uint32_t member_count = this->read<uint32_t>();
+	for (uint32_t i = 0; i < member_count; i++) {
+		member_id_t member = this->read_member_id();
+		MemberInfo member_info{this->read_location()};
+
+		bool initial_def = this->read<uint8_t>();
+		if (this->read<uint8_t>()) {
+			member_info.set_type(this->read_type(), initial_def);
+		}
+
+		info.add_member(member, std::move(member_info));
+	}
+
+	std::vector<obj_id_t> linearization;
+	uint32_t lin_count = this->read<uint32_t>();
+	// a damaged count must not reserve more than the input can contain.
+	linearization.reserve(std::min<size_t>(lin_count, this->input.size() / sizeof(obj_id_t)));
+	for (uint32_t i = 0; i < lin_count; i++) {
+		linearization.push_back(this->read_object_id());
+	}
+	info.set_linearization(std::move(linearization));
+
+	std::unordered_set<obj_id_t> children;
+	uint32_t child_count = this->read<uint32_t>();
+	for (uint32_t i = 0; i < child_count; i++) {
+		children.insert(this->read_object_id());
+	}
+	info.set_children(std::move(children));
+
+	return info;
+}
+
+
+Location Snapshot::read_location() {
+	if (this->read<uint8_t>()) {
+		return Location{this->read_string()};
+	}
+
+	uint32_t file = this->read<uint32_t>();
+	int line = this->read<int32_t>();
+	int line_offset = this->read<int32_t>();
+	int length = this->read<int32_t>();
+
+	std::shared_ptr<File> file_ptr;
+	if (file != std::numeric_limits<uint32_t>::max()) {
+		if (unlikely(file >= this->files.size())) {
+			throw FileReadError{"snapshot location refers to an unknown file"};
+		}
+		file_ptr = this->files[file].second;
+	}
+
+	return Location{file_ptr, line, line_offset, length};
+}
+
+
+std::shared_ptr<Type> Snapshot::read_type() {
+	BasicType basic_type{
+		this->read_enum(primitive_t::OBJECT),
+		this->read_enum(container_t::ORDEREDSET)
+	};
+	fqon_t target = this->read_string();
+
+	std::shared_ptr<Type> element_type;
+	if (this->read<uint8_t>()) {
+		element_type = this->read_type();
+	}
+
+	// the constructor is not accessible for std::make_shared.
+	return std::shared_ptr<Type>{
+		new Type{basic_type, std::move(element_type), target}
+	};
+}
+
+
+ValueHolder Snapshot::read_value() {
+	auto primitive_type = this->read_enum(primitive_t::OBJECT);
+	auto container_type = this->read_enum(container_t::ORDEREDSET);
+
+	switch (primitive_type) {
+	case primitive_t::BOOLEAN:
+		return {Boolean{static_cast<bool>(this->read<uint8_t>())}};
+
+	case primitive_t::TEXT:
+		return {std::make_shared<Text>(this->read_string())};
+
+	case primitive_t::FILENAME:
+		return {std::make_shared<Filename>(this->read_string())};
+
+	case primitive_t::INT:
+		return {Int{this->read<value_int_t>()}};
+
+	case primitive_t::FLOAT:
+		return {Float{this->read<value_float_t>()}};
+
+	case primitive_t::OBJECT:
+		return {std::make_shared<ObjectValue>(this->read_string())};
+
+	case primitive_t::CONTAINER: {
+		std::vector<ValueHolder> values;
+		uint32_t count = this->read<uint32_t>();
+		values.reserve(std::min<size_t>(count, this->input.size()));
+		for (uint32_t i = 0; i < count; i++) {
+			values.push_back(this->read_value());
+		}
+
+		switch (container_type) {
+		case container_t::SET:
+			return {std::make_shared<Set>(std::move(values))};
+		case container_t::ORDEREDSET:
+			return {std::make_shared<OrderedSet>(std::move(values))};
+		default:
+			break;
+		}
+		break;
+	}
+	}
+
+	throw FileReadError{"snapshot contains an unknown value type"};
+}
+
+
+obj_id_t Snapshot::read_object_id() {
+	obj_id_t obj = this->read<obj_id_t>();
+	if (unlikely(obj >= this->object_count)) {
+		throw FileReadError{"snapshot refers to an unknown object"};
+	}
+	return obj;
+}
+
+
+member_id_t Snapshot::read_member_id() {
+	member_id_t member = this->read<member_id_t>();
+	if (unlikely(member >= this->member_count)) {
+		throw FileReadError{"snapshot refers to an unknown member"};
+	}
+	return member;
+}
+
+
+std::string Snapshot::read_string() {
+	uint32_t size = this->read<uint32_t>();
+	const char *data = this->take(size);
+	return std::string{data, size};
+}
+
+
+const char *Snapshot::take(size_t size) {
+	if (unlikely(this->input.size() < size)) {
+		throw FileReadError{"snapshot is truncated"};
+	}
+
+	const char *ret = this->input.data();
+	this->input.remove_prefix(size);
+	return ret;
+}
+
+} // namespace nyan
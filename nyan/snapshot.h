@@ -0,0 +1,160 @@
+// Copyright 2019-2019 the nyan authors, LGPLv3+. See copying.md for legal info.
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+
+#include "compiler.h"
+#include "config.h"
+#include "error.h"
+#include "database.h"
+
+
+namespace nyan {
+
+class File;
+class Location;
+class MetaInfo;
+class ObjectInfo;
+class State;
+class Type;
+class Value;
+class ValueHolder;
+
+
+/**
+ * Binary snapshot of the content loaded into a database.
+ *
+ * Stores the metainfo and the initial state, so they can be
+ * restored without lexing, parsing and checking the nyan files again.
+ * The snapshot is bound to the content of the files it was created from.
+ *
+ * The format is only meant as a cache on the same machine,
+ * it is not portable between architectures or nyan versions.
+ */
+class Snapshot {
+public:
+	/**
+	 * Serialize the database content that was loaded from the given files.
+	 */
+	static std::string create(const Database::loaded_files_t &files,
+	                          const MetaInfo &meta_info,
+	                          const State &state);
+
+	/**
+	 * Restore the database content from a serialized snapshot.
+	 * The input files are fetched to verify they are unchanged.
+	 *
+	 * Returns false if the snapshot is invalid, damaged or outdated,
+	 * then the outputs were not modified.
+	 */
+	static bool restore(std::string_view data,
+	                    const Database::filefetcher_t &filefetcher,
+	                    Database::loaded_files_t &files,
+	                    MetaInfo &meta_info,
+	                    State &state);
+
+protected:
+	Snapshot() = default;
+
+	void write_files(const Database::loaded_files_t &files);
+	void write_info(const MetaInfo &meta_info);
+	void write_state(const MetaInfo &meta_info, const State &state);
+	void write_object_info(const ObjectInfo &info);
+	void write_location(const Location &location);
+	void write_type(const Type &type);
+	void write_value(const Value &value);
+	void write_string(const std::string &text);
+
+	template <typename T>
+	void write(const T &value) {
+		static_assert(std::is_trivially_copyable_v<T>);
+		this->output.append(reinterpret_cast<const char *>(&value), sizeof(T));
+	}
+
+	bool read_files(const Database::filefetcher_t &filefetcher);
+	void read_info(MetaInfo &meta_info);
+	void read_state(const MetaInfo &meta_info, State &state);
+	ObjectInfo read_object_info();
+	Location read_location();
+	std::shared_ptr<Type> read_type();
+	ValueHolder read_value();
+	std::string read_string();
+
+	/**
+	 * Read a value from the input.
+	 * Throws a FileReadError if the input is too short.
+	 */
+	template <typename T>
+	T read() {
+		static_assert(std::is_trivially_copyable_v<T>);
+		T ret;
+		std::memcpy(&ret, this->take(sizeof(T)), sizeof(T));
+		return ret;
+	}
+
+	/**
+	 * Read an enum value stored in one byte.
+	 * Throws a FileReadError if it is not in the range up to last.
+	 */
+	template <typename E>
+	E read_enum(E last) {
+		static_assert(std::is_enum_v<E>);
+		uint8_t value = this->read<uint8_t>();
+		if (unlikely(value > static_cast<uint8_t>(last))) {
+			throw FileReadError{"snapshot contains an invalid enum value"};
+		}
+		return static_cast<E>(value);
+	}
+
+	/**
+	 * Read an object id.
+	 * Throws a FileReadError if no object has this id.
+	 */
+	obj_id_t read_object_id();
+
+	/**
+	 * Read a member id.
+	 * Throws a FileReadError if no member has this id.
+	 */
+	member_id_t read_member_id();
+
+	/**
+	 * Consume the given amount of bytes from the input.
+	 */
+	const char *take(size_t size);
+
+	/**
+	 * Serialized snapshot which is written.
+	 */
+	std::string output;
+
+	/**
+	 * Serialized snapshot which is not yet read.
+	 */
+	std::string_view input;
+
+	/**
+	 * Files the snapshot was created from, in load order.
+	 */
+	Database::loaded_files_t files;
+
+	/**
+	 * Number of objects and members in the snapshot,
+	 * all ids read have to be smaller.
+	 */
+	size_t object_count = 0;
+	size_t member_count = 0;
+
+	/**
+	 * Index of each file in the file list, used to write locations.
+	 */
+	std::unordered_map<const File *, uint32_t> file_index;
+};
+
+} // namespace nyan
@@ -7,6 +7,7 @@
 #include "compiler.h"
 #include "error.h"
 #include "object_state.h"
+#include "symbol_table.h"
 #include "view.h"
 #include "util.h"
 
@@ -23,73 +24,53 @@ State::State()
 	previous_state{nullptr} {}
 
 
-const std::shared_ptr<ObjectState> *State::get(const fqon_t &fqon) const {
-	auto it = this->objects.find(fqon);
-	if (it != std::end(this->objects)) {
-		return &it->second;
-	}
-	else {
-		return nullptr;
-	}
+const std::shared_ptr<ObjectState> *State::get(obj_id_t obj) const {
+	return this->objects.get(obj);
 }
 
 
-ObjectState &State::add_object(const fqon_t &name, std::shared_ptr<ObjectState> &&obj) {
+ObjectState &State::add_object(obj_id_t obj, std::shared_ptr<ObjectState> &&state) {
 	if (unlikely(this->previous_state != nullptr)) {
 		throw InternalError{"can't add new object in state that is not initial."};
 	}
 
-	auto ins = this->objects.insert({name, std::move(obj)});
-
-	if (not ins.second) {
+	if (unlikely(this->objects.get(obj) != nullptr)) {
 		throw InternalError{"added an already-known object to the state!"};
 	}
 
-	return *ins.first->second;
+	return *this->objects.insert(obj, std::move(state));
 }
 
 
 void State::update(std::shared_ptr<State> &&source_state) {
 	// update this state with all objects from the source state
-	// -> move all objects from the sourcestate into this one.
-	for (auto &it : source_state.get()->objects) {
-		auto search = this->objects.find(it.first);
-		if (search != std::end(this->objects)) {
-			search->second = std::move(it.second);
-		}
-		else {
-			this->objects.insert(
-				{std::move(it.first), std::move(it.second)}
-			);
-		}
+	// -> add or replace the objects of the source state in this one.
+	for (auto &it : source_state->objects) {
+		this->objects.insert(it.first, std::shared_ptr<ObjectState>{it.second});
 	}
 }
 
 
-const std::shared_ptr<ObjectState> &State::copy_object(const fqon_t &name,
+const std::shared_ptr<ObjectState> &State::copy_object(obj_id_t obj,
                                                        order_t t,
                                                        std::shared_ptr<View> &origin) {
 
+	// check if the object already is in this state,
+	// then there's no need to look up and copy it.
+	const std::shared_ptr<ObjectState> *existing = this->objects.get(obj);
+	if (existing != nullptr) {
+		return *existing;
+	}
+
 	// last known state of the object
-	const std::shared_ptr<ObjectState> &source = origin->get_raw(name, t);
+	const std::shared_ptr<ObjectState> &source = origin->get_raw(obj, t);
 
 	if (not source) {
 		throw InternalError{"object copy source not found"};
 	}
 
-	// check if the object already is in this state
-	auto it = this->objects.find(name);
-	if (it == std::end(this->objects)) {
-		// if not, copy the source object into this state
-		return this->objects.emplace(
-			name,
-			source->copy()
-		).first->second;
-	}
-	else {
-		// else, no need to copy, the object is already in this state
-		return it->second;
-	}
+	// copy the source object into this state
+	return this->objects.insert(obj, source->copy());
 }
 
 
@@ -98,13 +79,12 @@ const std::shared_ptr<State> &State::get_previous_state() const {
 }
 
 
-const std::unordered_map<fqon_t, std::shared_ptr<ObjectState>> &
-State::get_objects() const {
+const State::objects_t &State::get_objects() const {
 	return this->objects;
 }
 
 
-std::string State::str() const {
+std::string State::str(const SymbolTable &symbols) const {
 	std::ostringstream builder;
 
 	builder << "State:" << std::endl;
@@ -112,7 +92,8 @@ std::string State::str() const {
 	size_t i = 0;
 	for (auto &it : this->objects) {
 		builder << "object " << i << ":" << std::endl
-		        << it.first << " => " << it.second->str() << std::endl;
+		        << symbols.get_object_name(it.first) << " => "
+		        << it.second->str(symbols) << std::endl;
 		i += 1;
 	}
 
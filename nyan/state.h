@@ -3,14 +3,15 @@
 
 #include <memory>
 #include <string>
-#include <unordered_map>
 
 #include "config.h"
+#include "datastructure/persistent_map.h"
 
 
 namespace nyan {
 
 class ObjectState;
+class SymbolTable;
 class View;
 
 
@@ -18,9 +19,17 @@ class View;
  * Database state for some point in time.
  * Contains ObjectStates.
  * Has a reference to the previous state.
+ *
+ * Copies of a state share the object storage,
+ * changing an object only copies the path to it.
  */
 class State {
 public:
+	/**
+	 * Maps object ids to their state.
+	 */
+	using objects_t = datastructure::PersistentMap<std::shared_ptr<ObjectState>>;
+
 	State(const std::shared_ptr<State> &previous_state);
 
 	State();
@@ -28,14 +37,14 @@ public:
 	/**
 	 * Get the object with given name in this state only.
 	 */
-	const std::shared_ptr<ObjectState> *get(const fqon_t &fqon) const;
+	const std::shared_ptr<ObjectState> *get(obj_id_t obj) const;
 
 	/**
 	 * Add an object to the state.
 	 * This can only be done for the initial state, i.e. there's no previous state.
 	 * Why? The database must be filled at some point.
 	 */
-	ObjectState &add_object(const fqon_t &name, std::shared_ptr<ObjectState> &&obj);
+	ObjectState &add_object(obj_id_t obj, std::shared_ptr<ObjectState> &&state);
 
 	/**
 	 * Add and potentially replace the objects in the storage from the other state.
@@ -45,8 +54,9 @@ public:
 	/**
 	 * Copy an object from origin to this state.
 	 * If it is in this state already, don't copy it.
+	 * The returned reference is valid until the state is modified.
 	 */
-	const std::shared_ptr<ObjectState> &copy_object(const fqon_t &name,
+	const std::shared_ptr<ObjectState> &copy_object(obj_id_t obj,
 	                                                order_t t,
 	                                                std::shared_ptr<View> &origin);
 
@@ -59,16 +69,15 @@ public:
 	/**
 	 * Return the objects stored in this state.
 	 */
-	const std::unordered_map<fqon_t, std::shared_ptr<ObjectState>> &
-	get_objects() const;
+	const objects_t &get_objects() const;
 
 	/**
 	 * String representation of this state.
 	 */
-	std::string str() const;
+	std::string str(const SymbolTable &symbols) const;
 
 private:
-	std::unordered_map<fqon_t, std::shared_ptr<ObjectState>> objects;
+	objects_t objects;
 	std::shared_ptr<State> previous_state;
 };
 
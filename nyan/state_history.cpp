@@ -4,15 +4,19 @@
 
 #include "compiler.h"
 #include "database.h"
-#include "meta_info.h"
+#include "object_state.h"
 #include "state.h"
 
 
 namespace nyan {
 
-StateHistory::StateHistory(const std::shared_ptr<Database> &base) {
+StateHistory::StateHistory(const std::shared_ptr<Database> &base)
+	:
+	first_record{LATEST_T},
+	log{std::make_shared<write_log>()} {
 
 	// create new empty state to work on at the beginning.
+	// it has no objects, so no records are created.
 	this->insert(
 		std::make_shared<State>(base->get_state()),
 		DEFAULT_T
@@ -34,9 +38,9 @@ const std::shared_ptr<State> *StateHistory::get_state_exact(order_t t) const {
 }
 
 
-const std::shared_ptr<ObjectState> *StateHistory::get_obj_state(const fqon_t &fqon, order_t t) const {
+const std::shared_ptr<ObjectState> *StateHistory::get_obj_state(obj_id_t obj, order_t t) const {
 	// get the object history
-	const ObjectHistory *obj_history = this->get_obj_history(fqon);
+	const ObjectHistory *obj_history = this->get_obj_history(obj);
 
 	// object isn't recorded in this state history
 	if (obj_history == nullptr) {
@@ -56,7 +60,7 @@ const std::shared_ptr<ObjectState> *StateHistory::get_obj_state(const fqon_t &fq
 		throw InternalError{"no history record at change point"};
 	}
 
-	const std::shared_ptr<ObjectState> *obj_state = (*state)->get(fqon);
+	const std::shared_ptr<ObjectState> *obj_state = (*state)->get(obj);
 	if (unlikely(state == nullptr)) {
 		throw InternalError{"object state not found at change point"};
 	}
@@ -67,9 +71,12 @@ const std::shared_ptr<ObjectState> *StateHistory::get_obj_state(const fqon_t &fq
 
 void StateHistory::insert(std::shared_ptr<State> &&new_state, order_t t) {
 
+	// later states are dropped, so are all records for them.
+	this->drop_after(t);
+
 	// record the changes.
 	for (const auto &it : new_state->get_objects()) {
-		ObjectHistory &obj_history = this->get_create_obj_history(it.first);
+		ObjectHistory &obj_history = this->record_obj_history(it.first, t);
 		obj_history.insert_change(t);
 	}
 
@@ -78,105 +85,313 @@ void StateHistory::insert(std::shared_ptr<State> &&new_state, order_t t) {
 }
 
 
-void StateHistory::insert_linearization(std::vector<fqon_t> &&ins, order_t t) {
-	const auto &obj = ins.at(0);
+void StateHistory::insert_linearization(std::vector<obj_id_t> &&ins, order_t t) {
+	obj_id_t obj = ins.at(0);
 
-	this->get_create_obj_history(obj).linearizations.insert_drop(t, std::move(ins));
+	this->record_obj_history(obj, t).linearizations.insert_drop(t, std::move(ins));
 }
 
 
-const std::vector<fqon_t> &
-StateHistory::get_linearization(const fqon_t &obj, order_t t,
-                                const MetaInfo &meta_info) const {
+const std::vector<obj_id_t> *
+StateHistory::get_linearization(obj_id_t obj, order_t t) const {
+	const ObjectHistory *obj_hist = this->get_obj_history(obj);
+	if (obj_hist == nullptr or obj_hist->linearizations.empty()) {
+		return nullptr;
+	}
+
+	return obj_hist->linearizations.at_find(t);
+}
+
 
+void StateHistory::insert_children(obj_id_t obj,
+                                   std::unordered_set<obj_id_t> &&ins,
+                                   order_t t) {
+
+	this->record_obj_history(obj, t).children.insert_drop(t, std::move(ins));
+}
+
+
+const std::unordered_set<obj_id_t> *
+StateHistory::get_children(obj_id_t obj, order_t t) const {
 	const ObjectHistory *obj_hist = this->get_obj_history(obj);
-	if (obj_hist != nullptr) {
-		if (not obj_hist->linearizations.empty()) {
-			auto ret = obj_hist->linearizations.at_find(t);
+	if (obj_hist == nullptr or obj_hist->children.empty()) {
+		return nullptr;
+	}
 
-			if (ret != nullptr) {
-				return *ret;
-			}
-		}
+	return obj_hist->children.at_find(t);
+}
+
+
+void StateHistory::insert_descendants(obj_id_t obj,
+                                      std::vector<obj_id_t> &&ins,
+                                      order_t t) {
+
+	this->record_obj_history(obj, t).descendants.insert_drop(t, std::move(ins));
+}
+
+
+const std::vector<obj_id_t> *
+StateHistory::get_descendants(obj_id_t obj, order_t t) const {
+	const ObjectHistory *obj_hist = this->get_obj_history(obj);
+	if (obj_hist == nullptr or obj_hist->descendants.empty()) {
+		return nullptr;
 	}
 
-	// otherwise, the lin is only stored in the database.
-	const ObjectInfo *obj_info = meta_info.get_object(obj);
-	if (unlikely(obj_info == nullptr)) {
-		throw InternalError{"object not found in metainfo"};
+	return obj_hist->descendants.at_find(t);
+}
+
+
+void StateHistory::insert_ancestry(obj_id_t obj, Ancestry &&ins, order_t t) {
+	this->record_obj_history(obj, t).ancestries.insert_drop(t, std::move(ins));
+}
+
+
+const Ancestry *StateHistory::get_ancestry(obj_id_t obj, order_t t) const {
+	const ObjectHistory *obj_hist = this->get_obj_history(obj);
+	if (obj_hist == nullptr or obj_hist->ancestries.empty()) {
+		return nullptr;
 	}
 
-	return obj_info->get_linearization();
+	return obj_hist->ancestries.at_find(t);
 }
 
 
-void StateHistory::insert_children(const fqon_t &obj,
-                                   std::unordered_set<fqon_t> &&ins,
-                                   order_t t) {
+ValueCache *StateHistory::get_values(obj_id_t obj, order_t t) const {
+	const ObjectHistory *obj_hist = this->get_obj_history(obj);
+	if (obj_hist == nullptr) {
+		return nullptr;
+	}
 
-	this->get_create_obj_history(obj).children.insert_drop(t, std::move(ins));
+	const std::shared_ptr<ValueCache> *values = obj_hist->values.at_find(t);
+	if (values == nullptr) {
+		return nullptr;
+	}
+	return values->get();
 }
 
 
-const std::unordered_set<fqon_t> &
-StateHistory::get_children(const fqon_t &obj, order_t t,
-                           const MetaInfo &meta_info) const {
+void StateHistory::invalidate_values(obj_id_t obj, order_t t) {
+	// the empty cache drops all later values
+	// and marks the values to be recalculated from t on.
+	this->record_obj_history(obj, t).values.insert_drop(
+		t, std::make_shared<ValueCache>()
+	);
+}
 
-	// first try the obj_history
-	const ObjectHistory *obj_hist = this->get_obj_history(obj);
-	if (obj_hist != nullptr) {
-		if (not obj_hist->children.empty()) {
-			auto ret = obj_hist->children.at_find(t);
 
-			if (ret != nullptr) {
-				return *ret;
+void StateHistory::record_transaction(applied_transaction &&transaction, order_t t) {
+	std::vector<applied_transaction> *recorded = this->log->transactions.at_exact(t);
+	if (recorded == nullptr) {
+		recorded = &this->log->transactions.insert(t, std::vector<applied_transaction>{});
+	}
+
+	recorded->push_back(std::move(transaction));
+}
+
+
+std::vector<std::pair<order_t, applied_transaction>>
+StateHistory::get_transactions() const {
+	std::vector<std::pair<order_t, applied_transaction>> ret;
+
+	this->log->transactions.for_each(
+		[&ret] (order_t time, const std::vector<applied_transaction> &transactions) {
+			for (auto &transaction : transactions) {
+				ret.emplace_back(time, transaction);
 			}
 		}
-	}
+	);
+
+	return ret;
+}
 
-	// otherwise, the lin is only stored in the database.
-	const ObjectInfo *obj_info = meta_info.get_object(obj);
-	if (unlikely(obj_info == nullptr)) {
-		throw InternalError{"object not found in metainfo"};
+
+std::vector<std::pair<order_t, applied_transaction>>
+StateHistory::get_transactions_after(order_t t) const {
+	std::vector<std::pair<order_t, applied_transaction>> ret;
+
+	this->log->transactions.for_each_after(
+		t,
+		[&ret] (order_t time, const std::vector<applied_transaction> &transactions) {
+			for (auto &transaction : transactions) {
+				ret.emplace_back(time, transaction);
+			}
+		}
+	);
+
+	return ret;
+}
+
+
+void StateHistory::drop_after(order_t t) {
+	if (not this->history.has_after(t) and
+	    not this->log->modified_objs.has_after(t) and
+	    not this->log->transactions.has_after(t)) {
+		return;
 	}
 
-	return obj_info->get_children();
+	this->log->modified_objs.for_each_after(
+		t,
+		[this, t] (order_t, const std::unordered_set<obj_id_t> &objs) {
+			for (auto obj : objs) {
+				ObjectHistory *obj_hist = this->get_writable_obj_history(obj);
+				if (obj_hist == nullptr) {
+					// already removed when listed for an earlier time
+					continue;
+				}
+
+				obj_hist->drop_after(t);
+
+				// the object was only modified after t.
+				if (obj_hist->empty()) {
+					this->object_obj_hists.erase(obj);
+				}
+			}
+		}
+	);
+
+	this->log->modified_objs.drop_after(t);
+	this->log->transactions.drop_after(t);
+	this->history.drop_after(t);
+
+	if (this->first_record > t) {
+		this->first_record = LATEST_T;
+	}
 }
 
 
-ObjectHistory *StateHistory::get_obj_history(const fqon_t &obj) {
-	auto it = this->object_obj_hists.find(obj);
-	if (it != std::end(this->object_obj_hists)) {
-		return &it->second;
+size_t StateHistory::compact_before(order_t horizon) {
+	std::vector<std::shared_ptr<State>> old_states;
+	this->history.for_each_before(
+		horizon,
+		[&old_states] (order_t, const std::shared_ptr<State> &state) {
+			old_states.push_back(state);
+		}
+	);
+
+	// the initial state is always there,
+	// so there's nothing to fold if it's the only old one.
+	if (old_states.size() < 2) {
+		return 0;
+	}
+
+	size_t reclaimed = 0;
+
+	// the old states only store the objects changed at their time,
+	// the folded state has the latest version of each of them.
+	auto folded = std::make_shared<State>(*old_states[0]);
+	for (size_t i = 1; i < old_states.size(); i++) {
+		folded->update(std::shared_ptr<State>{old_states[i]});
 	}
-	else {
-		return nullptr;
+
+	// count the object states that are only referenced by dropped states.
+	for (auto &state : old_states) {
+		reclaimed += sizeof(State);
+
+		for (auto &it : state->get_objects()) {
+			const std::shared_ptr<ObjectState> &obj_state = it.second;
+			if (*folded->get(it.first) != obj_state and obj_state.use_count() == 1) {
+				reclaimed += (sizeof(ObjectState)
+				              + obj_state->get_members().size()
+				                * sizeof(ObjectState::member_entry_t));
+			}
+		}
+	}
+	// the folded state replaces one of them.
+	reclaimed -= sizeof(State);
+	old_states.clear();
+
+	this->history.compact_before(horizon, DEFAULT_T, [] (const auto &) {});
+	this->history.insert(DEFAULT_T, std::move(folded));
+
+	std::vector<obj_id_t> objs;
+	objs.reserve(this->object_obj_hists.size());
+	for (auto &it : this->object_obj_hists) {
+		objs.push_back(it.first);
+	}
+
+	for (auto obj : objs) {
+		reclaimed += this->get_writable_obj_history(obj)->compact_before(horizon);
 	}
+
+	// changes and transactions before the horizon
+	// can no longer be rolled back or replayed.
+	this->log->modified_objs.drop_before(
+		horizon,
+		[&reclaimed] (const std::unordered_set<obj_id_t> &objs) {
+			reclaimed += objs.size() * (sizeof(obj_id_t) + sizeof(void *));
+		}
+	);
+
+	this->log->transactions.drop_before(
+		horizon,
+		[&reclaimed] (const std::vector<applied_transaction> &transactions) {
+			for (auto &transaction : transactions) {
+				reclaimed += (sizeof(applied_transaction)
+				              + transaction.patches.capacity() * sizeof(obj_id_t));
+			}
+		}
+	);
+
+	return reclaimed;
+}
+
+
+bool StateHistory::empty() const {
+	return this->first_record == LATEST_T;
+}
+
+
+order_t StateHistory::get_first_record() const {
+	return this->first_record;
 }
 
 
-const ObjectHistory *StateHistory::get_obj_history(const fqon_t &obj) const {
-	auto it = this->object_obj_hists.find(obj);
-	if (it != std::end(this->object_obj_hists)) {
-		return &it->second;
+const ObjectHistory *StateHistory::get_obj_history(obj_id_t obj) const {
+	const std::shared_ptr<ObjectHistory> *obj_hist = this->object_obj_hists.get(obj);
+	if (obj_hist == nullptr) {
+		return nullptr;
 	}
-	else {
+	return obj_hist->get();
+}
+
+
+ObjectHistory *StateHistory::get_writable_obj_history(obj_id_t obj) {
+	std::shared_ptr<ObjectHistory> *obj_hist = this->object_obj_hists.get_writable(obj);
+	if (obj_hist == nullptr) {
 		return nullptr;
 	}
+
+	// another copy of the state history uses it.
+	if (obj_hist->use_count() > 1) {
+		*obj_hist = std::make_shared<ObjectHistory>(**obj_hist);
+	}
+	return obj_hist->get();
+}
+
+
+ObjectHistory &StateHistory::get_create_obj_history(obj_id_t obj) {
+	ObjectHistory *obj_hist = this->get_writable_obj_history(obj);
+	if (obj_hist != nullptr) {
+		return *obj_hist;
+	}
+
+	// create new obj_history entry.
+	return *this->object_obj_hists.insert(obj, std::make_shared<ObjectHistory>());
 }
 
 
-ObjectHistory &StateHistory::get_create_obj_history(const fqon_t &obj) {
-	auto it = this->object_obj_hists.find(obj);
-	if (it != std::end(this->object_obj_hists)) {
-		return it->second;
+ObjectHistory &StateHistory::record_obj_history(obj_id_t obj, order_t t) {
+	std::unordered_set<obj_id_t> *objs = this->log->modified_objs.at_exact(t);
+	if (objs == nullptr) {
+		objs = &this->log->modified_objs.insert(t, std::unordered_set<obj_id_t>{});
 	}
-	else {
-		// create new obj_history entry.
-		return this->object_obj_hists.emplace(
-			obj, ObjectHistory{}
-		).first->second;
+	objs->insert(obj);
+
+	if (t < this->first_record) {
+		this->first_record = t;
 	}
+
+	return this->get_create_obj_history(obj);
 }
 
 } // namespace nyan
@@ -4,22 +4,53 @@
 #include <memory>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "config.h"
+#include "datastructure/persistent_map.h"
 #include "object_history.h"
 
 
 namespace nyan {
 
 class Database;
-class MetaInfo;
 class ObjectState;
 class State;
 
 
 
+/**
+ * Patches of a transaction that was applied in a view.
+ */
+struct applied_transaction {
+	/**
+	 * Identifies the transaction in all views it was applied in.
+	 * Transactions at the same time were committed in id order.
+	 */
+	transaction_id_t id;
+
+	/**
+	 * True if the transaction was committed on a parent view
+	 * and propagated to this one.
+	 */
+	bool inherited;
+
+	/**
+	 * The patches of the transaction, in order.
+	 */
+	std::vector<obj_id_t> patches;
+};
+
+
 /**
  * Object state history tracking.
+ *
+ * Copies of the history share the stored states, the histories of
+ * unchanged objects and the unchanged parts of the curves,
+ * modifying a copy doesn't change the others.
+ * The writer-only records (modified objects, transactions)
+ * are shared between copies instead.
  */
 class StateHistory {
 public:
@@ -38,22 +69,118 @@ public:
 	 * find the latest object state for a given object at t.
 	 * if there's no object state at t, take the latest state before t.
 	 */
-	const std::shared_ptr<ObjectState> *get_obj_state(const fqon_t &fqon, order_t t) const;
+	const std::shared_ptr<ObjectState> *get_obj_state(obj_id_t obj, order_t t) const;
 
 	void insert(std::shared_ptr<State> &&new_state, order_t t);
 
-	void insert_linearization(std::vector<fqon_t> &&ins, order_t t);
-	const std::vector<fqon_t> &get_linearization(const fqon_t &obj, order_t t,
-	                                             const MetaInfo &meta_info) const;
+	void insert_linearization(std::vector<obj_id_t> &&ins, order_t t);
 
-	void insert_children(const fqon_t &obj, std::unordered_set<fqon_t> &&ins, order_t t);
-	const std::unordered_set<fqon_t> &get_children(const fqon_t &obj, order_t t,
-	                                               const MetaInfo &meta_info) const;
+	/**
+	 * Return the linearization of the object at t,
+	 * or nullptr if this history has none for it.
+	 */
+	const std::vector<obj_id_t> *get_linearization(obj_id_t obj, order_t t) const;
+
+	void insert_children(obj_id_t obj, std::unordered_set<obj_id_t> &&ins, order_t t);
+
+	/**
+	 * Return the children of the object at t,
+	 * or nullptr if this history has none for it.
+	 */
+	const std::unordered_set<obj_id_t> *get_children(obj_id_t obj, order_t t) const;
+
+	void insert_descendants(obj_id_t obj, std::vector<obj_id_t> &&ins, order_t t);
+
+	/**
+	 * Return the transitive children of the object at t,
+	 * or nullptr if this history has none for it.
+	 */
+	const std::vector<obj_id_t> *get_descendants(obj_id_t obj, order_t t) const;
+
+	void insert_ancestry(obj_id_t obj, Ancestry &&ins, order_t t);
+
+	/**
+	 * Return the ancestors and members of the object at t,
+	 * or nullptr if this history has none for it.
+	 */
+	const Ancestry *get_ancestry(obj_id_t obj, order_t t) const;
+
+	/**
+	 * Return the cache for the member values of the object at t.
+	 * It has the values calculated since the object was patched last.
+	 * Returns nullptr if the object wasn't patched in this history until t.
+	 * Values can be added to the cache, also by concurrent readers,
+	 * that doesn't modify the history.
+	 */
+	ValueCache *get_values(obj_id_t obj, order_t t) const;
+
+	/**
+	 * Invalidate all cached values of the object from t on.
+	 * Call this for each object whose member values may have changed at t.
+	 */
+	void invalidate_values(obj_id_t obj, order_t t);
+
+	/**
+	 * Remember a transaction that was applied in this view at t.
+	 * Transactions at the same time are kept in the order they were applied.
+	 */
+	void record_transaction(applied_transaction &&transaction, order_t t);
+
+	/**
+	 * Return all recorded transactions, in the order they were applied.
+	 */
+	std::vector<std::pair<order_t, applied_transaction>>
+	get_transactions() const;
+
+	/**
+	 * Return the recorded transactions later than t, in the order
+	 * they have to be applied.
+	 */
+	std::vector<std::pair<order_t, applied_transaction>>
+	get_transactions_after(order_t t) const;
+
+	/**
+	 * Drop all states and object history records later than t.
+	 * Only the histories of objects modified after t are visited.
+	 */
+	void drop_after(order_t t);
+
+	/**
+	 * Fold all states earlier than the horizon into one state at DEFAULT_T
+	 * and drop the object history records that are no longer needed.
+	 * Queries at or after the horizon return the same results as before.
+	 * Returns the estimated number of bytes released.
+	 */
+	size_t compact_before(order_t horizon);
+
+	/**
+	 * True if no object has records in this history.
+	 */
+	bool empty() const;
+
+	/**
+	 * Return the earliest time an object has records for,
+	 * or LATEST_T if the history is empty.
+	 */
+	order_t get_first_record() const;
 
 protected:
-	ObjectHistory *get_obj_history(const fqon_t &obj);
-	const ObjectHistory *get_obj_history(const fqon_t &obj) const;
-	ObjectHistory &get_create_obj_history(const fqon_t &obj);
+	const ObjectHistory *get_obj_history(obj_id_t obj) const;
+
+	/**
+	 * Return the history of the object so it can be modified.
+	 * If it is shared with another copy of the state history,
+	 * it is copied first. The copy shares the curve chunks
+	 * that are not modified.
+	 */
+	ObjectHistory *get_writable_obj_history(obj_id_t obj);
+	ObjectHistory &get_create_obj_history(obj_id_t obj);
+
+	/**
+	 * Get or create the history of the object
+	 * and remember that it gets a record at t.
+	 */
+	ObjectHistory &record_obj_history(obj_id_t obj, order_t t);
 
 	/**
 	 * Storage of states over time.
@@ -63,8 +190,36 @@ protected:
 	/**
 	 * Information history for each object.
 	 * Optimizes searches in the history.
+	 * The histories are copied before they are modified
+	 * if another copy of the state history uses them.
+	 */
+	datastructure::PersistentMap<std::shared_ptr<ObjectHistory>> object_obj_hists;
+
+	/**
+	 * Earliest time of a record in the object histories.
+	 */
+	order_t first_record;
+
+	/**
+	 * Records that are only needed to modify the history.
+	 */
+	struct write_log {
+		/**
+		 * Objects whose history got records at each point in time.
+		 * Used to roll back the object histories without visiting all of them.
+		 */
+		Curve<std::unordered_set<obj_id_t>> modified_objs;
+
+		/**
+		 * Transactions applied in this view over time.
+		 */
+		Curve<std::vector<applied_transaction>> transactions;
+	};
+
+	/**
+	 * Writer-only records, shared with copies of this history.
 	 */
-	std::unordered_map<fqon_t, ObjectHistory> object_obj_hists;
+	std::shared_ptr<write_log> log;
 };
 
 
@@ -0,0 +1,100 @@
+// Copyright 2019-2019 the nyan authors, LGPLv3+. See copying.md for legal info.
+
+#include "symbol_table.h"
+
+#include <limits>
+
+#include "compiler.h"
+#include "error.h"
+
+
+namespace nyan {
+
+
+template <typename id_t>
+id_t SymbolTable::Table<id_t>::add(const std::string &name) {
+	auto it = this->ids.find(name);
+	if (it != std::end(this->ids)) {
+		return it->second;
+	}
+
+	if (unlikely(this->names.size() >= std::numeric_limits<id_t>::max())) {
+		throw InternalError{"symbol table is full"};
+	}
+
+	id_t new_id = static_cast<id_t>(this->names.size());
+	auto ins = this->ids.emplace(name, new_id);
+
+	// unordered_map keys are not moved on rehash,
+	// so we can refer to them.
+	this->names.push_back(&ins.first->first);
+
+	return new_id;
+}
+
+
+template <typename id_t>
+const id_t *SymbolTable::Table<id_t>::find(const std::string &name) const {
+	auto it = this->ids.find(name);
+	if (it == std::end(this->ids)) {
+		return nullptr;
+	}
+	return &it->second;
+}
+
+
+template <typename id_t>
+const std::string &SymbolTable::Table<id_t>::get_name(id_t id) const {
+	if (unlikely(id >= this->names.size())) {
+		throw InternalError{"unknown symbol id"};
+	}
+	return *this->names[id];
+}
+
+
+template <typename id_t>
+size_t SymbolTable::Table<id_t>::size() const {
+	return this->names.size();
+}
+
+
+obj_id_t SymbolTable::add_object(const fqon_t &name) {
+	return this->objects.add(name);
+}
+
+
+const obj_id_t *SymbolTable::get_object_id(const fqon_t &name) const {
+	return this->objects.find(name);
+}
+
+
+const fqon_t &SymbolTable::get_object_name(obj_id_t id) const {
+	return this->objects.get_name(id);
+}
+
+
+size_t SymbolTable::get_object_count() const {
+	return this->objects.size();
+}
+
+
+member_id_t SymbolTable::add_member(const memberid_t &name) {
+	return this->members.add(name);
+}
+
+
+const member_id_t *SymbolTable::get_member_id(const memberid_t &name) const {
+	return this->members.find(name);
+}
+
+
+const memberid_t &SymbolTable::get_member_name(member_id_t id) const {
+	return this->members.get_name(id);
+}
+
+
+size_t SymbolTable::get_member_count() const {
+	return this->members.size();
+}
+
+} // namespace nyan
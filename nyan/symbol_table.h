@@ -0,0 +1,123 @@
+// Copyright 2019-2019 the nyan authors, LGPLv3+. See copying.md for legal info.
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "config.h"
+
+
+namespace nyan {
+
+
+/**
+ * Interning table for the names used in a database.
+ * Each object and member name gets a dense integer id,
+ * so the database internals can hash and compare integers.
+ * Ids are never reused, the table only grows.
+ */
+class SymbolTable {
+public:
+	/**
+	 * Return the id of the object name.
+	 * The name is added to the table if it is not known yet.
+	 */
+	obj_id_t add_object(const fqon_t &name);
+
+	/**
+	 * Return a pointer to the id of the object name,
+	 * or nullptr if the name is not in the table.
+	 */
+	const obj_id_t *get_object_id(const fqon_t &name) const;
+
+	/**
+	 * Return the object name for the given id.
+	 */
+	const fqon_t &get_object_name(obj_id_t id) const;
+
+	/**
+	 * Return the number of known object names.
+	 * All object ids are smaller than this number.
+	 */
+	size_t get_object_count() const;
+
+	/**
+	 * Return the id of the member name.
+	 * The name is added to the table if it is not known yet.
+	 */
+	member_id_t add_member(const memberid_t &name);
+
+	/**
+	 * Return a pointer to the id of the member name,
+	 * or nullptr if the name is not in the table.
+	 */
+	const member_id_t *get_member_id(const memberid_t &name) const;
+
+	/**
+	 * Return the member name for the given id.
+	 */
+	const memberid_t &get_member_name(member_id_t id) const;
+
+	/**
+	 * Return the number of known member names.
+	 */
+	size_t get_member_count() const;
+
+	/**
+	 * Convert a list of object ids to their names.
+	 */
+	template <typename T>
+	std::vector<fqon_t> object_names(const T &ids) const {
+		std::vector<fqon_t> ret;
+		ret.reserve(ids.size());
+		for (auto &id : ids) {
+			ret.push_back(this->get_object_name(id));
+		}
+		return ret;
+	}
+
+protected:
+	/**
+	 * Name to id mapping of one kind of symbols.
+	 */
+	template <typename id_t>
+	class Table {
+	public:
+		Table() = default;
+
+		// the names point into the id map, so copying would break them.
+		Table(const Table &other) = delete;
+		Table(Table &&other) noexcept = default;
+		Table &operator =(const Table &other) = delete;
+		Table &operator =(Table &&other) noexcept = default;
+
+		id_t add(const std::string &name);
+		const id_t *find(const std::string &name) const;
+		const std::string &get_name(id_t id) const;
+		size_t size() const;
+
+	protected:
+		/**
+		 * name => id
+		 */
+		std::unordered_map<std::string, id_t> ids;
+
+		/**
+		 * id => name, points to the keys of the id map.
+		 */
+		std::vector<const std::string *> names;
+	};
+
+	/**
+	 * Fully-qualified object names.
+	 */
+	Table<obj_id_t> objects;
+
+	/**
+	 * Member names.
+	 */
+	Table<member_id_t> members;
+};
+
+} // namespace nyan
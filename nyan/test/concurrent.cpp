@@ -0,0 +1,139 @@
+// Copyright 2019-2019 the nyan authors, LGPLv3+. See copying.md for legal info.
+
+#include "test.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "../member_key.h"
+#include "../nyan.h"
+#include "../object_info.h"
+#include "../value_cache.h"
+
+
+namespace nyan::test {
+
+void concurrent_reads() {
+	auto db = load("history.nyan");
+	auto view = db->new_view();
+	view->set_concurrent_reads(true);
+
+	Object tank = view->get_object("history.Tank");
+	obj_id_t tank_id = tank.get_id();
+
+	// the published history may be freed any time, so it's
+	// only read with a guard, or by the thread committing.
+	TESTTHROWS(view->get_raw(tank_id), APIError);
+	{
+		View::ReadGuard guard{*view};
+		TESTCHECK(view->get_raw(tank_id) != nullptr);
+	}
+
+	constexpr int commits = 50;
+	std::atomic<bool> done{false};
+	std::atomic<int> bad_reads{0};
+
+	std::vector<std::thread> readers;
+	for (int i = 0; i < 4; i++) {
+		readers.emplace_back(
+			[&] {
+				while (not done) {
+					// each read sees a whole number of commits.
+					value_int_t hp = tank.get_int("hp");
+					if (hp > 100 or hp < 100 - 10 * commits or hp % 10 != 0) {
+						bad_reads += 1;
+					}
+				}
+			}
+		);
+	}
+
+	for (int i = 1; i <= commits; i++) {
+		Transaction tx = view->new_transaction(i * 2);
+		tx.add(view->get_object("history.Damage"));
+		TESTCHECK(tx.commit());
+	}
+
+	done = true;
+	for (auto &reader : readers) {
+		reader.join();
+	}
+
+	TESTEQUALS(bad_reads.load(), 0);
+
+	// the readers add the calculated values to the caches.
+	Object armored = view->get_object("history.Armored");
+	const MemberKey *plating = view->get_member_key("plating");
+	TESTEQUALS(armored.get_int("plating"), 3);
+	TESTCHECK(view->get_info(armored.get_id()).get_initial_values().get(plating->get_id()) != nullptr);
+	TESTEQUALS(tank.get_int("hp"), 100 - 10 * commits);
+
+	// the replayed transactions are built on the
+	// modified history, not on the published one.
+	Transaction tx = view->new_transaction(1);
+	tx.add(view->get_object("history.Heal"));
+	TESTCHECK(tx.commit());
+	TESTEQUALS(tank.get_int("hp", 1), 105);
+	TESTEQUALS(tank.get_int("hp", 4), 85);
+	TESTEQUALS(tank.get_int("hp"), 105 - 10 * commits);
+}
+
+
+void conflicts() {
+	auto db = load("history.nyan");
+	auto view = db->new_view();
+	Object tank = view->get_object("history.Tank");
+
+	// both are built from the same state of the unit,
+	// the second one is built again when it's committed.
+	Transaction damage = view->new_transaction(1);
+	Transaction heal = view->new_transaction(1);
+	TESTCHECK(damage.add(view->get_object("history.Damage")));
+	TESTCHECK(heal.add(view->get_object("history.Heal")));
+	TESTCHECK(damage.commit());
+	TESTCHECK(heal.commit());
+	TESTEQUALS(tank.get_int("hp", 1), 95);
+
+	// a child that got records meanwhile gets the transaction too.
+	Transaction late = view->new_transaction(2);
+	TESTCHECK(late.add(view->get_object("history.Damage")));
+	auto child = view->new_child();
+	Transaction own = child->new_transaction(3);
+	TESTCHECK(own.add(child->get_object("history.Plate")));
+	TESTCHECK(own.commit());
+	TESTCHECK(late.commit());
+	TESTEQUALS(child->get_object("history.Tank").get_int("hp", 3), 85);
+	TESTEQUALS(child->get_object("history.Tank").get_int("armor", 3), 11);
+
+	// transactions built on many threads at once lose no patch.
+	// they are applied in the child as well, which existed before.
+	view->set_concurrent_reads(true);
+	child->set_concurrent_reads(true);
+	constexpr int threads = 4;
+	constexpr int commits = 10;
+	std::vector<std::thread> writers;
+	std::atomic<int> failed{0};
+	for (int i = 0; i < threads; i++) {
+		writers.emplace_back(
+			[&] {
+				for (int j = 0; j < commits; j++) {
+					Transaction tx = view->new_transaction(4);
+					tx.add(view->get_object("history.Damage"));
+					if (not tx.commit()) {
+						failed += 1;
+					}
+				}
+			}
+		);
+	}
+	for (auto &writer : writers) {
+		writer.join();
+	}
+
+	TESTEQUALS(failed.load(), 0);
+	TESTEQUALS(tank.get_int("hp", 4), 85 - 10 * threads * commits);
+	TESTEQUALS(child->get_object("history.Tank").get_int("hp", 4), 85 - 10 * threads * commits);
+}
+
+} // namespace nyan::test
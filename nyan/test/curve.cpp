@@ -0,0 +1,93 @@
+// Copyright 2019-2019 the nyan authors, LGPLv3+. See copying.md for legal info.
+
+#include "test.h"
+
+#include "../curve.h"
+#include "../error.h"
+
+
+namespace nyan::test {
+
+void curve() {
+	Curve<int> curve;
+	TESTCHECK(curve.empty());
+	TESTCHECK(curve.at_find(5) == nullptr);
+
+	for (int i = 1; i <= 10; i++) {
+		curve.insert_drop(i * 10, int{i});
+	}
+
+	// lookups in increasing, decreasing and random order
+	// give the same results, whatever the cursor points to.
+	for (order_t t = 10; t <= 120; t++) {
+		TESTEQUALS(curve.at(t), static_cast<int>(std::min<order_t>(t / 10, 10)));
+	}
+	for (order_t t = 120; t >= 10; t--) {
+		TESTEQUALS(curve.at(t), static_cast<int>(std::min<order_t>(t / 10, 10)));
+	}
+	for (order_t t : {55, 10, 99, 100, 11, 70, 69}) {
+		TESTEQUALS(curve.at(t), static_cast<int>(t / 10));
+	}
+
+	TESTCHECK(curve.at_find(9) == nullptr);
+	TESTCHECK(curve.at_exact(55) == nullptr);
+	TESTEQUALS(*curve.at_exact(50), 5);
+	TESTEQUALS(curve.before(50), 4);
+	TESTTHROWS(curve.at(5), InternalError);
+
+	// insert keeps the later values, insert_drop removes them.
+	curve.insert(55, 55);
+	TESTEQUALS(curve.at(57), 55);
+	TESTEQUALS(curve.at(60), 6);
+
+	curve.insert_drop(65, 65);
+	TESTEQUALS(curve.at(1000), 65);
+	TESTCHECK(not curve.has_after(65));
+
+	curve.drop_after(30);
+	TESTEQUALS(curve.at(1000), 3);
+
+	size_t dropped = 0;
+	curve.compact_before(30, 0, [&] (int &) { dropped += 1; });
+	TESTEQUALS(dropped, 1u);
+	TESTEQUALS(curve.at(0), 2);
+	TESTEQUALS(curve.at(29), 2);
+	TESTEQUALS(curve.at(30), 3);
+
+	curve.drop_before(30, [] (int &) {});
+	TESTTHROWS(curve.at(29), InternalError);
+	TESTEQUALS(curve.at(31), 3);
+
+	// copies share the stored values,
+	// modifying one of them doesn't change the others.
+	Curve<int> original;
+	for (int i = 1; i <= 100; i++) {
+		original.insert_drop(i * 10, int{i});
+	}
+
+	Curve<int> copy{original};
+	copy.insert_drop(505, 505);
+	copy.insert(15, 15);
+	*copy.at_find(20) = 20;
+	*copy.at_exact(10) = 10;
+	copy.compact_before(100, 0, [] (int &) {});
+
+	for (order_t t = 10; t <= 1000; t += 10) {
+		TESTEQUALS(original.at(t), static_cast<int>(t / 10));
+	}
+	TESTEQUALS(copy.at(0), 9);
+	TESTEQUALS(copy.at(100), 10);
+	TESTEQUALS(copy.at(500), 50);
+	TESTEQUALS(copy.at(1000), 505);
+	TESTCHECK(not copy.has_after(505));
+
+	Curve<int> other{original};
+	other.drop_after(320);
+	other.insert_drop(330, 333);
+	TESTEQUALS(other.at(1000), 333);
+	TESTEQUALS(other.at(320), 32);
+	TESTEQUALS(original.at(330), 33);
+	TESTEQUALS(original.at(1000), 100);
+}
+
+} // namespace nyan::test
@@ -0,0 +1,39 @@
+// Copyright 2019-2019 the nyan authors, LGPLv3+. See copying.md for legal info.
+
+#include "test.h"
+
+#include <cstring>
+
+#include "../nyan.h"
+
+
+namespace nyan::test {
+
+void file_content() {
+	// the size is a multiple of the page size,
+	// so the null byte is behind the file mapping.
+	File page{data_path("file/page.txt")};
+	TESTEQUALS(page.size(), 4096u);
+	TESTEQUALS(std::strlen(page.c_str()), 4096u);
+	TESTEQUALS(page.get_line(64), std::string(63, 'x'));
+
+	// the content stays valid when the file is moved.
+	File moved{std::move(page)};
+	TESTEQUALS(moved.get_content().size(), 4096u);
+	TESTEQUALS(moved.c_str()[4096], '\0');
+
+	File empty{data_path("file/empty.txt")};
+	TESTEQUALS(empty.size(), 0u);
+	TESTEQUALS(std::strlen(empty.c_str()), 0u);
+
+#ifdef __linux__
+	// files without a known size are read.
+	File status{"/proc/self/status"};
+	TESTCHECK(status.size() > 0);
+	TESTEQUALS(std::strlen(status.c_str()), status.size());
+#endif
+
+	TESTTHROWS(File{data_path("file/missing.txt")}, FileReadError);
+}
+
+} // namespace nyan::test
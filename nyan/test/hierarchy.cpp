@@ -0,0 +1,125 @@
+// Copyright 2019-2019 the nyan authors, LGPLv3+. See copying.md for legal info.
+
+#include "test.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "../nyan.h"
+
+
+namespace nyan::test {
+
+/**
+ * Return the names of the transitive children of an object at t,
+ * and check that their ids are sorted.
+ */
+static std::vector<fqon_t> children_of(const std::shared_ptr<View> &view,
+                                       const fqon_t &name, order_t t) {
+	const auto &ids = view->get_obj_children_all(view->get_object(name).get_id(), t);
+	TESTCHECK(std::is_sorted(std::begin(ids), std::end(ids)));
+
+	std::vector<fqon_t> names = view->get_symbols().object_names(ids);
+	std::sort(std::begin(names), std::end(names));
+	return names;
+}
+
+
+void descendants() {
+	auto diamond = load("diamond.nyan")->new_view();
+	TESTCHECK(children_of(diamond, "diamond.a", 0) ==
+	          (std::vector<fqon_t>{"diamond.b", "diamond.c", "diamond.d"}));
+	TESTCHECK(children_of(diamond, "diamond.b", 0) == std::vector<fqon_t>{"diamond.d"});
+	TESTCHECK(children_of(diamond, "diamond.c", 0) == std::vector<fqon_t>{"diamond.d"});
+	TESTCHECK(children_of(diamond, "diamond.d", 0).empty());
+
+	// new parents get the patched object and its children.
+	auto db = load("history.nyan");
+	auto view = db->new_view();
+	auto child = view->new_child();
+	auto forked = view->fork(1);
+	patch(view, "history.Upgrade", 2);
+
+	const std::vector<fqon_t> upgraded{"history.Tank", "history.Unit"};
+	TESTCHECK(children_of(view, "history.Armored", 1).empty());
+	TESTCHECK(children_of(view, "history.Armored", 2) == upgraded);
+	TESTCHECK(children_of(view, "history.Unit", 2) == std::vector<fqon_t>{"history.Tank"});
+	TESTCHECK(children_of(child, "history.Armored", 2) == upgraded);
+	TESTCHECK(children_of(forked, "history.Armored", 2).empty());
+
+	// dropped with the transaction that added them.
+	view->reset_from(1);
+	TESTCHECK(children_of(view, "history.Armored", 2).empty());
+	TESTCHECK(children_of(child, "history.Armored", 2).empty());
+}
+
+
+void ancestry() {
+	auto diamond = load("diamond.nyan")->new_view();
+	Object a = diamond->get_object("diamond.a");
+	Object b = diamond->get_object("diamond.b");
+	Object d = diamond->get_object("diamond.d");
+
+	TESTCHECK(d.extends("diamond.a", 0));
+	TESTCHECK(d.extends("diamond.b", 0));
+	TESTCHECK(d.extends("diamond.c", 0));
+	TESTCHECK(d.extends("diamond.d", 0));
+	TESTCHECK(not a.extends("diamond.d", 0));
+	TESTCHECK(not b.extends("diamond.c", 0));
+	TESTCHECK(d.has("member", 0));
+
+	// members added by a patch are inherited by the children.
+	patch(diamond, "diamond.pb", 1);
+	TESTCHECK(not b.has("newmember", 0));
+	TESTCHECK(b.has("newmember", 1));
+	TESTCHECK(d.has("newmember", 1));
+	TESTCHECK(not a.has("newmember", 1));
+	TESTEQUALS(d.get_int("member", 1), 23);
+
+	// and so are parents added by a patch.
+	auto view = load("history.nyan")->new_view();
+	auto child = view->new_child();
+	Object tank = view->get_object("history.Tank");
+	patch(view, "history.Upgrade", 1);
+	TESTCHECK(not tank.extends("history.Armored", 0));
+	TESTCHECK(tank.extends("history.Armored", 1));
+	TESTCHECK(not tank.has("plating", 0));
+	TESTCHECK(tank.has("plating", 1));
+	TESTCHECK(child->get_object("history.Tank").has("plating", 1));
+
+	view->reset_from(0);
+	TESTCHECK(not tank.extends("history.Armored", 1));
+	TESTCHECK(not child->get_object("history.Tank").has("plating", 1));
+}
+
+
+void instances() {
+	auto diamond = load("diamond.nyan")->new_view();
+	auto ids = [&diamond] (std::vector<fqon_t> &&names) {
+		std::vector<obj_id_t> ret;
+		for (auto &name : names) {
+			ret.push_back(diamond->get_object(name).get_id());
+		}
+		std::sort(std::begin(ret), std::end(ret));
+		return ret;
+	};
+
+	// the type itself is no instance of it.
+	TESTCHECK(diamond->get_instances("diamond.a", 0) ==
+	          ids({"diamond.b", "diamond.c", "diamond.d"}));
+	TESTCHECK(diamond->get_instances("diamond.c") == ids({"diamond.d"}));
+	TESTCHECK(diamond->get_instances("diamond.d").empty());
+	TESTTHROWS(diamond->get_instances("diamond.missing"), ObjectNotFoundError);
+
+	// objects that got the type as parent are instances from then on.
+	auto view = load("history.nyan")->new_view();
+	patch(view, "history.Upgrade", 1);
+	const auto &armored = view->get_instances("history.Armored", 1);
+	TESTEQUALS(armored.size(), 2u);
+	TESTCHECK(std::find(std::begin(armored), std::end(armored),
+	                    view->get_object("history.Tank").get_id()) != std::end(armored));
+	TESTCHECK(view->get_instances("history.Armored", 0).empty());
+	TESTCHECK(view->get_instances("history.Armored") == armored);
+}
+
+} // namespace nyan::test
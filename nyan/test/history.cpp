@@ -0,0 +1,127 @@
+// Copyright 2019-2019 the nyan authors, LGPLv3+. See copying.md for legal info.
+
+#include "test.h"
+
+#include "../nyan.h"
+
+
+namespace nyan::test {
+
+void reset_from() {
+	auto db = load("history.nyan");
+	auto view = db->new_view();
+
+	Object tank = view->get_object("history.Tank");
+
+	patch(view, "history.Damage", 1);
+	patch(view, "history.Damage", 2);
+	TESTEQUALS(tank.get_int("hp", 2), 80);
+
+	auto child = view->new_child();
+	patch(child, "history.Heal", 3);
+	TESTEQUALS(child->get_object("history.Tank").get_int("hp", 3), 85);
+
+	// the child's own changes are dropped with the parent's,
+	// the state up to the reset time is kept.
+	view->reset_from(1);
+	TESTEQUALS(tank.get_int("hp", 1), 90);
+	TESTEQUALS(tank.get_int("hp", 2), 90);
+	TESTEQUALS(child->get_object("history.Tank").get_int("hp", 3), 90);
+
+	// resetting the child applies the kept parent changes again.
+	patch(view, "history.Damage", 2);
+	patch(child, "history.Heal", 3);
+	TESTEQUALS(child->get_object("history.Tank").get_int("hp", 3), 85);
+
+	child->reset_from(0);
+	TESTEQUALS(child->get_object("history.Tank").get_int("hp", 3), 80);
+	TESTEQUALS(child->get_object("history.Tank").get_int("hp", 1), 90);
+	TESTEQUALS(tank.get_int("hp", 3), 80);
+
+	// the cached values of the dropped states are gone too.
+	TESTEQUALS(tank.get_int("armor", 3), 10);
+	patch(view, "history.Plate", 3);
+	view->reset_from(2);
+	TESTEQUALS(tank.get_int("armor", 3), 10);
+}
+
+
+void replay() {
+	auto db = load("history.nyan");
+	auto view = db->new_view();
+	auto child = view->new_child();
+
+	Object tank = view->get_object("history.Tank");
+
+	patch(view, "history.Damage", 5);
+	patch(view, "history.Plate", 6);
+	patch(child, "history.Heal", 7);
+	TESTEQUALS(tank.get_int("hp", 6), 90);
+	TESTEQUALS(child->get_object("history.Tank").get_int("hp", 7), 95);
+
+	// the later transactions are applied again on top
+	// of the earlier one, in the view and its child.
+	patch(view, "history.Heal", 2);
+	TESTEQUALS(tank.get_int("hp", 1), 100);
+	TESTEQUALS(tank.get_int("hp", 2), 105);
+	TESTEQUALS(tank.get_int("hp", 5), 95);
+	TESTEQUALS(tank.get_int("armor", 5), 10);
+	TESTEQUALS(tank.get_int("armor", 6), 11);
+	TESTEQUALS(child->get_object("history.Tank").get_int("hp", 7), 100);
+	TESTEQUALS(child->get_object("history.Tank").get_int("armor", 7), 11);
+
+	// replayed transactions see the inheritance changed
+	// by the replayed transactions before them.
+	patch(view, "history.Upgrade", 8);
+	patch(view, "history.Damage", 9);
+	TESTEQUALS(tank.get_int("hp", 9), 135);
+
+	patch(view, "history.Damage", 3);
+	TESTEQUALS(tank.get_int("hp", 7), 85);
+	TESTEQUALS(tank.get_int("hp", 8), 135);
+	TESTEQUALS(tank.get_int("hp", 9), 125);
+	TESTEQUALS(tank.get_int("plating", 9), 3);
+	TESTCHECK(tank.extends("history.Armored", 8));
+	TESTCHECK(not tank.extends("history.Armored", 7));
+	TESTEQUALS(child->get_object("history.Tank").get_int("hp", 9), 130);
+}
+
+
+void compact_before() {
+	auto db = load("history.nyan");
+	auto view = db->new_view();
+	auto child = view->new_child();
+
+	Object tank = view->get_object("history.Tank");
+
+	patch(view, "history.Damage", 1);
+	patch(view, "history.Damage", 2);
+	patch(child, "history.Heal", 3);
+	patch(view, "history.Upgrade", 4);
+	patch(view, "history.Damage", 6);
+	TESTEQUALS(tank.get_int("hp", 5), 130);
+
+	TESTCHECK(view->compact_before(5) > 0);
+
+	// nothing is left to fold.
+	TESTEQUALS(view->compact_before(5), 0u);
+
+	// queries from the horizon on are not affected.
+	TESTEQUALS(tank.get_int("hp", 5), 130);
+	TESTEQUALS(tank.get_int("hp", 6), 120);
+	TESTEQUALS(tank.get_int("plating", 5), 3);
+	TESTCHECK(tank.extends("history.Armored", 5));
+	TESTEQUALS(child->get_object("history.Tank").get_int("hp", 5), 135);
+	TESTEQUALS(child->get_object("history.Tank").get_int("hp", 6), 125);
+
+	// transactions after the horizon can still be replayed and reset.
+	patch(view, "history.Heal", 5);
+	TESTEQUALS(tank.get_int("hp", 6), 125);
+	TESTEQUALS(child->get_object("history.Tank").get_int("hp", 6), 130);
+
+	view->reset_from(5);
+	TESTEQUALS(tank.get_int("hp", 6), 135);
+	TESTEQUALS(child->get_object("history.Tank").get_int("hp", 6), 140);
+}
+
+} // namespace nyan::test
@@ -0,0 +1,58 @@
+// Copyright 2019-2019 the nyan authors, LGPLv3+. See copying.md for legal info.
+
+#include "test.h"
+
+#include "../nyan.h"
+
+
+namespace nyan::test {
+
+/**
+ * Load a file of the test data directory with the given number of jobs.
+ */
+static std::shared_ptr<Database> load_jobs(const std::string &filename, size_t max_jobs) {
+	auto db = Database::create();
+	db->load(
+		filename,
+		[] (const std::string &filename) {
+			return std::make_shared<File>(data_path(filename));
+		},
+		max_jobs
+	);
+	return db;
+}
+
+
+void parallel_load() {
+	for (size_t jobs : {1, 2, 8}) {
+		auto db = load_jobs("load/main.nyan", jobs);
+		auto view = db->new_view();
+
+		Object main = view->get_object("load.main.Main");
+		TESTEQUALS(main.get_int("a"), 1);
+		TESTEQUALS(main.get_int("b"), 2);
+		TESTEQUALS(main.get_int("common"), 3);
+
+		// the files are stored in request order.
+		auto &files = db->get_files();
+		TESTEQUALS(files.size(), 4u);
+		TESTEQUALS(files[0].first, "load/main.nyan");
+		TESTEQUALS(files[1].first, "load/a.nyan");
+		TESTEQUALS(files[2].first, "load/b.nyan");
+		TESTEQUALS(files[3].first, "load/common.nyan");
+	}
+
+	// the first failed import is reported, no matter how many jobs run.
+	for (size_t jobs : {1, 2, 8}) {
+		try {
+			load_jobs("load/broken.nyan", jobs);
+		}
+		catch (LangError &err) {
+			TESTCHECK(err.str().find("missing") != std::string::npos);
+			continue;
+		}
+		TESTCHECK(not "load of load/broken.nyan did not fail");
+	}
+}
+
+} // namespace nyan::test
@@ -0,0 +1,91 @@
+// Copyright 2019-2019 the nyan authors, LGPLv3+. See copying.md for legal info.
+
+#include "test.h"
+
+#include "../nyan.h"
+
+
+namespace nyan::test {
+
+void symbols() {
+	auto db = load("lookup.nyan");
+	auto view = db->new_view();
+	const SymbolTable &symbols = view->get_symbols();
+
+	Object top = view->get_object("lookup.Top");
+	Object bottom = view->get_object("lookup.Bottom");
+
+	TESTCHECK(top.get_id() != bottom.get_id());
+	TESTEQUALS(symbols.get_object_name(top.get_id()), "lookup.Top");
+	TESTEQUALS(*symbols.get_object_id("lookup.Bottom"), bottom.get_id());
+	TESTCHECK(symbols.get_object_id("lookup.Missing") == nullptr);
+	TESTCHECK(symbols.get_member_id("missing") == nullptr);
+
+	// the same name always gets the same id.
+	TESTEQUALS(view->get_object("lookup.Top").get_id(), top.get_id());
+
+	TESTTHROWS(view->get_object("lookup.Missing"), ObjectNotFoundError);
+	TESTTHROWS(top.get_int("missing"), MemberNotFoundError);
+}
+
+
+void member_keys() {
+	auto db = load("lookup.nyan");
+	auto view = db->new_view();
+	Object bottom = view->get_object("lookup.Bottom");
+
+	// all members of an object state can be found by their key.
+	for (auto &name : {"a", "b", "left", "right", "bottom"}) {
+		const MemberKey *key = view->get_member_key(name);
+		TESTCHECK(key != nullptr);
+		TESTEQUALS(bottom.get_int(*key), bottom.get_int(name));
+		TESTCHECK(bottom.has(*key));
+	}
+	TESTCHECK(view->get_member_key("missing") == nullptr);
+
+	TESTEQUALS(bottom.get_int("a"), 111);
+	TESTEQUALS(bottom.get_int("b"), 22);
+
+	// a key can't be used to read a member the object doesn't have.
+	const MemberKey *extra = view->get_member_key("extra");
+	TESTCHECK(extra != nullptr);
+	TESTCHECK(not bottom.has(*extra));
+	TESTTHROWS(bottom.get_int(*extra), MemberNotFoundError);
+
+	// the member appears with the new parent.
+	Transaction tx = view->new_transaction(1);
+	tx.add(view->get_object("lookup.Extend"));
+	TESTCHECK(tx.commit());
+
+	TESTCHECK(bottom.has(*extra, 1));
+	TESTEQUALS(bottom.get_int(*extra, 1), 6);
+	TESTEQUALS(bottom.get_int("bottom", 1), 6);
+	TESTCHECK(not bottom.has(*extra, 0));
+}
+
+
+void linearization() {
+	auto db = load("lookup.nyan");
+	auto view = db->new_view();
+	Object bottom = view->get_object("lookup.Bottom");
+
+	TESTCHECK((bottom.get_linearized() == std::vector<fqon_t>{
+		"lookup.Bottom", "lookup.Left", "lookup.Right", "lookup.Top"
+	}));
+
+	Transaction tx = view->new_transaction(1);
+	tx.add(view->get_object("lookup.Extend"));
+	TESTCHECK(tx.commit());
+
+	TESTCHECK((bottom.get_linearized(1) == std::vector<fqon_t>{
+		"lookup.Bottom", "lookup.Left", "lookup.Right", "lookup.Top", "lookup.Extra"
+	}));
+	TESTEQUALS(bottom.get_linearized(0).size(), 4u);
+
+	// the parents' linearizations are unchanged.
+	TESTCHECK((view->get_object("lookup.Left").get_linearized(1) == std::vector<fqon_t>{
+		"lookup.Left", "lookup.Top"
+	}));
+}
+
+} // namespace nyan::test
@@ -0,0 +1,99 @@
+// Copyright 2019-2019 the nyan authors, LGPLv3+. See copying.md for legal info.
+
+#include "test.h"
+
+#include <vector>
+
+#include "../nyan.h"
+
+
+namespace nyan::test {
+
+void member_notifications() {
+	auto db = load("history.nyan");
+	auto view = db->new_view();
+	Object tank = view->get_object("history.Tank");
+
+	std::vector<order_t> all;
+	std::vector<order_t> armor;
+	auto all_notifier = tank.subscribe(
+		[&all] (order_t t, const fqon_t &, const ObjectState &) {
+			all.push_back(t);
+		}
+	);
+	auto armor_notifier = tank.subscribe(
+		{"armor"},
+		[&armor] (order_t t, const fqon_t &name, const ObjectState &) {
+			TESTEQUALS(name, "history.Tank");
+			armor.push_back(t);
+		}
+	);
+
+	// patches of other members don't notify.
+	patch(view, "history.Damage", 1);
+	patch(view, "history.Plate", 2);
+	patch(view, "history.Heal", 3);
+	TESTEQUALS(all.size(), 3u);
+	TESTEQUALS(armor.size(), 1u);
+	TESTEQUALS(armor.at(0), 2u);
+
+	// new parents may change all members.
+	patch(view, "history.Upgrade", 4);
+	TESTEQUALS(all.size(), 4u);
+	TESTEQUALS(armor.size(), 2u);
+	TESTEQUALS(armor.at(1), 4u);
+
+	// deleted notifiers are no longer called.
+	armor_notifier.reset();
+	patch(view, "history.Plate", 5);
+	TESTEQUALS(all.size(), 5u);
+	TESTEQUALS(armor.size(), 2u);
+}
+
+
+void async_notifications() {
+	auto db = load("history.nyan");
+	auto view = db->new_view();
+	view->set_async_notifications(true);
+	TESTCHECK(view->has_async_notifications());
+
+	Object tank = view->get_object("history.Tank");
+	std::vector<std::pair<order_t, value_int_t>> changes;
+	auto notifier = tank.subscribe(
+		{"hp"},
+		[&changes, &tank] (order_t t, const fqon_t &, const ObjectState &) {
+			changes.emplace_back(t, tank.get_int("hp", t));
+		}
+	);
+
+	// the commits only queue the notifications.
+	patch(view, "history.Damage", 1);
+	patch(view, "history.Heal", 2);
+	patch(view, "history.Plate", 3);
+	TESTEQUALS(changes.size(), 0u);
+
+	// they are dispatched in commit order, one entry per changed object.
+	TESTEQUALS(view->dispatch_notifications(), 6u);
+	TESTEQUALS(changes.size(), 2u);
+	TESTEQUALS(changes.at(0).first, 1u);
+	TESTEQUALS(changes.at(0).second, 90);
+	TESTEQUALS(changes.at(1).first, 2u);
+	TESTEQUALS(changes.at(1).second, 95);
+
+	// each change is dispatched once.
+	TESTEQUALS(view->dispatch_notifications(), 0u);
+	TESTEQUALS(changes.size(), 2u);
+
+	// children get the setting of their parent.
+	auto child = view->new_child();
+	TESTCHECK(child->has_async_notifications());
+
+	// with synchronous notifications the callbacks are called by the commit.
+	view->set_async_notifications(false);
+	patch(view, "history.Damage", 4);
+	TESTEQUALS(changes.size(), 3u);
+	TESTEQUALS(changes.at(2).second, 85);
+	TESTEQUALS(view->dispatch_notifications(), 0u);
+}
+
+} // namespace nyan::test
@@ -0,0 +1,84 @@
+// Copyright 2019-2019 the nyan authors, LGPLv3+. See copying.md for legal info.
+
+#include "test.h"
+
+#include "../nyan.h"
+#include "../object_info.h"
+#include "../patch_plan.h"
+
+
+namespace nyan::test {
+
+void add_all() {
+	auto db = load("history.nyan");
+	auto view = db->new_view();
+	auto other = db->new_view();
+	Object tank = view->get_object("history.Tank");
+
+	// patches of one target are applied in the given order.
+	Transaction tx = view->new_transaction(1);
+	TESTCHECK(tx.add_all({
+		view->get_object("history.Damage"),
+		view->get_object("history.Plate"),
+		view->get_object("history.Upgrade"),
+		view->get_object("history.Damage"),
+	}));
+	TESTCHECK(tx.commit());
+
+	TESTEQUALS(tank.get_int("hp", 1), 130);
+	TESTEQUALS(tank.get_int("armor", 1), 11);
+	TESTCHECK(tank.extends("history.Armored", 1));
+	TESTEQUALS(tank.get_int("plating", 1), 3);
+	TESTEQUALS(tank.get_int("hp", 0), 100);
+
+	// the same patches added one by one give the same result.
+	Transaction single = other->new_transaction(1);
+	for (auto &name : {"history.Damage", "history.Plate",
+	                   "history.Upgrade", "history.Damage"}) {
+		TESTCHECK(single.add(other->get_object(name)));
+	}
+	TESTCHECK(single.commit());
+	TESTEQUALS(other->get_object("history.Tank").get_int("hp", 1), 130);
+	TESTEQUALS(other->get_object("history.Tank").get_int("armor", 1), 11);
+
+	// nothing is added if one of them is no patch.
+	Transaction invalid = view->new_transaction(2);
+	TESTCHECK(not invalid.add_all({
+		view->get_object("history.Heal"),
+		view->get_object("history.Unit"),
+	}));
+	TESTCHECK(invalid.commit());
+	TESTEQUALS(tank.get_int("hp", 2), 130);
+}
+
+
+void patch_plans() {
+	auto db = load("plans.nyan");
+	auto view = db->new_view();
+	Object unit = view->get_object("plans.Unit");
+
+	// patches whose linearization is never patched are compiled.
+	const PatchPlan *upgrade = view->get_object("plans.Upgrade").get_info().get_patch_plan();
+	TESTCHECK(upgrade != nullptr);
+	TESTEQUALS(upgrade->get_parent_changes().size(), 1u);
+	TESTEQUALS(upgrade->get_member_changes().size(), 1u);
+	TESTCHECK(view->get_object("plans.Boost").get_info().get_patch_plan() != nullptr);
+
+	// a patch that is patched itself is applied from its current state.
+	TESTCHECK(view->get_object("plans.Heal").get_info().get_patch_plan() == nullptr);
+
+	patch(view, "plans.Heal", 1);
+	TESTEQUALS(unit.get_int("hp", 1), 105);
+
+	patch(view, "plans.Boost", 2);
+	patch(view, "plans.Heal", 3);
+	TESTEQUALS(unit.get_int("hp", 3), 115);
+
+	patch(view, "plans.Upgrade", 4);
+	TESTEQUALS(unit.get_int("hp", 4), 165);
+	TESTCHECK(unit.extends("plans.Armored", 4));
+	TESTCHECK(not unit.extends("plans.Armored", 3));
+	TESTEQUALS(unit.get_int("plating", 4), 3);
+}
+
+} // namespace nyan::test
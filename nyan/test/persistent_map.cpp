@@ -0,0 +1,63 @@
+// Copyright 2019-2019 the nyan authors, LGPLv3+. See copying.md for legal info.
+
+#include "test.h"
+
+#include <vector>
+
+#include "../datastructure/persistent_map.h"
+
+
+namespace nyan::test {
+
+void persistent_map() {
+	using map_t = datastructure::PersistentMap<int>;
+
+	// these keys only differ in the highest bits,
+	// so they are stored in the deepest trie level.
+	std::vector<uint32_t> keys{
+		0x00000001, 0x40000001, 0x80000001, 0xc0000001,
+		0x02000001, 0x42000001, 0xffffffff, 0x7fffffff,
+		0, 1 << 5, 1 << 10, 1 << 15, 1 << 20, 1 << 25, 1u << 30,
+	};
+
+	map_t map;
+	int value = 0;
+	for (uint32_t key : keys) {
+		map.insert(key, int{value++});
+	}
+	TESTEQUALS(map.size(), keys.size());
+
+	for (size_t i = 0; i < keys.size(); i++) {
+		const int *stored = map.get(keys[i]);
+		TESTCHECK(stored != nullptr);
+		TESTEQUALS(*stored, static_cast<int>(i));
+	}
+	TESTCHECK(map.get(0x80000000) == nullptr);
+	TESTCHECK(map.get(2) == nullptr);
+
+	size_t count = 0;
+	for (auto &entry : map) {
+		TESTEQUALS(*map.get(entry.first), entry.second);
+		count += 1;
+	}
+	TESTEQUALS(count, keys.size());
+
+	// copies share the nodes, but are modified independently.
+	map_t copy = map;
+	*copy.get_writable(0xc0000001) = 100;
+	copy.insert(0x80000001, 200);
+	TESTCHECK(copy.erase(0x40000001));
+	TESTCHECK(not copy.erase(0x40000001));
+
+	TESTEQUALS(*copy.get(0xc0000001), 100);
+	TESTEQUALS(*copy.get(0x80000001), 200);
+	TESTCHECK(copy.get(0x40000001) == nullptr);
+	TESTEQUALS(copy.size(), keys.size() - 1);
+
+	TESTEQUALS(*map.get(0xc0000001), 3);
+	TESTEQUALS(*map.get(0x80000001), 2);
+	TESTEQUALS(*map.get(0x40000001), 1);
+	TESTEQUALS(map.size(), keys.size());
+}
+
+} // namespace nyan::test
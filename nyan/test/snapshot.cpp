@@ -0,0 +1,102 @@
+// Copyright 2019-2019 the nyan authors, LGPLv3+. See copying.md for legal info.
+
+#include "test.h"
+
+#include <cstring>
+#include <fstream>
+
+#include "../nyan.h"
+#include "../state.h"
+#include "../util.h"
+
+
+namespace nyan::test {
+
+/**
+ * Snapshot file, created in the working directory of the test.
+ */
+static const std::string snapshot_file = "nyantest.snapshot";
+
+
+static std::shared_ptr<File> fetch(const std::string &filename) {
+	return std::make_shared<File>(data_path(filename));
+}
+
+
+/**
+ * Same hash as the snapshot uses to detect damaged content,
+ * so the tests can damage snapshots that look intact.
+ */
+static uint64_t content_hash(const std::string &data, size_t size) {
+	uint64_t hash = 0xcbf29ce484222325;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= static_cast<unsigned char>(data[i]);
+		hash *= 0x100000001b3;
+	}
+	return hash;
+}
+
+
+static void write_snapshot(std::string data) {
+	uint64_t hash = content_hash(data, data.size() - sizeof(hash));
+	std::memcpy(&data[data.size() - sizeof(hash)], &hash, sizeof(hash));
+
+	std::ofstream output{snapshot_file, std::ofstream::out | std::ofstream::binary};
+	output.write(data.data(), static_cast<std::streamsize>(data.size()));
+}
+
+
+void snapshot_roundtrip() {
+	auto db = load("lookup.nyan");
+	db->store_snapshot(snapshot_file);
+
+	auto restored = Database::create();
+	TESTCHECK(restored->load_snapshot(snapshot_file, &fetch));
+	TESTEQUALS(restored->get_files().size(), db->get_files().size());
+
+	// a snapshot can only be loaded into an empty database.
+	TESTTHROWS(restored->load_snapshot(snapshot_file, &fetch), InternalError);
+
+	auto view = restored->new_view();
+	Object bottom = view->get_object("lookup.Bottom");
+	TESTEQUALS(bottom.get_int("a"), 111);
+	TESTEQUALS(bottom.get_int("right"), 4);
+	TESTCHECK(bottom.extends("lookup.Left"));
+	TESTEQUALS(bottom.get_linearized().size(), 4u);
+	TESTEQUALS(view->get_instances("lookup.Top").size(), 3u);
+
+	// the patches of the snapshot can be applied.
+	Transaction tx = view->new_transaction(1);
+	tx.add(view->get_object("lookup.Extend"));
+	TESTCHECK(tx.commit());
+	TESTEQUALS(bottom.get_int("extra", 1), 6);
+	TESTCHECK(bottom.extends("lookup.Extra", 1));
+
+	// damaged snapshots are rejected and leave the database empty.
+	std::string data = util::read_file(snapshot_file, true);
+	size_t accepted = 0;
+	for (size_t i = 8; i < data.size() - sizeof(uint64_t); i++) {
+		std::string damaged = data;
+		damaged[i] = static_cast<char>(~damaged[i]);
+		write_snapshot(std::move(damaged));
+
+		auto target = Database::create();
+		if (target->load_snapshot(snapshot_file, &fetch)) {
+			// names and locations can be changed without breaking anything.
+			accepted += 1;
+			continue;
+		}
+		TESTEQUALS(target->get_files().size(), 0u);
+		TESTEQUALS(target->get_info().get_objects().size(), 0u);
+		TESTEQUALS(target->get_state()->get_objects().size(), 0u);
+	}
+	TESTCHECK(accepted < data.size() / 2);
+
+	// truncated snapshots are rejected as well.
+	write_snapshot(data.substr(0, data.size() / 2) + std::string(sizeof(uint64_t), '\0'));
+	TESTCHECK(not Database::create()->load_snapshot(snapshot_file, &fetch));
+
+	std::remove(snapshot_file.c_str());
+}
+
+} // namespace nyan::test
@@ -0,0 +1,159 @@
+// Copyright 2019-2019 the nyan authors, LGPLv3+. See copying.md for legal info.
+
+/**
+ * Runs the behavior tests.
+ *
+ * usage: nyantest <test data directory> [test name...]
+ * Without test names, all tests are run.
+ */
+
+#include "test.h"
+
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#include "../nyan.h"
+
+
+namespace nyan::test {
+
+/**
+ * Directory the test data files are loaded from.
+ */
+static std::string data_dir;
+
+
+/**
+ * All test cases by name.
+ */
+static const std::vector<std::pair<std::string, void (*)()>> test_cases{
+	{"value_cache", &value_cache},
+	{"symbols", &symbols},
+	{"member_keys", &member_keys},
+	{"linearization", &linearization},
+	{"parallel_load", &parallel_load},
+	{"file_content", &file_content},
+	{"snapshot_roundtrip", &snapshot_roundtrip},
+	{"inline_values", &inline_values},
+	{"persistent_map", &persistent_map},
+	{"curve", &curve},
+	{"reset_from", &reset_from},
+	{"replay", &replay},
+	{"compact_before", &compact_before},
+	{"concurrent_reads", &concurrent_reads},
+	{"child_views", &child_views},
+	{"fork_view", &fork_view},
+	{"merge", &merge},
+	{"add_all", &add_all},
+	{"patch_plans", &patch_plans},
+	{"conflicts", &conflicts},
+	{"member_notifications", &member_notifications},
+	{"async_notifications", &async_notifications},
+	{"descendants", &descendants},
+	{"ancestry", &ancestry},
+	{"instances", &instances},
+};
+
+
+TestError::TestError(const std::string &msg)
+	:
+	std::runtime_error{msg} {}
+
+
+void check(bool condition, const char *expr, const char *file, int line) {
+	if (not condition) {
+		std::ostringstream msg;
+		msg << file << ":" << line << ": " << expr << " is false";
+		throw TestError{msg.str()};
+	}
+}
+
+
+std::string data_path(const std::string &filename) {
+	return data_dir + "/" + filename;
+}
+
+
+std::shared_ptr<Database> load(const std::string &filename) {
+	auto db = Database::create();
+	db->load(
+		filename,
+		[] (const std::string &filename) {
+			return std::make_shared<File>(data_path(filename));
+		}
+	);
+	return db;
+}
+
+
+void patch(const std::shared_ptr<View> &view, const fqon_t &patch, order_t t) {
+	Transaction tx = view->new_transaction(t);
+	tx.add(view->get_object(patch));
+	TESTCHECK(tx.commit());
+}
+
+
+/**
+ * Run a test case and report the result.
+ * Returns true if it passed.
+ */
+static bool run_test(const std::string &name, void (*func)()) {
+	try {
+		func();
+		std::cout << "[ OK ] " << name << std::endl;
+		return true;
+	}
+	catch (TestError &err) {
+		std::cout << "[FAIL] " << name << ": " << err.what() << std::endl;
+	}
+	catch (LangError &err) {
+		std::cout << "[FAIL] " << name << ": " << err << std::endl
+		          << err.show_problem_origin() << std::endl;
+	}
+	catch (Error &err) {
+		std::cout << "[FAIL] " << name << ": " << err << std::endl;
+	}
+	catch (std::exception &err) {
+		std::cout << "[FAIL] " << name << ": " << err.what() << std::endl;
+	}
+	return false;
+}
+
+} // namespace nyan::test
+
+
+int main(int argc, char **argv) {
+	using namespace nyan::test;
+
+	if (argc < 2) {
+		std::cerr << "usage: " << argv[0] << " <test data directory> [test name...]" << std::endl;
+		return 1;
+	}
+
+	data_dir = argv[1];
+
+	size_t failed = 0;
+	size_t run = 0;
+	for (auto &test_case : test_cases) {
+		if (argc > 2) {
+			bool requested = false;
+			for (int i = 2; i < argc; i++) {
+				if (test_case.first == argv[i]) {
+					requested = true;
+				}
+			}
+			if (not requested) {
+				continue;
+			}
+		}
+
+		run += 1;
+		if (not run_test(test_case.first, test_case.second)) {
+			failed += 1;
+		}
+	}
+
+	std::cout << std::endl << (run - failed) << "/" << run << " tests passed" << std::endl;
+	return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,125 @@
+// Copyright 2019-2019 the nyan authors, LGPLv3+. See copying.md for legal info.
+#pragma once
+
+/**
+ * @file
+ * Minimal harness for the behavior tests of the nyan library.
+ * Each test case loads the files it needs from the test data
+ * directory and checks the results with the macros below.
+ */
+
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "../config.h"
+
+
+namespace nyan {
+
+class Database;
+class View;
+
+} // namespace nyan
+
+
+namespace nyan::test {
+
+/**
+ * Raised when a check of a test case fails.
+ */
+class TestError : public std::runtime_error {
+public:
+	TestError(const std::string &msg);
+};
+
+
+/**
+ * Load a file of the test data directory into a new database.
+ */
+std::shared_ptr<Database> load(const std::string &filename);
+
+/**
+ * Return the path of a file in the test data directory.
+ */
+std::string data_path(const std::string &filename);
+
+/**
+ * Commit a transaction with the given patch at time t
+ * and check that it succeeded.
+ */
+void patch(const std::shared_ptr<View> &view, const fqon_t &patch, order_t t);
+
+
+template <typename A, typename B>
+void check_equal(const A &value, const B &expected,
+                 const char *expr, const char *file, int line) {
+	if (not (value == expected)) {
+		std::ostringstream msg;
+		msg << file << ":" << line << ": "
+		    << expr << " is " << value << ", expected " << expected;
+		throw TestError{msg.str()};
+	}
+}
+
+
+void check(bool condition, const char *expr, const char *file, int line);
+
+
+/**
+ * Run the statement and check that it throws the given exception type.
+ */
+template <typename E, typename F>
+void check_throws(F &&func, const char *expr, const char *file, int line) {
+	try {
+		func();
+	}
+	catch (E &) {
+		return;
+	}
+
+	std::ostringstream msg;
+	msg << file << ":" << line << ": " << expr << " did not throw";
+	throw TestError{msg.str()};
+}
+
+
+#define TESTEQUALS(value, expected) \
+	::nyan::test::check_equal((value), (expected), #value, __FILE__, __LINE__)
+
+#define TESTCHECK(condition) \
+	::nyan::test::check((condition), #condition, __FILE__, __LINE__)
+
+#define TESTTHROWS(statement, exception) \
+	::nyan::test::check_throws<exception>([&] { statement; }, #statement, __FILE__, __LINE__)
+
+
+// test cases, grouped by the feature they cover.
+void value_cache();
+void symbols();
+void member_keys();
+void linearization();
+void parallel_load();
+void file_content();
+void snapshot_roundtrip();
+void inline_values();
+void persistent_map();
+void curve();
+void reset_from();
+void replay();
+void compact_before();
+void concurrent_reads();
+void child_views();
+void fork_view();
+void merge();
+void add_all();
+void patch_plans();
+void conflicts();
+void member_notifications();
+void async_notifications();
+void descendants();
+void ancestry();
+void instances();
+
+} // namespace nyan::test
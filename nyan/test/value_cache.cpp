@@ -0,0 +1,53 @@
+// Copyright 2019-2019 the nyan authors, LGPLv3+. See copying.md for legal info.
+
+#include "test.h"
+
+#include "../nyan.h"
+
+
+namespace nyan::test {
+
+void value_cache() {
+	auto db = load("cache.nyan");
+	auto view = db->new_view();
+
+	Object base = view->get_object("cache.Base");
+	Object child = view->get_object("cache.Child");
+
+	// the second read is served by the cache.
+	TESTEQUALS(child.get_int("value"), 15);
+	TESTEQUALS(child.get_int("value"), 15);
+
+	// patching the parent invalidates the cached child value from t on.
+	Transaction tx = view->new_transaction(1);
+	tx.add(view->get_object("cache.Increase"));
+	TESTCHECK(tx.commit());
+
+	TESTEQUALS(child.get_int("value", 0), 15);
+	TESTEQUALS(child.get_int("value", 1), 16);
+	TESTEQUALS(base.get_int("value"), 11);
+
+	Transaction tx2 = view->new_transaction(2);
+	tx2.add(view->get_object("cache.Increase"));
+	TESTCHECK(tx2.commit());
+
+	TESTEQUALS(child.get_int("value", 1), 16);
+	TESTEQUALS(child.get_int("value", 2), 17);
+
+	// values handed out are copies, modifying them doesn't change the cache.
+	auto names = base.get<Set>("names");
+	names->clear();
+	TESTEQUALS(base.get_set("names").size(), 2u);
+
+	// text stays valid after the cached value was invalidated.
+	// text values keep the quotes of their literal.
+	std::string label = base.get_text("label");
+	Transaction tx3 = view->new_transaction(3);
+	tx3.add(view->get_object("cache.Rename"));
+	TESTCHECK(tx3.commit());
+	TESTEQUALS(label, "\"base\"");
+	TESTEQUALS(child.get_text("label"), "\"renamed\"");
+	TESTEQUALS(child.get_text("label", 2), "\"base\"");
+}
+
+} // namespace nyan::test
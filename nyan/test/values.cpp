@@ -0,0 +1,48 @@
+// Copyright 2019-2019 the nyan authors, LGPLv3+. See copying.md for legal info.
+
+#include "test.h"
+
+#include "../nyan.h"
+
+
+namespace nyan::test {
+
+void inline_values() {
+	auto db = load("values.nyan");
+	auto view = db->new_view();
+	Object scalars = view->get_object("values.Scalars");
+
+	ValueHolder count = scalars.get_value("count");
+	ValueHolder ratio = scalars.get_value("ratio");
+	ValueHolder flag = scalars.get_value("flag");
+	TESTCHECK(count.is_inline());
+	TESTCHECK(ratio.is_inline());
+	TESTCHECK(flag.is_inline());
+	TESTCHECK(not scalars.get_value("things").is_inline());
+
+	Transaction tx = view->new_transaction(1);
+	tx.add(view->get_object("values.Change"));
+	TESTCHECK(tx.commit());
+
+	TESTEQUALS(scalars.get_int("count", 1), 12);
+	TESTEQUALS(scalars.get_float("ratio", 1), 0.75);
+	TESTEQUALS(scalars.get_bool("flag", 1), true);
+	TESTEQUALS(scalars.get_set("things", 1).size(), 3u);
+
+	// the holders taken before the patch keep their values.
+	TESTEQUALS(*scalars.get<Int>("count", 0), Int{3});
+	TESTCHECK(count == scalars.get_value("count", 0));
+	TESTCHECK(count != scalars.get_value("count", 1));
+
+	// copies of inline values are independent.
+	ValueHolder copy = count;
+	copy = scalars.get_value("count", 1);
+	TESTCHECK(copy.is_inline());
+	TESTEQUALS(count->str(), "3");
+	TESTEQUALS(copy->str(), "12");
+
+	ValueHolder moved = std::move(copy);
+	TESTEQUALS(moved->str(), "12");
+}
+
+} // namespace nyan::test
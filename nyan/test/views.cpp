@@ -0,0 +1,132 @@
+// Copyright 2019-2019 the nyan authors, LGPLv3+. See copying.md for legal info.
+
+#include "test.h"
+
+#include "../nyan.h"
+
+
+namespace nyan::test {
+
+/**
+ * Return the hp of the tank in the view at t.
+ */
+static value_int_t hp(const std::shared_ptr<View> &view, order_t t) {
+	return view->get_object("history.Tank").get_int("hp", t);
+}
+
+
+void child_views() {
+	auto db = load("history.nyan");
+	auto view = db->new_view();
+	auto child = view->new_child();
+	auto grandchild = child->new_child();
+
+	obj_id_t unit = view->get_object("history.Unit").get_id();
+	obj_id_t armored = view->get_object("history.Armored").get_id();
+
+	int notified = 0;
+	auto notifier = grandchild->get_object("history.Tank").subscribe(
+		[&notified] (order_t, const fqon_t &, const ObjectState &) {
+			notified += 1;
+		}
+	);
+
+	// the children read the parent's states as long as they have no changes.
+	patch(view, "history.Damage", 1);
+	TESTEQUALS(hp(child, 1), 90);
+	TESTEQUALS(hp(grandchild, 1), 90);
+	TESTCHECK(child->get_raw(unit, 1) == view->get_raw(unit, 1));
+	TESTCHECK(grandchild->get_raw(unit, 1) == view->get_raw(unit, 1));
+	TESTEQUALS(notified, 1);
+
+	// a change of the child isn't seen by its parent.
+	patch(child, "history.Heal", 2);
+	TESTEQUALS(hp(view, 2), 90);
+	TESTEQUALS(hp(child, 2), 95);
+	TESTEQUALS(hp(grandchild, 2), 95);
+	TESTEQUALS(notified, 2);
+
+	// later parent changes are applied in the changed child,
+	// its own child still reads them from there.
+	patch(view, "history.Damage", 3);
+	TESTEQUALS(hp(view, 3), 80);
+	TESTEQUALS(hp(child, 3), 85);
+	TESTEQUALS(hp(grandchild, 3), 85);
+	TESTCHECK(child->get_raw(unit, 3) != view->get_raw(unit, 3));
+	TESTCHECK(grandchild->get_raw(unit, 3) == child->get_raw(unit, 3));
+	TESTEQUALS(notified, 3);
+
+	// objects the child never changed are still read from the parent.
+	TESTCHECK(child->get_raw(armored, 3) == view->get_raw(armored, 3));
+}
+
+
+void fork_view() {
+	auto db = load("history.nyan");
+	auto view = db->new_view();
+
+	patch(view, "history.Damage", 1);
+	auto forked = view->fork(2);
+	TESTEQUALS(forked->get_fork_time(), 2u);
+
+	// the fork shares the parent's history until the fork time.
+	TESTEQUALS(hp(forked, 5), 90);
+	patch(view, "history.Damage", 1);
+	TESTEQUALS(hp(forked, 5), 80);
+
+	// later parent changes are not seen in the fork.
+	patch(view, "history.Damage", 3);
+	TESTEQUALS(hp(view, 5), 70);
+	TESTEQUALS(hp(forked, 5), 80);
+
+	// and the fork's changes are not seen in the parent.
+	patch(forked, "history.Heal", 4);
+	TESTEQUALS(hp(forked, 5), 85);
+	TESTEQUALS(hp(view, 5), 70);
+
+	// parent changes before the fork time still reach the diverged fork.
+	patch(view, "history.Damage", 1);
+	TESTEQUALS(hp(forked, 5), 75);
+	TESTEQUALS(hp(view, 5), 60);
+}
+
+
+void merge() {
+	auto db = load("history.nyan");
+	auto view = db->new_view();
+	auto forked = view->fork(1);
+
+	std::vector<fqon_t> hp_changes;
+	std::vector<fqon_t> armor_changes;
+	auto hp_notifier = view->get_object("history.Tank").subscribe(
+		{"hp"},
+		[&hp_changes] (order_t, const fqon_t &name, const ObjectState &) {
+			hp_changes.push_back(name);
+		}
+	);
+	auto armor_notifier = view->get_object("history.Tank").subscribe(
+		{"armor"},
+		[&armor_changes] (order_t, const fqon_t &name, const ObjectState &) {
+			armor_changes.push_back(name);
+		}
+	);
+
+	// both change the same object after the fork.
+	patch(view, "history.Damage", 2);
+	patch(forked, "history.Heal", 3);
+	TESTEQUALS(hp(view, 3), 90);
+	TESTEQUALS(hp(forked, 3), 105);
+	TESTEQUALS(hp_changes.size(), 1u);
+
+	// the merge keeps the change of the parent.
+	TESTCHECK(view->merge(forked, 3));
+	TESTEQUALS(hp(view, 3), 95);
+	TESTEQUALS(hp(view, 2), 90);
+	TESTEQUALS(view->get_object("history.Tank").get_int("armor", 3), 10);
+
+	// only the members the child's patches changed are reported.
+	TESTEQUALS(hp_changes.size(), 2u);
+	TESTEQUALS(armor_changes.size(), 0u);
+}
+
+} // namespace nyan::test
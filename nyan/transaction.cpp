@@ -2,17 +2,28 @@
 
 #include "transaction.h"
 
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+
+#include "ancestry.h"
 #include "c3.h"
+#include "object_info.h"
 #include "object_state.h"
+#include "patch_info.h"
+#include "patch_plan.h"
 #include "state.h"
 #include "view.h"
 
 
 namespace nyan {
 
-// TODO think about parallel transactions:
-// parralel ones in the future don't matter as we'll overwrite them
-// ones that happen before must invalidate this one!
+/**
+ * Id of the next committed transaction.
+ * 0 is never used, so it means that no transaction was committed.
+ */
+static std::atomic<transaction_id_t> next_transaction_id{1};
 
 
 Transaction::Transaction(order_t at, std::shared_ptr<View> &&origin)
@@ -20,8 +31,18 @@ Transaction::Transaction(order_t at, std::shared_ptr<View> &&origin)
 	valid{true},
 	at{at} {
 
-	auto create_state_mod = [this] (std::shared_ptr<View> &&view) {
-		StateHistory &view_history = view->get_state_history();
+	View::WriteGuard lock{*origin};
+	this->create_states(std::move(origin));
+}
+
+
+void Transaction::create_states(std::shared_ptr<View> &&origin) {
+	// transactions committed from now on may change what we read.
+	this->begin = next_transaction_id;
+
+	for (auto &view : this->find_views(std::move(origin))) {
+		View::ReadGuard guard{*view};
+		const StateHistory &view_history = view->read_state_history();
 
 		// use this as parent state
 		// might return the database initial state.
@@ -37,20 +58,24 @@ Transaction::Transaction(order_t at, std::shared_ptr<View> &&origin)
 		this->states.push_back({
 			std::move(view),
 			std::move(new_view_state),
+			{},
 			{}
 		});
-	};
+	}
+}
 
-	// first, perform transaction on the requested view
-	create_state_mod(std::move(origin));
 
-	// this is actually the `origin` view, but we've moved it there.
-	auto &main_view = this->states.at(0).view;
+std::vector<std::shared_ptr<View>>
+Transaction::find_views(std::shared_ptr<View> &&origin) const {
+	std::vector<std::shared_ptr<View>> views;
+
+	// first, perform transaction on the requested view
+	views.push_back(std::move(origin));
 
 	// recursively visit all of the view's children and their children
 	// lol C++
 	std::function<void(const std::shared_ptr<View>&)> recurse =
-	[&create_state_mod, &recurse] (const std::shared_ptr<View> &view) {
+	[this, &views, &recurse] (const std::shared_ptr<View> &view) {
 		bool view_has_stale_children = false;
 
 		// also apply the transaction in all childs of the view.
@@ -64,9 +89,25 @@ Transaction::Transaction(order_t at, std::shared_ptr<View> &&origin)
 				continue;
 			}
 
+			// forks don't see the transaction, neither do their children.
+			if (target_child_view->fork_time < this->at) {
+				continue;
+			}
+
+			// the merged view and its children have the changes already.
+			if (target_child_view == this->merged_view) {
+				continue;
+			}
+
 			recurse(target_child_view);
 
-			create_state_mod(std::move(target_child_view));
+			// views without records of their own read the data
+			// from their parent, so they see the transaction there.
+			if (target_child_view->read_state_history().empty()) {
+				continue;
+			}
+
+			views.push_back(std::move(target_child_view));
 		}
 
 		if (view_has_stale_children) {
@@ -74,7 +115,58 @@ Transaction::Transaction(order_t at, std::shared_ptr<View> &&origin)
 		}
 	};
 
-	recurse(main_view);
+	recurse(views.at(0));
+
+	return views;
+}
+
+
+bool Transaction::has_conflicts() const {
+	// a child view may have got records of its own meanwhile,
+	// then the transaction has to be applied there as well.
+	std::vector<std::shared_ptr<View>> views = this->find_views(
+		std::shared_ptr<View>{this->states.at(0).view}
+	);
+
+	if (views.size() != this->states.size()) {
+		return true;
+	}
+
+	for (size_t i = 0; i < views.size(); i++) {
+		if (views[i] != this->states[i].view) {
+			return true;
+		}
+
+		// the object states this transaction was built from
+		// were changed by a transaction committed since.
+		for (auto &obj : this->states[i].reads) {
+			if (views[i]->get_last_write(obj) >= this->begin) {
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+
+void Transaction::rebuild() {
+	std::shared_ptr<View> origin = this->states.at(0).view;
+	std::vector<obj_id_t> patches = std::move(this->patches);
+
+	this->states.clear();
+	this->patches.clear();
+
+	this->create_states(std::move(origin));
+
+	if (this->merged_view) {
+		this->merge_view(std::shared_ptr<View>{this->merged_view});
+	}
+	else {
+		for (auto &patch : patches) {
+			this->add_patch(patch);
+		}
+	}
 }
 
 
@@ -88,47 +180,196 @@ bool Transaction::add(const Object &patch) {
 		return false;
 	}
 
-	const auto target_ptr = patch.get_target();
-	// TODO: recheck if target exists?
-	if (target_ptr == nullptr) {
-		throw InternalError{"patch somehow has no target"};
-	}
-	const auto &target = *target_ptr;
+	this->add_patch(patch.get_id());
+	return true;
+}
+
+
+void Transaction::add_patch(obj_id_t patch) {
+	const obj_id_t target = this->get_patch_target(patch);
 
 	// apply the patch in each view's state
 	for (auto &view_state : this->states) {
+		this->apply_patch(view_state, patch, target);
+	}
+
+	this->patches.push_back(patch);
+}
+
+
+bool Transaction::add_all(const std::vector<Object> &patches) {
+	if (unlikely(not this->valid)) {
+		return false;
+	}
+
+	// check all of them first, so none is added if one fails.
+	for (auto &patch : patches) {
+		if (unlikely(not patch.is_patch())) {
+			return false;
+		}
+	}
+
+	// patches of each target, in the order they were added.
+	std::vector<std::pair<obj_id_t, std::vector<obj_id_t>>> target_patches;
+	std::unordered_map<obj_id_t, size_t> target_idx;
+
+	for (auto &patch : patches) {
+		const obj_id_t target = this->get_patch_target(patch.get_id());
+
+		auto ins = target_idx.emplace(target, target_patches.size());
+		if (ins.second) {
+			target_patches.emplace_back(target, std::vector<obj_id_t>{});
+		}
+		target_patches[ins.first->second].second.push_back(patch.get_id());
+	}
 
+	for (auto &view_state : this->states) {
 		auto &view = view_state.view;
 		auto &new_state = view_state.state;
-		auto &tracker = view_state.changes;
 
-		// TODO: speed up the state backtracking for finding the object
+		// other threads may commit meanwhile.
+		View::ReadGuard guard{*view};
 
-		// This does not copy the object if the new state already has it.
-		auto &target_obj = new_state->copy_object(target, this->at, view);
+		// the patches usually share most of their parents,
+		// so each component is only looked up once.
+		std::unordered_map<obj_id_t, std::pair<const std::shared_ptr<ObjectState> *,
+		                                        const ObjectInfo *>> components;
 
-		// apply each patch component (i.e. all the parents of the patch)
-		for (auto &patch_name : patch.get_linearized(this->at)) {
+		for (auto &it : target_patches) {
+			const obj_id_t target = it.first;
 
-			auto &patch_tracker = tracker.track_patch(target);
+			auto &target_obj = new_state->copy_object(target, this->at, view);
+			auto &patch_tracker = view_state.changes.track_patch(target);
+			view_state.reads.insert(target);
 
-			// apply all patch parents in order (last the patch itself)
-			target_obj->apply(
-				// TODO: use the same mechanism as above to get only parent
-				//       obj states of base_state
-				view->get_raw(patch_name, this->at),
-				view->get_info(patch_name),
-				patch_tracker
-			);
+			for (auto &patch : it.second) {
+				const PatchPlan *plan = view->get_info(patch).get_patch_plan();
+				if (plan != nullptr) {
+					target_obj->apply(*plan, patch_tracker);
+					continue;
+				}
+
+				for (auto &patch_id : view->get_linearization(patch, this->at)) {
+					auto component = components.find(patch_id);
+					if (component == std::end(components)) {
+						view_state.reads.insert(patch_id);
+						component = components.emplace(
+							patch_id,
+							std::make_pair(&view->get_raw(patch_id, this->at),
+							               &view->get_info(patch_id))
+						).first;
+					}
+
+					target_obj->apply(
+						*component->second.first,
+						*component->second.second,
+						patch_tracker
+					);
+				}
+			}
 		}
+	}
 
-		// TODO: linearize here so other patches can depend on that?
+	for (auto &patch : patches) {
+		this->patches.push_back(patch.get_id());
 	}
 
 	return true;
 }
 
 
+obj_id_t Transaction::get_patch_target(obj_id_t patch) const {
+	const PatchInfo *patch_info = this->states.at(0).view->get_info(patch).get_patch().get();
+	// TODO: recheck if target exists?
+	if (patch_info == nullptr) {
+		throw InternalError{"patch somehow has no target"};
+	}
+	return patch_info->get_target();
+}
+
+
+void Transaction::apply_patch(view_state &view_state, obj_id_t patch, obj_id_t target) {
+	auto &view = view_state.view;
+	auto &new_state = view_state.state;
+	auto &tracker = view_state.changes;
+
+	// other threads may commit meanwhile.
+	View::ReadGuard guard{*view};
+
+	// TODO: speed up the state backtracking for finding the object
+	view_state.reads.insert(target);
+
+	// This does not copy the object if the new state already has it.
+	auto &target_obj = new_state->copy_object(target, this->at, view);
+
+	// the patch was compiled, so nothing has to be looked up.
+	const PatchPlan *plan = view->get_info(patch).get_patch_plan();
+	if (plan != nullptr) {
+		target_obj->apply(*plan, tracker.track_patch(target));
+		return;
+	}
+
+	// apply each patch component (i.e. all the parents of the patch)
+	for (auto &patch_id : view->get_linearization(patch, this->at)) {
+
+		auto &patch_tracker = tracker.track_patch(target);
+		view_state.reads.insert(patch_id);
+
+		// apply all patch parents in order (last the patch itself)
+		target_obj->apply(
+			// TODO: use the same mechanism as above to get only parent
+			//       obj states of base_state
+			view->get_raw(patch_id, this->at),
+			view->get_info(patch_id),
+			patch_tracker
+		);
+	}
+
+	// TODO: linearize here so other patches can depend on that?
+}
+
+
+void Transaction::merge_view(const std::shared_ptr<View> &child) {
+	// the child and its children have the changes already.
+	this->merged_view = child;
+	this->states.erase(
+		std::remove_if(
+			std::begin(this->states) + 1, std::end(this->states),
+			[&child] (const view_state &view_state) {
+				for (const View *view = view_state.view.get();
+				     view != nullptr;
+				     view = view->parent_view.get()) {
+					if (view == child.get()) {
+						return true;
+					}
+				}
+				return false;
+			}
+		),
+		std::end(this->states)
+	);
+
+	View::ReadGuard guard{*child};
+
+	// the patches of the transactions committed on the child.
+	// those it got from its parents are in this view already.
+	std::vector<obj_id_t> child_patches;
+	for (auto &it : child->read_state_history().get_transactions()) {
+		if (not it.second.inherited) {
+			child_patches.insert(std::end(child_patches),
+			                     std::begin(it.second.patches),
+			                     std::end(it.second.patches));
+		}
+	}
+
+	// the patches are applied on the current state of this view,
+	// so changes committed here since the child was created are kept.
+	for (auto &patch : child_patches) {
+		this->add_patch(patch);
+	}
+}
+
+
 bool Transaction::add(const Object &/*patch*/, const Object &/*target*/) {
 	// TODO check if the target is a child of the original target
 	throw InternalError{"TODO custom patch target"};
@@ -141,9 +382,64 @@ bool Transaction::commit() {
 		return false;
 	}
 
-	// TODO check if no other transaction was before this one.
+	// commits are done one at a time.
+	View::WriteGuard lock{*this->states.at(0).view};
+
+	// if transactions were committed since this one was started
+	// and changed what it was built from, it's built again on top of them.
+	if (this->has_conflicts()) {
+		this->rebuild();
+	}
+
+	// storing the new states drops all later states,
+	// so the later transactions have to be applied again.
+	std::vector<transaction_record> later_transactions = this->get_later_transactions();
+
+	std::vector<changed_objects_t> updated_objects = this->apply();
+
+	bool ret = this->valid;
+	this->valid = false;
+
+	if (ret) {
+		this->id = next_transaction_id++;
+		this->record();
+	}
+
+	// a failed transaction didn't drop the later ones.
+	replayed_changes_t replayed_changes;
+	if (ret and not later_transactions.empty()) {
+		replayed_changes = Transaction::replay(std::move(later_transactions));
+	}
+
+	// transactions built meanwhile from the changed objects conflict.
+	if (ret) {
+		size_t idx = 0;
+		for (auto &view_state : this->states) {
+			view_state.view->record_writes(updated_objects[idx], this->id);
+			idx += 1;
+		}
+
+		for (auto &it : replayed_changes) {
+			for (auto &change : it.second) {
+				it.first->record_write(change.first, this->id);
+			}
+		}
+	}
+
+	// readers see the transaction and the replayed ones at once.
+	for (auto &view_state : this->states) {
+		view_state.view->publish_state_history();
+	}
+
+	// now that the views were updated, we can fire the event notifications.
+	this->fire_notifications(updated_objects);
+	Transaction::fire_notifications(replayed_changes);
+
+	return ret;
+}
 
 
+std::vector<changed_objects_t> Transaction::apply() {
 	// merge a new state with an already existing base state
 	// this must be done for a transaction at a time
 	// where data is already stored.
@@ -152,14 +448,14 @@ bool Transaction::commit() {
 	// for each view: those updates have to be performed
 	std::vector<view_update> updates = this->generate_updates();
 
-	// now, all sanity checks are done and we can update the view!
-	this->update_views(std::move(updates));
-
-	// TODO mark value caches dirty
+	if (not this->valid) {
+		return std::vector<changed_objects_t>(this->states.size());
+	}
 
-	bool ret = this->valid;
-	this->valid = false;
-	return ret;
+	// now, all sanity checks are done and we can update the view!
+	this->store_states();
+	this->update_indexes(std::move(updates));
+	return this->invalidate_values();
 }
 
 
@@ -167,7 +463,7 @@ void Transaction::merge_changed_states() {
 	for (auto &view_state : this->states) {
 		auto &view = view_state.view;
 
-		StateHistory &view_history = view->get_state_history();
+		const StateHistory &view_history = view->read_state_history();
 
 		// new_state contains all modified objects for this view.
 		// base_state probably unused
@@ -213,7 +509,7 @@ std::vector<view_update> Transaction::generate_updates() {
 		// affected are: children of those objects which the child cache knows.
 
 		// contains all objects whose parents changed.
-		std::unordered_set<fqon_t> objs_to_linearize;
+		std::unordered_set<obj_id_t> objs_to_linearize;
 
 		// take a look at all the needed inheritance updates
 		// and generate the child tracking update from it.
@@ -246,9 +542,9 @@ std::vector<view_update> Transaction::generate_updates() {
 view_update::child_map_t
 Transaction::inheritance_updates(const ChangeTracker &tracker,
                                  const std::shared_ptr<View> &view,
-                                 std::unordered_set<fqon_t> &objs_to_linearize) const {
+                                 std::unordered_set<obj_id_t> &objs_to_linearize) const {
 
-	// maps fqon => set of children fqons
+	// maps object => set of children objects
 	view_update::child_map_t children;
 
 	// those objects were changed and require handling.
@@ -264,7 +560,7 @@ Transaction::inheritance_updates(const ChangeTracker &tracker,
 			for (auto &parent : obj_changes.get_new_parents()) {
 				auto ins = children.emplace(
 					parent,
-					std::unordered_set<fqon_t>{}
+					std::unordered_set<obj_id_t>{}
 				);
 				ins.first->second.insert(obj);
 			}
@@ -286,57 +582,135 @@ Transaction::inheritance_updates(const ChangeTracker &tracker,
 
 
 view_update::linearizations_t
-Transaction::relinearize_objects(const std::unordered_set<fqon_t> &objs_to_linearize,
+Transaction::relinearize_objects(const std::unordered_set<obj_id_t> &objs_to_linearize,
                                  const std::shared_ptr<View> &view,
                                  const std::shared_ptr<State> &new_state) {
 
-	view_update::linearizations_t linearizations;
+	// new linearizations of the objects in objs_to_linearize.
+	// map nodes are stable, so references to them stay valid.
+	std::unordered_map<obj_id_t, std::vector<obj_id_t>> new_linearizations;
 
 	for (auto &obj : objs_to_linearize) {
-		auto lin = linearize(
+		linearize_cached(
 			obj,
 			[this, &view, &new_state]
-			(const fqon_t &name) -> const ObjectState & {
+			(obj_id_t parent) -> const ObjectState & {
 
 				// try to use the object in the new state if it's in there
-				const auto &new_obj_state = new_state->get(name);
+				const auto &new_obj_state = new_state->get(parent);
 				if (new_obj_state != nullptr) {
 					return *new_obj_state->get();
 				}
 
 				// else, get it from the already existing view.
-				const ObjectState *view_obj_state = view->get_raw(name, this->at).get();
+				const ObjectState *view_obj_state = view->get_raw(parent, this->at).get();
 				if (unlikely(view_obj_state == nullptr)) {
 					throw InternalError{"could not find parent object"};
 				}
 				return *view_obj_state;
-			}
+			},
+			[this, &view, &objs_to_linearize, &new_linearizations]
+			(obj_id_t parent) -> const std::vector<obj_id_t> * {
+
+				auto it = new_linearizations.find(parent);
+				if (it != std::end(new_linearizations)) {
+					return &it->second;
+				}
+
+				// the linearization needs an update.
+				if (objs_to_linearize.find(parent) != std::end(objs_to_linearize)) {
+					return nullptr;
+				}
+
+				// no ancestor of the parent has changed,
+				// so the current linearization is still valid.
+				return &view->get_linearization(parent, this->at);
+			},
+			[&new_linearizations]
+			(obj_id_t parent, std::vector<obj_id_t> &&lin) -> const std::vector<obj_id_t> & {
+				return new_linearizations.emplace(parent, std::move(lin)).first->second;
+			},
+			view->get_symbols()
 		);
+	}
+
+	view_update::linearizations_t linearizations;
+	linearizations.reserve(new_linearizations.size());
 
-		linearizations.push_back(std::move(lin));
+	for (auto &it : new_linearizations) {
+		linearizations.push_back(std::move(it.second));
 	}
 
 	return linearizations;
 }
 
 
-void Transaction::update_views(std::vector<view_update> &&updates) {
+void Transaction::store_states() {
+	for (auto &view_state : this->states) {
+		// insert the new state and drop later ones.
+		view_state.view->get_state_history().insert(
+			std::move(view_state.state),
+			this->at
+		);
+	}
+}
+
+
+void Transaction::update_indexes(std::vector<view_update> &&updates) {
 	size_t idx = 0;
 	for (auto &view_state : this->states) {
 		auto &view = view_state.view;
-		auto &new_state = view_state.state;
 
-		// record the state updates in each view's history
+		// record the index updates in each view's history
 		StateHistory &view_history = view->get_state_history();
 
-		// insert the new state and drop later ones.
-		view_history.insert(std::move(new_state), this->at);
+		// objects whose ancestors or inherited members changed.
+		std::unordered_set<obj_id_t> new_ancestries;
 
 		// insert all newly calculated linearizations.
 		for (auto &lin : updates[idx].linearizations) {
+			new_ancestries.insert(lin.at(0));
 			view_history.insert_linearization(std::move(lin), this->at);
 		}
 
+		// the new children and their descendants are descendants of the
+		// new parents and of all their ancestors from now on.
+		// the other descendant lists are unchanged.
+		std::unordered_map<obj_id_t, std::vector<obj_id_t>> new_descendants;
+		for (auto &it : updates[idx].children) {
+			std::vector<obj_id_t> added;
+			for (auto &child : it.second) {
+				const auto &child_descendants = view->get_obj_children_all(child, this->at);
+				added.push_back(child);
+				added.insert(std::end(added),
+				             std::begin(child_descendants),
+				             std::end(child_descendants));
+			}
+
+			for (auto &ancestor : view->get_linearization(it.first, this->at)) {
+				auto &descendants = new_descendants[ancestor];
+				descendants.insert(std::end(descendants),
+				                   std::begin(added),
+				                   std::end(added));
+			}
+		}
+
+		for (auto &it : new_descendants) {
+			auto &obj = it.first;
+			auto &descendants = it.second;
+
+			const auto &previous_descendants = view->get_obj_children_all(obj, this->at);
+			descendants.insert(std::end(descendants),
+			                   std::begin(previous_descendants),
+			                   std::end(previous_descendants));
+
+			std::sort(std::begin(descendants), std::end(descendants));
+			descendants.erase(std::unique(std::begin(descendants), std::end(descendants)),
+			                  std::end(descendants));
+
+			view_history.insert_descendants(obj, std::move(descendants), this->at);
+		}
+
 		// inheritance updates can generate new children for existing objects
 		for (auto &it : updates[idx].children) {
 			auto &obj = it.first;
@@ -350,31 +724,312 @@ void Transaction::update_views(std::vector<view_update> &&updates) {
 			view_history.insert_children(obj, std::move(new_children), this->at);
 		}
 
+		// a patch may add a member the object didn't have,
+		// then its children have it as well.
+		for (auto &it : view_state.changes.get_object_changes()) {
+			const Ancestry &ancestry = view->get_ancestry(it.first, this->at);
+			for (auto &member : it.second.get_changed_members()) {
+				if (not ancestry.has(member)) {
+					const auto &children = view->get_obj_children_all(it.first, this->at);
+					new_ancestries.insert(it.first);
+					new_ancestries.insert(std::begin(children), std::end(children));
+					break;
+				}
+			}
+		}
+
+		for (auto &obj : new_ancestries) {
+			const auto &linearization = view->get_linearization(obj, this->at);
+
+			Ancestry ancestry{linearization};
+			for (auto &parent : linearization) {
+				ancestry.add_members(*view->get_raw(parent, this->at));
+			}
+
+			view_history.insert_ancestry(obj, std::move(ancestry), this->at);
+		}
+
 		idx += 1;
 	}
+}
+
+
+std::vector<changed_objects_t> Transaction::invalidate_values() {
+	// objects affected by the transaction, for each view.
+	std::vector<changed_objects_t> view_updated_objects;
+	view_updated_objects.reserve(this->states.size());
 
-	// now that the views were updated, we can fire the event notifications.
 	for (auto &view_state : this->states) {
 		auto &view = view_state.view;
 		auto &tracker = view_state.changes;
 
-		std::unordered_set<fqon_t> updated_objects = tracker.get_changed_objects();
-		std::unordered_set<fqon_t> affected_children;
-		// all children of the patched objects are also affected.
-		for (auto &obj : updated_objects) {
-			std::unordered_set<fqon_t> children = view->get_obj_children_all(obj, this->at);
-			affected_children.merge(children);
+		changed_objects_t updated_objects = tracker.get_changed_objects();
+		changed_objects_t affected_children;
+		// all children of the patched objects are also affected,
+		// they may inherit the changed members.
+		for (auto &it : updated_objects) {
+			for (auto &child : view->get_obj_children_all(it.first, this->at)) {
+				affected_children[child].merge(it.second);
+			}
 		}
 
-		updated_objects.merge(affected_children);
+		for (auto &it : affected_children) {
+			updated_objects[it.first].merge(it.second);
+		}
 
-		// TODO: if we don't want to fire for every object, but only
-		//       for those with some members changed, we have to
-		//       extend the ChangeTracker and track individual member updates
-		//       (maybe only if the object is of interest).
-		//       then we pass only the relevant objects here.
-		view->fire_notifications(updated_objects, this->at);
+		// the member values of all those objects may have changed.
+		StateHistory &view_history = view->get_state_history();
+		for (auto &it : updated_objects) {
+			view_history.invalidate_values(it.first, this->at);
+		}
+
+		view_updated_objects.push_back(std::move(updated_objects));
+	}
+
+	return view_updated_objects;
+}
+
+
+void Transaction::fire_notifications(const std::vector<changed_objects_t> &updated_objects) const {
+	size_t idx = 0;
+	for (auto &view_state : this->states) {
+		view_state.view->fire_notifications(updated_objects[idx], this->at);
+		idx += 1;
+	}
+}
+
+
+void Transaction::record() const {
+	bool origin = true;
+	for (auto &view_state : this->states) {
+		view_state.view->get_state_history().record_transaction(
+			{this->id, origin ? this->inherited : true, this->patches},
+			this->at
+		);
+		origin = false;
+	}
+}
+
+
+std::vector<transaction_record> Transaction::get_later_transactions() const {
+	std::vector<transaction_record> ret;
+
+	bool origin = true;
+	for (auto &view_state : this->states) {
+		auto &view = view_state.view;
+
+		for (auto &it : view->read_state_history().get_transactions_after(this->at)) {
+			// transactions from parent views are replayed
+			// from the topmost view, which propagates them down.
+			if (origin or not it.second.inherited) {
+				ret.push_back({it.first, view, std::move(it.second)});
+			}
+		}
+		origin = false;
 	}
+
+	// the origin view gets records now, so it has to apply
+	// the parent transactions it only saw through its parents.
+	Transaction::get_parent_transactions(this->states.at(0).view, this->at, ret);
+
+	return ret;
+}
+
+
+void Transaction::get_parent_transactions(const std::shared_ptr<View> &view,
+                                          order_t t,
+                                          std::vector<transaction_record> &records) {
+	std::unordered_set<transaction_id_t> known;
+	for (auto &record : records) {
+		if (record.view == view) {
+			known.insert(record.transaction.id);
+		}
+	}
+
+	// a view only sees the parent transactions until its fork time.
+	order_t until = view->fork_time;
+	for (View *parent = view->parent_view.get();
+	     parent != nullptr and t < until;
+	     until = std::min(until, parent->fork_time), parent = parent->parent_view.get()) {
+
+		for (auto &it : parent->read_state_history().get_transactions_after(t)) {
+			if (it.first > until) {
+				break;
+			}
+
+			if (known.insert(it.second.id).second) {
+				it.second.inherited = true;
+				records.push_back({it.first, view, std::move(it.second)});
+			}
+		}
+	}
+
+	// transactions at the same time are applied in commit order.
+	std::sort(
+		std::begin(records), std::end(records),
+		[] (const transaction_record &a, const transaction_record &b) {
+			return std::tie(a.at, a.transaction.id) < std::tie(b.at, b.transaction.id);
+		}
+	);
+}
+
+
+Transaction::replayed_changes_t
+Transaction::replay(std::vector<transaction_record> &&transactions) {
+	replayed_changes_t changes;
+
+	// transactions whose states are stored, but not their index updates.
+	replay_batch_t batch;
+
+	for (auto &record : transactions) {
+		Transaction tx{record.at, std::shared_ptr<View>{record.view}};
+		tx.id = record.transaction.id;
+		tx.inherited = record.transaction.inherited;
+
+		for (auto &patch : record.transaction.patches) {
+			tx.add_patch(patch);
+		}
+
+		tx.merge_changed_states();
+		std::vector<view_update> updates = tx.generate_updates();
+
+		// the transaction can't be applied on the new states anymore.
+		if (not tx.valid) {
+			continue;
+		}
+
+		// the following transactions are built from the new inheritance,
+		// so it is updated right away.
+		bool inheritance_changed = false;
+		for (auto &update : updates) {
+			if (not update.linearizations.empty() or not update.children.empty()) {
+				inheritance_changed = true;
+			}
+		}
+
+		if (inheritance_changed) {
+			Transaction::update_replayed(batch, changes);
+		}
+
+		// the following transactions need the state to build on.
+		tx.store_states();
+		tx.record();
+		tx.valid = false;
+
+		batch.emplace_back(std::move(tx), std::move(updates));
+
+		if (inheritance_changed) {
+			Transaction::update_replayed(batch, changes);
+		}
+	}
+
+	Transaction::update_replayed(batch, changes);
+
+	return changes;
+}
+
+
+void Transaction::update_replayed(replay_batch_t &batch, replayed_changes_t &changes) {
+	using change_times_t = std::unordered_map<obj_id_t, std::vector<order_t>>;
+
+	// times each patched object was changed at, in order, for each view.
+	std::vector<std::pair<std::shared_ptr<View>, change_times_t>> view_change_times;
+
+	for (auto &it : batch) {
+		Transaction &tx = it.first;
+		tx.update_indexes(std::move(it.second));
+
+		for (auto &view_state : tx.states) {
+			change_times_t *change_times = nullptr;
+			for (auto &view_times : view_change_times) {
+				if (view_times.first == view_state.view) {
+					change_times = &view_times.second;
+					break;
+				}
+			}
+			if (change_times == nullptr) {
+				change_times = &view_change_times.emplace_back(view_state.view, change_times_t{}).second;
+			}
+
+			for (auto &obj : view_state.changes.get_changed_objects()) {
+				auto &times = (*change_times)[obj.first];
+				if (times.empty() or times.back() != tx.at) {
+					times.push_back(tx.at);
+				}
+			}
+		}
+	}
+
+	batch.clear();
+
+	for (auto &it : view_change_times) {
+		auto &view = it.first;
+		auto &change_times = it.second;
+
+		// the descendants are the same at all times of the batch,
+		// so they are looked up once for each patched object.
+		change_times_t affected_children;
+		for (auto &obj : change_times) {
+			for (auto &child : view->get_obj_children_all(obj.first, obj.second.back())) {
+				auto &times = affected_children[child];
+				times.insert(std::end(times), std::begin(obj.second), std::end(obj.second));
+			}
+		}
+
+		for (auto &child : affected_children) {
+			auto &times = change_times[child.first];
+			times.insert(std::end(times), std::begin(child.second), std::end(child.second));
+		}
+
+		std::unordered_map<obj_id_t, order_t> *last_change = nullptr;
+		for (auto &view_changes : changes) {
+			if (view_changes.first == view) {
+				last_change = &view_changes.second;
+				break;
+			}
+		}
+		if (last_change == nullptr) {
+			last_change = &changes.emplace_back(view, std::unordered_map<obj_id_t, order_t>{}).second;
+		}
+
+		// the member values may have changed at each of the times.
+		StateHistory &view_history = view->get_state_history();
+		for (auto &obj : change_times) {
+			auto &times = obj.second;
+			std::sort(std::begin(times), std::end(times));
+			times.erase(std::unique(std::begin(times), std::end(times)),
+			            std::end(times));
+
+			for (auto &t : times) {
+				view_history.invalidate_values(obj.first, t);
+			}
+
+			(*last_change)[obj.first] = times.back();
+		}
+	}
+}
+
+
+void Transaction::fire_notifications(const replayed_changes_t &changes) {
+	for (auto &it : changes) {
+		auto &view = it.first;
+
+		// the members changed by the replays are not tracked,
+		// all of them may have changed.
+		std::map<order_t, changed_objects_t> objs_by_time;
+		for (auto &change : it.second) {
+			objs_by_time[change.second][change.first].all = true;
+		}
+
+		for (auto &objs : objs_by_time) {
+			view->fire_notifications(objs.second, objs.first);
+		}
+	}
+}
+
+
+transaction_id_t Transaction::get_next_id() {
+	return next_transaction_id;
 }
 
 
@@ -11,6 +11,7 @@
 
 #include "config.h"
 #include "change_tracker.h"
+#include "state_history.h"
 
 
 namespace nyan {
@@ -25,9 +26,9 @@ class View;
  */
 struct view_update {
 
-	using linearizations_t = std::vector<std::vector<fqon_t>>;
+	using linearizations_t = std::vector<std::vector<obj_id_t>>;
 
-	using child_map_t = std::unordered_map<fqon_t, std::unordered_set<fqon_t>>;
+	using child_map_t = std::unordered_map<obj_id_t, std::unordered_set<obj_id_t>>;
 
 	/**
 	 * All linearizations to update because of the patches.
@@ -50,6 +51,22 @@ struct view_state {
 	std::shared_ptr<View> view;
 	std::shared_ptr<State> state;
 	ChangeTracker changes;
+
+	/**
+	 * Objects whose states were read to build the new state.
+	 */
+	std::unordered_set<obj_id_t> reads;
+};
+
+
+/**
+ * Patches of a committed transaction,
+ * used to apply the transaction again.
+ */
+struct transaction_record {
+	order_t at;
+	std::shared_ptr<View> view;
+	applied_transaction transaction;
 };
 
 
@@ -57,6 +74,7 @@ struct view_state {
  * Patch transaction
  */
 class Transaction {
+	friend class View;
 public:
 
 	Transaction(order_t at, std::shared_ptr<View> &&origin);
@@ -74,8 +92,26 @@ public:
 	 */
 	bool add(const Object &obj, const Object &target);
 
+	/**
+	 * Add many patches to the transaction at once.
+	 * The patches are grouped by their target, each target is
+	 * copied once and gets its patches applied in order.
+	 * The patch components are looked up once for all patches.
+	 * Returns false and adds none of them if one isn't a patch.
+	 */
+	bool add_all(const std::vector<Object> &patches);
+
 	/**
 	 * Returns true if the transaction was successful.
+	 *
+	 * If the transaction is earlier than later transactions
+	 * committed on the view or its children, those later transactions
+	 * are dropped and then applied again on top of this one.
+	 *
+	 * Transactions can be built on multiple threads at once if the
+	 * views have concurrent reads enabled, the commits are done one
+	 * at a time. If a transaction committed meanwhile changed an object
+	 * this one read, the patches are applied again on top of it.
 	 */
 	bool commit();
 
@@ -85,6 +121,59 @@ public:
 	const std::exception_ptr &get_exception() const;
 
 protected:
+	/**
+	 * Create the new states of the views the transaction is applied in.
+	 */
+	void create_states(std::shared_ptr<View> &&origin);
+
+	/**
+	 * Return the origin view and the views below it
+	 * that the transaction has to be applied in.
+	 */
+	std::vector<std::shared_ptr<View>> find_views(std::shared_ptr<View> &&origin) const;
+
+	/**
+	 * Check if the transaction has to be built again,
+	 * because another one committed since changed what it read.
+	 */
+	bool has_conflicts() const;
+
+	/**
+	 * Create the new states again and apply the patches on them.
+	 */
+	void rebuild();
+
+	/**
+	 * Apply a patch in each view's state.
+	 */
+	void add_patch(obj_id_t patch);
+
+	/**
+	 * Return the object a patch is applied to.
+	 */
+	obj_id_t get_patch_target(obj_id_t patch) const;
+
+	/**
+	 * Apply a patch to its target in the new state of a view.
+	 */
+	void apply_patch(view_state &view_state, obj_id_t patch, obj_id_t target);
+
+	/**
+	 * Add the changes of the transactions committed on a child view
+	 * of the origin view. Their patches are applied again
+	 * in all views except the child and its children,
+	 * which are not changed.
+	 */
+	void merge_view(const std::shared_ptr<View> &child);
+
+	/**
+	 * Calculate all updates and store the new states in the views.
+	 * If the updates can't be calculated, the views are not changed.
+	 * Returns the objects affected by the transaction and their
+	 * changed members, for each view.
+	 */
+	std::vector<changed_objects_t> apply();
+
 	/**
 	 * Merge the new states with an existing one from the view.
 	 */
@@ -106,22 +195,110 @@ protected:
 	view_update::child_map_t
 	inheritance_updates(const ChangeTracker &tracker,
 	                    const std::shared_ptr<View> &view,
-	                    std::unordered_set<fqon_t> &objs_to_linearize) const;
+	                    std::unordered_set<obj_id_t> &objs_to_linearize) const;
 
 	/**
 	 * Generate new linearizations for objects that changed.
 	 */
 	view_update::linearizations_t
-	relinearize_objects(const std::unordered_set<fqon_t> &objs_to_linearize,
+	relinearize_objects(const std::unordered_set<obj_id_t> &objs_to_linearize,
 	                    const std::shared_ptr<View> &view,
 	                    const std::shared_ptr<State> &new_state);
 
 
 	/**
-	 * Apply the gathered state updates in all views.
+	 * Store the new states in the history of each view.
+	 * Later states are dropped.
+	 */
+	void store_states();
+
+	/**
+	 * Apply the gathered linearization, child, descendant
+	 * and ancestry updates in all views.
 	 * The update list is destroyed.
 	 */
-	void update_views(std::vector<view_update> &&updates);
+	void update_indexes(std::vector<view_update> &&updates);
+
+	/**
+	 * Invalidate the cached values of the patched objects
+	 * and their descendants in all views.
+	 * Returns those objects and their changed members, for each view.
+	 */
+	std::vector<changed_objects_t> invalidate_values();
+
+	/**
+	 * Fire the change notifications in each view.
+	 */
+	void fire_notifications(const std::vector<changed_objects_t> &updated_objects) const;
+
+	/**
+	 * Record the transaction in the history of each view.
+	 */
+	void record() const;
+
+	/**
+	 * Return the transactions later than this one that were
+	 * applied in the views this transaction is applied in,
+	 * or in the parents of the origin view.
+	 * Each is returned once, for the topmost of those views
+	 * it has to be applied in. They are ordered by time.
+	 */
+	std::vector<transaction_record> get_later_transactions() const;
+
+	/**
+	 * Add the transactions later than t of the parents of the view
+	 * that are not recorded for the view in the given records yet.
+	 * Transactions after the fork time of the view are not added.
+	 * Those were committed while the view had no records of its own,
+	 * so it only saw them through its parents.
+	 * The records are ordered by time afterwards.
+	 */
+	static void get_parent_transactions(const std::shared_ptr<View> &view,
+	                                    order_t t,
+	                                    std::vector<transaction_record> &records);
+
+	/**
+	 * Objects changed by replayed transactions for each view,
+	 * with the time of their last change.
+	 */
+	using replayed_changes_t = std::vector<std::pair<std::shared_ptr<View>,
+	                                                 std::unordered_map<obj_id_t, order_t>>>;
+
+	/**
+	 * Replayed transactions whose states are stored,
+	 * with the index updates still to be done.
+	 */
+	using replay_batch_t = std::vector<std::pair<Transaction, std::vector<view_update>>>;
+
+	/**
+	 * Apply the given transactions again, in order.
+	 * The states are stored one by one, the indexes are updated
+	 * and the values invalidated once for a batch of transactions.
+	 * A batch ends at each transaction that changes the inheritance.
+	 * Returns the changed objects, so the notifications can be
+	 * fired once for all of them.
+	 */
+	static replayed_changes_t replay(std::vector<transaction_record> &&transactions);
+
+	/**
+	 * Update the indexes for the batch of replayed transactions
+	 * and invalidate the values of the objects they affect.
+	 * Only a batch of one transaction may change the inheritance.
+	 * The batch is cleared and the changed objects are added
+	 * to the changes.
+	 */
+	static void update_replayed(replay_batch_t &batch, replayed_changes_t &changes);
+
+	/**
+	 * Fire the notifications for replayed transactions:
+	 * each changed object is notified at the time of its last change.
+	 */
+	static void fire_notifications(const replayed_changes_t &changes);
+
+	/**
+	 * Return the id the next committed transaction gets.
+	 */
+	static transaction_id_t get_next_id();
 
 	/**
 	 * A non-fatal exception occured, so let the transaction fail.
@@ -147,6 +324,34 @@ protected:
 	 * The views where the transaction will be applied in.
 	 */
 	std::vector<view_state> states;
+
+	/**
+	 * Patches added to this transaction, in order.
+	 */
+	std::vector<obj_id_t> patches;
+
+	/**
+	 * Commit order of the transaction, assigned when it's committed.
+	 * Replayed transactions keep their id.
+	 */
+	transaction_id_t id = 0;
+
+	/**
+	 * Id of the next committed transaction when this one was started.
+	 * Transactions with this or a later id were committed meanwhile.
+	 */
+	transaction_id_t begin = 0;
+
+	/**
+	 * Child view whose changes this transaction merges, if any.
+	 */
+	std::shared_ptr<View> merged_view;
+
+	/**
+	 * True if the transaction was committed on a parent
+	 * of the origin view and is replayed in the origin view.
+	 */
+	bool inherited = false;
 };
 
 } // namespace nyan
@@ -103,6 +103,15 @@ Type::Type(const IDToken &token,
 }
 
 
+Type::Type(const BasicType &basic_type,
+           std::shared_ptr<Type> &&element_type,
+           const fqon_t &target)
+	:
+	basic_type{basic_type},
+	element_type{std::move(element_type)},
+	target{target} {}
+
+
 bool Type::is_fundamental() const {
 	return this->basic_type.is_fundamental();
 }
@@ -29,6 +29,7 @@ class Token;
  * Type handling for nyan values.
  */
 class Type {
+	friend class Snapshot;
 public:
 
 	/**
@@ -52,6 +53,15 @@ public:
 	     const Namespace &ns,
 	     const MetaInfo &type_info);
 
+protected:
+	/**
+	 * Construct a type from its stored components.
+	 * Used when restoring a database snapshot.
+	 */
+	Type(const BasicType &basic_type,
+	     std::shared_ptr<Type> &&element_type,
+	     const fqon_t &target);
+
 public:
 
 	virtual ~Type() = default;
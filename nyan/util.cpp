@@ -77,7 +77,7 @@ namespace nyan::util {
 
 
 std::string read_file(const std::string &filename, bool binary) {
-	std::ifstream::openmode mode = std::ifstream::in | std::ifstream::ate;
+	std::ifstream::openmode mode = std::ifstream::in;
 	if (binary) {
 		mode |= std::ifstream::binary;
 	}
@@ -85,15 +85,13 @@ std::string read_file(const std::string &filename, bool binary) {
 	std::ifstream input{filename, mode};
 
 	if (input) {
-		std::string ret;
-
-		// we're at the file end already because of ifstream::ate
-		ret.resize(input.tellg());
-		input.seekg(0, std::ios::beg);
-		input.read(&ret[0], ret.size());
+		// read until the end instead of seeking there,
+		// pipes and files like those in /proc have no known size.
+		std::ostringstream ret;
+		ret << input.rdbuf();
 		input.close();
 
-		return ret;
+		return ret.str();
 	}
 	else {
 		std::ostringstream builder;
@@ -44,9 +44,8 @@ Boolean::Boolean(const IDToken &token) {
 
 
 ValueHolder Boolean::copy() const {
-	return ValueHolder{
-		std::make_shared<Boolean>(dynamic_cast<const Boolean &>(*this))
-	};
+	// stored inline in the holder.
+	return ValueHolder{*this};
 }
 
 
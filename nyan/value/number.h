@@ -25,7 +25,8 @@ public:
 		value{value} {}
 
 	ValueHolder copy() const override {
-		return {std::make_shared<Number>(*this)};
+		// stored inline in the holder.
+		return {*this};
 	}
 
 	std::string str() const override {
@@ -24,16 +24,16 @@ static ValueHolder value_from_value_token(const Type &target_type,
 
 	switch (target_type.get_primitive_type()) {
 	case primitive_t::BOOLEAN:
-		return {std::make_shared<Boolean>(value_token)};
+		return {Boolean{value_token}};
 
 	case primitive_t::TEXT:
 		return {std::make_shared<Text>(value_token)};
 
 	case primitive_t::INT:
-		return {std::make_shared<Int>(value_token)};
+		return {Int{value_token}};
 
 	case primitive_t::FLOAT:
-		return {std::make_shared<Float>(value_token)};
+		return {Float{value_token}};
 
 	case primitive_t::FILENAME: {
 		// TODO: make relative to current namespace
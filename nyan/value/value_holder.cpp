@@ -1,13 +1,19 @@
-// Copyright 2017-2017 the nyan authors, LGPLv3+. See copying.md for legal info.
+// Copyright 2017-2019 the nyan authors, LGPLv3+. See copying.md for legal info.
 
 #include "value_holder.h"
 
+#include <new>
+
+#include "boolean.h"
+#include "number.h"
 #include "value.h"
 
 
 namespace nyan {
 
-ValueHolder::ValueHolder() = default;
+ValueHolder::ValueHolder()
+	:
+	value{} {}
 
 
 ValueHolder::ValueHolder(std::shared_ptr<Value> &&value)
@@ -20,18 +26,154 @@ ValueHolder::ValueHolder(const std::shared_ptr<Value> &value)
 	value{value} {}
 
 
+ValueHolder::ValueHolder(const Int &value)
+	:
+	storage{storage_t::INT} {
+
+	static_assert(sizeof(Int) <= inline_size and alignof(Int) <= inline_align,
+	              "value doesn't fit in the inline storage");
+
+	new (this->scalar) Int{value};
+}
+
+
+ValueHolder::ValueHolder(const Float &value)
+	:
+	storage{storage_t::FLOAT} {
+
+	static_assert(sizeof(Float) <= inline_size and alignof(Float) <= inline_align,
+	              "value doesn't fit in the inline storage");
+
+	new (this->scalar) Float{value};
+}
+
+
+ValueHolder::ValueHolder(const Boolean &value)
+	:
+	storage{storage_t::BOOLEAN} {
+
+	static_assert(sizeof(Boolean) <= inline_size and alignof(Boolean) <= inline_align,
+	              "value doesn't fit in the inline storage");
+
+	new (this->scalar) Boolean{value};
+}
+
+
+ValueHolder::ValueHolder(const ValueHolder &other) {
+	this->assign(other);
+}
+
+
+ValueHolder::ValueHolder(ValueHolder &&other) noexcept {
+	this->assign(std::move(other));
+}
+
+
+ValueHolder &ValueHolder::operator =(const ValueHolder &other) {
+	if (this != &other) {
+		this->destroy();
+		this->assign(other);
+	}
+	return *this;
+}
+
+
+ValueHolder &ValueHolder::operator =(ValueHolder &&other) noexcept {
+	if (this != &other) {
+		this->destroy();
+		this->assign(std::move(other));
+	}
+	return *this;
+}
+
+
+ValueHolder::~ValueHolder() {
+	this->destroy();
+}
+
+
+void ValueHolder::assign(const ValueHolder &other) {
+	this->storage = other.storage;
+
+	switch (other.storage) {
+	case storage_t::SHARED:
+		new (&this->value) std::shared_ptr<Value>{other.value};
+		break;
+	case storage_t::INT:
+		new (this->scalar) Int{static_cast<const Int &>(*other.get_value())};
+		break;
+	case storage_t::FLOAT:
+		new (this->scalar) Float{static_cast<const Float &>(*other.get_value())};
+		break;
+	case storage_t::BOOLEAN:
+		new (this->scalar) Boolean{static_cast<const Boolean &>(*other.get_value())};
+		break;
+	}
+}
+
+
+void ValueHolder::assign(ValueHolder &&other) {
+	if (other.storage == storage_t::SHARED) {
+		this->storage = storage_t::SHARED;
+		new (&this->value) std::shared_ptr<Value>{std::move(other.value)};
+	}
+	else {
+		// inline values are cheap to copy.
+		this->assign(other);
+	}
+}
+
+
+void ValueHolder::destroy() {
+	if (this->storage == storage_t::SHARED) {
+		this->value.~shared_ptr();
+	}
+	else {
+		this->get_value()->~Value();
+	}
+}
+
+
 Value *ValueHolder::get_value() const {
-	return this->value.get();
+	// the holder behaves like a pointer,
+	// so the inline value is not const either.
+	auto *scalar = const_cast<unsigned char *>(this->scalar);
+
+	switch (this->storage) {
+	case storage_t::SHARED:
+		return this->value.get();
+	case storage_t::INT:
+		return std::launder(reinterpret_cast<Int *>(scalar));
+	case storage_t::FLOAT:
+		return std::launder(reinterpret_cast<Float *>(scalar));
+	case storage_t::BOOLEAN:
+		return std::launder(reinterpret_cast<Boolean *>(scalar));
+	}
+
+	return nullptr;
 }
 
 
-const std::shared_ptr<Value> &ValueHolder::get_ptr() const {
-	return this->value;
+std::shared_ptr<Value> ValueHolder::get_ptr() const {
+	switch (this->storage) {
+	case storage_t::SHARED:
+		return this->value;
+	case storage_t::INT:
+		return std::make_shared<Int>(static_cast<const Int &>(*this->get_value()));
+	case storage_t::FLOAT:
+		return std::make_shared<Float>(static_cast<const Float &>(*this->get_value()));
+	case storage_t::BOOLEAN:
+		return std::make_shared<Boolean>(static_cast<const Boolean &>(*this->get_value()));
+	}
+
+	return nullptr;
 }
 
 
 void ValueHolder::clear() {
-	this->value = nullptr;
+	this->destroy();
+	this->storage = storage_t::SHARED;
+	new (&this->value) std::shared_ptr<Value>{nullptr};
 }
 
 
@@ -40,6 +182,11 @@ bool ValueHolder::exists() const {
 }
 
 
+bool ValueHolder::is_inline() const {
+	return this->storage != storage_t::SHARED;
+}
+
+
 Value &ValueHolder::operator *() const {
 	return *this->get_value();
 }
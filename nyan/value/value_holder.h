@@ -1,17 +1,28 @@
-// Copyright 2017-2017 the nyan authors, LGPLv3+. See copying.md for legal info.
+// Copyright 2017-2019 the nyan authors, LGPLv3+. See copying.md for legal info.
 #pragma once
 
+#include <cstdint>
 #include <memory>
 
+#include "../config.h"
+
 
 namespace nyan {
 
+class Boolean;
 class Value;
 
+template <typename T>
+class Number;
+
 
 /**
- * Wrapper class to hold values by shared pointer.
+ * Wrapper class to hold values.
  * Used to redirect the hashing and comparison function inside the ptr.
+ *
+ * Scalar values (int, float, bool) are stored inline in the holder,
+ * all other values are stored by shared pointer.
+ * Like a pointer, the held value can be modified through a const holder.
  */
 class ValueHolder {
 public:
@@ -19,18 +30,84 @@ public:
 	ValueHolder(std::shared_ptr<Value> &&value);
 	ValueHolder(const std::shared_ptr<Value> &value);
 
+	/**
+	 * Store a scalar value inline, without a heap allocation.
+	 */
+	ValueHolder(const Number<value_int_t> &value);
+	ValueHolder(const Number<value_float_t> &value);
+	ValueHolder(const Boolean &value);
+
+	ValueHolder(const ValueHolder &other);
+	ValueHolder(ValueHolder &&other) noexcept;
+	ValueHolder &operator =(const ValueHolder &other);
+	ValueHolder &operator =(ValueHolder &&other) noexcept;
+
+	~ValueHolder();
+
 	Value *get_value() const;
-	const std::shared_ptr<Value> &get_ptr() const;
+
+	/**
+	 * Return a shared pointer to the value.
+	 * Inline values are copied to the heap for that.
+	 */
+	std::shared_ptr<Value> get_ptr() const;
+
 	void clear();
 	bool exists() const;
 
+	/**
+	 * Return true if the value is stored inline.
+	 */
+	bool is_inline() const;
+
 	Value &operator *() const;
 	Value *operator ->() const;
 	bool operator ==(const ValueHolder &other) const;
 	bool operator !=(const ValueHolder &other) const;
 
 protected:
-	std::shared_ptr<Value> value;
+	/**
+	 * How the value is stored.
+	 */
+	enum class storage_t : uint8_t {
+		SHARED,
+		INT,
+		FLOAT,
+		BOOLEAN,
+	};
+
+	/**
+	 * Take over the value of the other holder.
+	 * This holder must not contain a value.
+	 */
+	void assign(const ValueHolder &other);
+	void assign(ValueHolder &&other);
+
+	/**
+	 * Destroy the stored value.
+	 */
+	void destroy();
+
+	/**
+	 * Size and alignment of the inline storage.
+	 * Fits a vtable pointer and the scalar.
+	 */
+	static constexpr size_t inline_size = 2 * sizeof(uint64_t);
+	static constexpr size_t inline_align = alignof(uint64_t);
+
+	storage_t storage = storage_t::SHARED;
+
+	union {
+		/**
+		 * The value if it's stored by shared pointer.
+		 */
+		std::shared_ptr<Value> value;
+
+		/**
+		 * Storage for inline values.
+		 */
+		alignas(inline_align) unsigned char scalar[inline_size];
+	};
 };
 
 } // namespace nyan
@@ -48,4 +125,3 @@ struct hash<nyan::ValueHolder> {
 };
 
 } // namespace std
-
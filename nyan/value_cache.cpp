@@ -0,0 +1,36 @@
+// Copyright 2019-2019 the nyan authors, LGPLv3+. See copying.md for legal info.
+
+#include "value_cache.h"
+
+#include <mutex>
+
+
+namespace nyan {
+
+
+const ValueHolder *ValueCache::get(member_id_t member) const {
+	std::shared_lock<std::shared_mutex> lock{this->mutex};
+
+	auto it = this->values.find(member);
+	if (it == std::end(this->values)) {
+		return nullptr;
+	}
+
+	// the map nodes don't move when other values are inserted.
+	return &it->second;
+}
+
+
+void ValueCache::insert(member_id_t member, const ValueHolder &value) {
+	std::unique_lock<std::shared_mutex> lock{this->mutex};
+	this->values.try_emplace(member, value);
+}
+
+
+size_t ValueCache::size() const {
+	std::shared_lock<std::shared_mutex> lock{this->mutex};
+	return this->values.size();
+}
+
+
+} // namespace nyan
@@ -0,0 +1,52 @@
+// Copyright 2019-2019 the nyan authors, LGPLv3+. See copying.md for legal info.
+#pragma once
+
+#include <shared_mutex>
+#include <unordered_map>
+
+#include "config.h"
+#include "value/value_holder.h"
+
+
+namespace nyan {
+
+
+/**
+ * Member values of an object, calculated on demand.
+ *
+ * Threads can look up and add values at the same time.
+ * Stored values are never replaced or removed, so a returned
+ * value stays valid as long as the cache exists.
+ */
+class ValueCache {
+public:
+	/**
+	 * Return the value stored for the member, or nullptr.
+	 */
+	const ValueHolder *get(member_id_t member) const;
+
+	/**
+	 * Store the value of the member.
+	 * If a value was stored meanwhile, that one is kept.
+	 */
+	void insert(member_id_t member, const ValueHolder &value);
+
+	/**
+	 * Return the number of stored values.
+	 */
+	size_t size() const;
+
+protected:
+	/**
+	 * Held shared for lookups, exclusive for insertions.
+	 */
+	mutable std::shared_mutex mutex;
+
+	/**
+	 * The stored values, by member.
+	 */
+	std::unordered_map<member_id_t, ValueHolder> values;
+};
+
+
+} // namespace nyan
@@ -2,52 +2,139 @@
 
 #include "view.h"
 
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "api_error.h"
 #include "c3.h"
 #include "database.h"
+#include "object_info.h"
 #include "object_notifier.h"
 #include "object_state.h"
 #include "state.h"
+#include "value_cache.h"
 
 
 namespace nyan {
 
+/**
+ * State histories pinned by the ReadGuards of this thread.
+ */
+static thread_local std::vector<std::pair<const View *,
+                                          std::shared_ptr<const StateHistory>>> pinned_histories;
+
+
+View::ReadGuard::ReadGuard(const View &view)
+	:
+	pinned{0} {
+
+	this->pin(view);
+}
+
+
+View::ReadGuard::~ReadGuard() {
+	for (size_t i = 0; i < this->pinned; i++) {
+		pinned_histories.pop_back();
+	}
+}
+
+
+void View::ReadGuard::pin(const View &view) {
+	// pin the parents first, so the view's history is
+	// at least as new as the ones it reads through.
+	if (view.parent_view) {
+		this->pin(*view.parent_view);
+	}
+
+	if (not view.concurrent_reads) {
+		return;
+	}
+
+	for (auto &it : pinned_histories) {
+		if (it.first == &view) {
+			// an outer guard pinned the history already.
+			return;
+		}
+	}
+
+	pinned_histories.emplace_back(&view, std::atomic_load(&view.state));
+	this->pinned += 1;
+}
+
+
+/**
+ * Databases whose WriteGuard is held by this thread,
+ * once for each guard.
+ */
+static thread_local std::vector<const Database *> write_locked;
+
+
+View::WriteGuard::WriteGuard(const View &view)
+	:
+	lock{view.database->get_write_mutex()},
+	database{view.database.get()} {
+
+	write_locked.push_back(this->database);
+}
+
+
+View::WriteGuard::~WriteGuard() {
+	// the guards of a thread are destroyed in reverse order.
+	write_locked.pop_back();
+}
+
 
 View::View(const std::shared_ptr<Database> &database)
 	:
 	database{database},
-	state{database} {}
+	state{std::make_shared<StateHistory>(database)},
+	concurrent_reads{false},
+	fork_time{LATEST_T},
+	async_notifications{false},
+	last_reset{0} {}
 
 
 Object View::get_object(const fqon_t &fqon) {
 	// test for object existence
-	this->get_info(fqon);
+	const obj_id_t *obj = this->database->get_info().get_object_id(fqon);
+	if (obj == nullptr) {
+		throw ObjectNotFoundError{fqon};
+	}
 
 	// TODO: store info in object to avoid further lookups.
-	return Object{fqon, shared_from_this()};
+	return Object{*obj, shared_from_this()};
 }
 
 
-const std::shared_ptr<ObjectState> &View::get_raw(const fqon_t &fqon, order_t t) const {
-	auto state = this->state.get_obj_state(fqon, t);
-	if (state == nullptr) {
-		auto &dbstate = this->database->get_state();
-		auto db_obj_state = dbstate->get(fqon);
-		if (db_obj_state == nullptr) {
-			throw ObjectNotFoundError{fqon};
-		}
+const std::shared_ptr<ObjectState> &View::get_raw(obj_id_t obj, order_t t) const {
+	const StateHistory &history = this->read_state_history();
+	auto state = history.get_obj_state(obj, t);
+	if (state != nullptr) {
+		return *state;
+	}
 
-		return *db_obj_state;
+	// the object is unchanged in this view, so the parent has it.
+	if (this->parent_view) {
+		return this->parent_view->get_raw(obj, this->parent_time(history, t));
 	}
-	else {
-		return *state;
+
+	auto &dbstate = this->database->get_state();
+	auto db_obj_state = dbstate->get(obj);
+	if (db_obj_state == nullptr) {
+		throw ObjectNotFoundError{this->get_symbols().get_object_name(obj)};
 	}
+
+	return *db_obj_state;
 }
 
 
-const ObjectInfo &View::get_info(const fqon_t &fqon) const {
-	const ObjectInfo *info = this->database->get_info().get_object(fqon);
+const ObjectInfo &View::get_info(obj_id_t obj) const {
+	const ObjectInfo *info = this->database->get_info().get_object(obj);
 	if (unlikely(info == nullptr)) {
-		throw ObjectNotFoundError{fqon};
+		throw ObjectNotFoundError{this->get_symbols().get_object_name(obj)};
 	}
 
 	return *info;
@@ -60,13 +147,48 @@ Transaction View::new_transaction(order_t t) {
 
 
 std::shared_ptr<View> View::new_child() {
+	return this->fork(LATEST_T);
+}
+
+
+std::shared_ptr<View> View::fork(order_t t) {
+	// the new view has no records, it reads everything through this view.
 	auto ret = std::make_shared<View>(this->database);
+	ret->concurrent_reads = this->concurrent_reads;
+	ret->async_notifications = this->async_notifications;
+	ret->fork_time = t;
+
+	WriteGuard lock{*this};
 	this->add_child(ret);
 	return ret;
 }
 
 
+bool View::merge(const std::shared_ptr<View> &child, order_t t) {
+	if (child->parent_view.get() != this) {
+		throw APIError{"merged view is not a child of this view"};
+	}
+
+	Transaction tx{t, this->shared_from_this()};
+	tx.merge_view(child);
+
+	if (tx.patches.empty()) {
+		// nothing was committed on the child.
+		return true;
+	}
+
+	return tx.commit();
+}
+
+
+order_t View::get_fork_time() const {
+	return this->fork_time;
+}
+
+
 void View::cleanup_stale_children() {
+	WriteGuard lock{*this};
+
 	auto it = std::begin(this->children);
 
 	while (it != std::end(this->children)) {
@@ -96,29 +218,92 @@ const Database &View::get_database() const {
 }
 
 
-const std::vector<fqon_t> &View::get_linearization(const fqon_t &fqon, order_t t) const {
-	return this->state.get_linearization(fqon, t, this->get_database().get_info());
+const SymbolTable &View::get_symbols() const {
+	return this->database->get_info().get_symbols();
 }
 
 
-const std::unordered_set<fqon_t> &View::get_obj_children(const fqon_t &fqon, order_t t) const {
-	return this->state.get_children(fqon, t, this->get_database().get_info());
+const MemberKey *View::get_member_key(const memberid_t &name) const {
+	return this->database->get_info().get_member_key(name);
 }
 
 
-std::unordered_set<fqon_t> View::get_obj_children_all(const fqon_t &fqon, order_t t) const {
-	std::unordered_set<fqon_t> ret;
+const std::vector<obj_id_t> &View::get_linearization(obj_id_t obj, order_t t) const {
+	const StateHistory &history = this->read_state_history();
+	auto lin = history.get_linearization(obj, t);
+	if (lin != nullptr) {
+		return *lin;
+	}
 
-	this->gather_obj_children(ret, fqon, t);
+	if (this->parent_view) {
+		return this->parent_view->get_linearization(obj, this->parent_time(history, t));
+	}
 
-	return ret;
+	// otherwise, the lin is only stored in the database.
+	return this->get_info(obj).get_linearization();
+}
+
+
+const Ancestry &View::get_ancestry(obj_id_t obj, order_t t) const {
+	const StateHistory &history = this->read_state_history();
+	auto ancestry = history.get_ancestry(obj, t);
+	if (ancestry != nullptr) {
+		return *ancestry;
+	}
+
+	if (this->parent_view) {
+		return this->parent_view->get_ancestry(obj, this->parent_time(history, t));
+	}
+
+	return this->get_info(obj).get_ancestry();
+}
+
+
+const std::unordered_set<obj_id_t> &View::get_obj_children(obj_id_t obj, order_t t) const {
+	const StateHistory &history = this->read_state_history();
+	auto children = history.get_children(obj, t);
+	if (children != nullptr) {
+		return *children;
+	}
+
+	if (this->parent_view) {
+		return this->parent_view->get_obj_children(obj, this->parent_time(history, t));
+	}
+
+	return this->get_info(obj).get_children();
+}
+
+
+const std::vector<obj_id_t> &View::get_obj_children_all(obj_id_t obj, order_t t) const {
+	const StateHistory &history = this->read_state_history();
+	auto descendants = history.get_descendants(obj, t);
+	if (descendants != nullptr) {
+		return *descendants;
+	}
+
+	if (this->parent_view) {
+		return this->parent_view->get_obj_children_all(obj, this->parent_time(history, t));
+	}
+
+	return this->get_info(obj).get_descendants();
 }
 
 
-std::shared_ptr<ObjectNotifier> View::create_notifier(const fqon_t &fqon,
-                                                      const update_cb_t &callback) {
+const std::vector<obj_id_t> &View::get_instances(const fqon_t &type, order_t t) const {
+	const obj_id_t *obj = this->database->get_info().get_object_id(type);
+	if (obj == nullptr) {
+		throw ObjectNotFoundError{type};
+	}
+
+	return this->get_obj_children_all(*obj, t);
+}
+
 
-	auto it = this->notifiers.find(fqon);
+std::shared_ptr<ObjectNotifier> View::create_notifier(obj_id_t obj,
+                                                      const update_cb_t &callback,
+                                                      std::unordered_set<member_id_t> &&members) {
+
+	auto it = this->notifiers.find(obj);
 	decltype(this->notifiers)::mapped_type *notifier_set = nullptr;
 
 	if (it == std::end(this->notifiers)) {
@@ -126,7 +311,7 @@ std::shared_ptr<ObjectNotifier> View::create_notifier(const fqon_t &fqon,
 		// create new set, add to object map and and get pointer
 		auto ins = this->notifiers.insert(
 			{
-				fqon,
+				obj,
 				std::unordered_set<std::shared_ptr<ObjectNotifierHandle>>{},
 			}
 		);
@@ -137,16 +322,17 @@ std::shared_ptr<ObjectNotifier> View::create_notifier(const fqon_t &fqon,
 		notifier_set = &it->second;
 	}
 
-	auto notifier = std::make_shared<ObjectNotifier>(fqon, callback, this->shared_from_this());
+	auto notifier = std::make_shared<ObjectNotifier>(obj, callback, std::move(members),
+	                                                 this->shared_from_this());
 	const auto& handle = notifier->get_handle();
 	notifier_set->insert(handle);
 	return notifier;
 }
 
 
-void View::deregister_notifier(const fqon_t &fqon,
+void View::deregister_notifier(obj_id_t obj,
                                const std::shared_ptr<ObjectNotifierHandle> &notifier) {
-	auto it = this->notifiers.find(fqon);
+	auto it = this->notifiers.find(obj);
 	if (it != std::end(this->notifiers)) {
 		size_t removed = it->second.erase(notifier);
 		if (removed == 0) {
@@ -159,40 +345,323 @@ void View::deregister_notifier(const fqon_t &fqon,
 }
 
 
-void View::fire_notifications(const std::unordered_set<fqon_t> &changed_objs,
-                              order_t t) const {
-	for (auto &obj : changed_objs) {
-		auto it = this->notifiers.find(obj);
-		if (it != std::end(this->notifiers)) {
-			for (auto &notifier : it->second) {
-				const std::shared_ptr<ObjectState> &obj_state = this->get_raw(obj, t);
-				notifier->fire(t, obj, *obj_state);
+void View::reset_from(order_t t) {
+	WriteGuard lock{*this};
+
+	this->drop_after(t);
+
+	// the parent views keep their later transactions.
+	if (this->parent_view) {
+		this->reapply_parent_transactions(t);
+	}
+}
+
+
+void View::reapply_parent_transactions(order_t t) {
+	std::vector<transaction_record> parent_transactions;
+	this->get_parent_transactions(t, parent_transactions);
+	if (parent_transactions.empty()) {
+		return;
+	}
+
+	// they are also applied in the child views with records.
+	// all views are replayed at once, so the indexes are updated
+	// once for each batch instead of for each transaction.
+	// the changes were visible before, so nothing is notified.
+	auto changes = Transaction::replay(std::move(parent_transactions));
+	for (auto &it : changes) {
+		it.first->publish_state_history();
+	}
+}
+
+
+void View::get_parent_transactions(order_t t, std::vector<transaction_record> &records) {
+	if (not this->read_state_history().empty()) {
+		Transaction::get_parent_transactions(this->shared_from_this(), t, records);
+		return;
+	}
+
+	// this view sees them through its parent,
+	// but the child views may have records.
+	bool has_stale_children = false;
+	for (auto &child_view_weakptr : this->children) {
+		auto child_view = child_view_weakptr.lock();
+		if (not child_view) {
+			has_stale_children = true;
+			continue;
+		}
+
+		// the later changes are not seen in the fork anyway.
+		if (t >= child_view->fork_time) {
+			continue;
+		}
+
+		child_view->get_parent_transactions(t, records);
+	}
+
+	if (has_stale_children) {
+		this->cleanup_stale_children();
+	}
+}
+
+
+void View::drop_after(order_t t) {
+	this->get_state_history().drop_after(t);
+	this->publish_state_history();
+
+	// transactions built before can't know what changed.
+	this->last_reset = Transaction::get_next_id();
+
+	// transactions were also applied to the child views.
+	bool has_stale_children = false;
+	for (auto &child_view_weakptr : this->children) {
+		auto child_view = child_view_weakptr.lock();
+		if (not child_view) {
+			has_stale_children = true;
+			continue;
+		}
+
+		if (t >= child_view->fork_time) {
+			continue;
+		}
+
+		child_view->drop_after(t);
+	}
+
+	if (has_stale_children) {
+		this->cleanup_stale_children();
+	}
+}
+
+
+size_t View::compact_before(order_t horizon) {
+	WriteGuard lock{*this};
+
+	size_t reclaimed = this->get_state_history().compact_before(horizon);
+	this->publish_state_history();
+
+	bool has_stale_children = false;
+	for (auto &child_view_weakptr : this->children) {
+		auto child_view = child_view_weakptr.lock();
+		if (not child_view) {
+			has_stale_children = true;
+			continue;
+		}
+
+		reclaimed += child_view->compact_before(horizon);
+	}
+
+	if (has_stale_children) {
+		this->cleanup_stale_children();
+	}
+
+	return reclaimed;
+}
+
+
+void View::fire_notifications(const changed_objects_t &changed_objs,
+                              order_t t) {
+	if (this->async_notifications) {
+		this->notification_queue.push(pending_notification{t, changed_objs});
+	}
+	else {
+		this->notify(changed_objs, t);
+	}
+
+	// child views without records see the changes through this view.
+	// the others were updated by the transaction and are notified then.
+	for (auto &child_view_weakptr : this->children) {
+		auto child_view = child_view_weakptr.lock();
+		if (child_view and t <= child_view->fork_time and
+		    child_view->read_state_history().empty()) {
+			child_view->fire_notifications(changed_objs, t);
+		}
+	}
+}
+
+
+void View::notify(const changed_objects_t &changed_objs, order_t t) const {
+	for (auto &changed : changed_objs) {
+		auto it = this->notifiers.find(changed.first);
+		if (it == std::end(this->notifiers)) {
+			continue;
+		}
+
+		// fetched once for all notifiers of the object.
+		const ObjectState *obj_state = nullptr;
+		const fqon_t *name = nullptr;
+
+		for (auto &notifier : it->second) {
+			// the notifier may only be interested in other members.
+			if (not notifier->is_interested(changed.second)) {
+				continue;
+			}
+
+			if (obj_state == nullptr) {
+				obj_state = this->get_raw(changed.first, t).get();
+				name = &this->get_symbols().get_object_name(changed.first);
 			}
+
+			notifier->fire(t, *name, *obj_state);
+		}
+	}
+}
+
+
+void View::set_async_notifications(bool enabled) {
+	this->async_notifications = enabled;
+}
+
+
+bool View::has_async_notifications() const {
+	return this->async_notifications;
+}
+
+
+size_t View::dispatch_notifications() {
+	// keep the states passed to the callbacks alive.
+	ReadGuard guard{*this};
+
+	size_t count = 0;
+	this->notification_queue.consume_all(
+		[this, &count] (pending_notification &&pending) {
+			this->notify(pending.changed_objs, pending.t);
+			count += pending.changed_objs.size();
+		}
+	);
+
+	return count;
+}
+
+
+void View::set_concurrent_reads(bool enabled) {
+	this->publish_state_history();
+	this->concurrent_reads = enabled;
+}
+
+
+bool View::has_concurrent_reads() const {
+	return this->concurrent_reads;
+}
+
+
+const StateHistory &View::read_state_history() const {
+	if (not this->concurrent_reads) {
+		return *this->state;
+	}
+
+	// the writer sees its own modifications, and no other
+	// thread replaces the published history meanwhile.
+	if (this->is_writer()) {
+		if (this->pending_state) {
+			return *this->pending_state;
+		}
+		return *this->state;
+	}
+
+	for (auto it = pinned_histories.rbegin(); it != pinned_histories.rend(); ++it) {
+		if (it->first == this) {
+			return *it->second;
 		}
 	}
+
+	// the published history may be replaced and freed any time.
+	throw APIError{"concurrent read without a ReadGuard"};
+}
+
+
+bool View::is_writer() const {
+	return std::find(std::begin(write_locked), std::end(write_locked),
+	                 this->database.get()) != std::end(write_locked);
 }
 
 
+ValueCache &View::get_value_cache(obj_id_t obj, order_t t) const {
+	// the first view that has value records for the object decides,
+	// as the views without them have the same values as their parent.
+	const View *view = this;
+	while (true) {
+		const StateHistory &history = view->read_state_history();
+		ValueCache *values = history.get_values(obj, t);
+		if (values != nullptr) {
+			return *values;
+		}
+
+		if (not view->parent_view) {
+			break;
+		}
+		t = view->parent_time(history, t);
+		view = view->parent_view.get();
+	}
+
+	// neither the object nor its parents were patched until t,
+	// so it has the values it was loaded with.
+	return this->get_info(obj).get_initial_values();
+}
 
-void View::gather_obj_children(std::unordered_set<fqon_t> &target,
-                               const fqon_t &obj,
-                               order_t t) const {
 
-	for (auto &child : this->get_obj_children(obj, t)) {
-		target.insert(child);
+order_t View::parent_time(const StateHistory &history, order_t t) const {
+	// the parent transactions after the first record of the history
+	// are also applied in it, so the data it has no records for didn't
+	// change in the parent since then. transactions that are applied
+	// again in the history must not be seen in the parent meanwhile.
+	// the parent changes after the fork time are never seen.
+	return std::min({t, history.get_first_record(), this->fork_time});
+}
+
 
-		// TODO optimize: maybe it's faster to not recurse
-		//                if that child was already in the set.
-		//                because then all its childs will
-		//                be in there already.
-		this->gather_obj_children(target, child, t);
+void View::record_writes(const changed_objects_t &objs, transaction_id_t id) {
+	for (auto &it : objs) {
+		this->record_write(it.first, id);
 	}
 }
 
 
+void View::record_write(obj_id_t obj, transaction_id_t id) {
+	this->last_writes[obj] = id;
+}
+
+
+transaction_id_t View::get_last_write(obj_id_t obj) const {
+	transaction_id_t ret = 0;
+
+	// the object may be read through the parent views.
+	for (const View *view = this; view != nullptr; view = view->parent_view.get()) {
+		ret = std::max(ret, view->last_reset);
+
+		auto it = view->last_writes.find(obj);
+		if (it != std::end(view->last_writes)) {
+			ret = std::max(ret, it->second);
+		}
+	}
+
+	return ret;
+}
+
 
 StateHistory &View::get_state_history() {
-	return this->state;
+	if (not this->concurrent_reads) {
+		return *this->state;
+	}
+
+	if (unlikely(not this->is_writer())) {
+		throw InternalError{"state history modified without the write lock"};
+	}
+
+	// readers may still use the published history,
+	// so the modifications are done in a copy.
+	if (not this->pending_state) {
+		this->pending_state = std::make_shared<StateHistory>(*this->state);
+	}
+	return *this->pending_state;
+}
+
+
+void View::publish_state_history() {
+	if (this->pending_state) {
+		std::atomic_store(&this->state, std::move(this->pending_state));
+		this->pending_state = nullptr;
+	}
 }
 
 
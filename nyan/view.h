@@ -2,11 +2,13 @@
 #pragma once
 
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
 
 #include "curve.h"
+#include "datastructure/mpsc_queue.h"
 #include "object.h"
 #include "state_history.h"
 #include "transaction.h"
@@ -14,86 +16,363 @@
 
 namespace nyan {
 
+class Ancestry;
 class Database;
 class ObjectState;
 class ObjectNotifier;
 class ObjectNotifierHandle;
 class State;
+class SymbolTable;
 
 
 /**
  * Database state view.
  */
 class View : public std::enable_shared_from_this<View> {
+	friend class Object;
 	friend class Transaction;
 public:
+	/**
+	 * Keeps the state history of a view unchanged for the current thread
+	 * while the guard is alive: reads on the view in this thread use the
+	 * history that was current when the guard was created, even if a
+	 * transaction is committed meanwhile.
+	 * Nested guards for the same view use the outermost history.
+	 * The parent views are pinned as well.
+	 * Only has an effect in concurrent read mode.
+	 */
+	class ReadGuard {
+	public:
+		ReadGuard(const View &view);
+		~ReadGuard();
+
+		ReadGuard(const ReadGuard &other) = delete;
+		ReadGuard &operator =(const ReadGuard &other) = delete;
+
+	protected:
+		/**
+		 * Pin the history of the view and of its parents,
+		 * which are read for data the view doesn't have itself.
+		 */
+		void pin(const View &view);
+
+		/**
+		 * Number of histories this guard pinned and has to release.
+		 */
+		size_t pinned;
+	};
+
+	/**
+	 * Serializes the modifications of the views of a database:
+	 * commits, resets, compactions and new child views.
+	 * While the guard is alive, the current thread reads the
+	 * histories it modifies, without a ReadGuard.
+	 */
+	class WriteGuard {
+	public:
+		WriteGuard(const View &view);
+		~WriteGuard();
+
+		WriteGuard(const WriteGuard &other) = delete;
+		WriteGuard &operator =(const WriteGuard &other) = delete;
+
+	protected:
+		std::lock_guard<std::recursive_mutex> lock;
+
+		/**
+		 * Database whose views are locked.
+		 */
+		const Database *database;
+	};
+
 	View(const std::shared_ptr<Database> &database);
 
 	Object get_object(const fqon_t &fqon);
 
-	const std::shared_ptr<ObjectState> &get_raw(const fqon_t &fqon, order_t t=LATEST_T) const;
+	/**
+	 * Get the state of an object at t.
+	 * In concurrent read mode, the returned reference is only valid
+	 * while a ReadGuard for the view is held.
+	 * The same applies to the other functions returning references.
+	 */
+	const std::shared_ptr<ObjectState> &get_raw(obj_id_t obj, order_t t=LATEST_T) const;
 
-	const ObjectInfo &get_info(const fqon_t &fqon) const;
+	const ObjectInfo &get_info(obj_id_t obj) const;
 
 	Transaction new_transaction(order_t t=DEFAULT_T);
 
+	/**
+	 * Create a child view. Transactions on this view are also applied
+	 * in the child, but not the other way round.
+	 * The child reads all data it has no records of its own for
+	 * from this view, so transactions only need to be applied in it
+	 * once it has diverged by a transaction of its own.
+	 */
 	std::shared_ptr<View> new_child();
 
+	/**
+	 * Create a child view that follows this view only until t.
+	 * It shares all data of this view up to t, nothing is copied
+	 * until a transaction is committed on it, which then only copies
+	 * the patched objects. Transactions on this view later than t
+	 * are not applied in the fork.
+	 * This view must not be compacted beyond t while the fork is used.
+	 */
+	std::shared_ptr<View> fork(order_t t=LATEST_T);
+
+	/**
+	 * Apply the changes of the transactions committed on a child view
+	 * in this view, as one transaction at t.
+	 * The patches of the transactions committed on the child itself,
+	 * not those it got from this view, are applied again in their
+	 * order on the current state of this view, so changes committed
+	 * here since the child was created are kept.
+	 * Like for any commit, transactions of this view later than t
+	 * are dropped and applied again on top of the merge.
+	 * Returns true if the transaction was successful.
+	 * The child is unchanged and should be discarded afterwards.
+	 */
+	bool merge(const std::shared_ptr<View> &child, order_t t=DEFAULT_T);
+
+	/**
+	 * Return the time until which this view follows its parent view.
+	 */
+	order_t get_fork_time() const;
+
 	// TODO: replace by deregistering child when it is destroyed
 	void cleanup_stale_children();
 
 	const Database &get_database() const;
 
-	const std::vector<fqon_t> &get_linearization(const fqon_t &fqon, order_t t=LATEST_T) const;
+	/**
+	 * Return the names of the database objects and members.
+	 */
+	const SymbolTable &get_symbols() const;
+
+	/**
+	 * Return the prepared lookup key for a member name,
+	 * or nullptr if no object has the member.
+	 * Use it to access member values without name lookups.
+	 */
+	const MemberKey *get_member_key(const memberid_t &name) const;
+
+	const std::vector<obj_id_t> &get_linearization(obj_id_t obj, order_t t=LATEST_T) const;
+
+	/**
+	 * Get the ancestors and present members of an object at t,
+	 * which can be tested in constant time.
+	 */
+	const Ancestry &get_ancestry(obj_id_t obj, order_t t=LATEST_T) const;
 
 	/**
 	 * Get the direct ancestor children of an object.
 	 * Does not step further down than one inheritance level.
 	 */
-	const std::unordered_set<fqon_t> &get_obj_children(const fqon_t &fqon, order_t t=LATEST_T) const;
+	const std::unordered_set<obj_id_t> &get_obj_children(obj_id_t obj, order_t t=LATEST_T) const;
 
 	/**
-	 * Get all ancestor children of an object including the transitive onces.
+	 * Get all ancestor children of an object including the transitive onces,
+	 * sorted by id. They are indexed, so this doesn't traverse the hierarchy.
 	 */
-	std::unordered_set<fqon_t> get_obj_children_all(const fqon_t &fqon, order_t t=LATEST_T) const;
+	const std::vector<obj_id_t> &get_obj_children_all(obj_id_t obj, order_t t=LATEST_T) const;
+
+	/**
+	 * Get all objects that extend the given type at t, sorted by id.
+	 * The type itself is not included.
+	 * The result is kept up to date by the transactions,
+	 * so this is a lookup without traversing the objects.
+	 */
+	const std::vector<obj_id_t> &get_instances(const fqon_t &type, order_t t=LATEST_T) const;
 
 	/**
 	 * Register a function that is called whenever the given object or any of its parents
 	 * change a value.
+	 * If members are given, it is only called when one of their values may have changed.
 	 * You need to keep the returned ObjectNotifier alive, because when it is deconstructed,
 	 * the callback will be deregistered.
 	 */
-	std::shared_ptr<ObjectNotifier> create_notifier(const fqon_t &fqon, const update_cb_t &callback);
+	std::shared_ptr<ObjectNotifier> create_notifier(obj_id_t obj, const update_cb_t &callback,
+	                                                std::unordered_set<member_id_t> &&members={});
 
-	void deregister_notifier(const fqon_t &fqon,
+	void deregister_notifier(obj_id_t obj,
 	                         const std::shared_ptr<ObjectNotifierHandle> &notifier);
 
 	/**
-	 * Drop all state later than given time.
+	 * Drop all state later than given time, in this view and its child views.
 	 * This drops child tracking, value caches, linearizations.
 	 * Also deletes then-unchanged objects histories.
+	 * Only the objects modified after t are visited.
+	 * The later transactions of the parent views are kept,
+	 * they are applied again if the view still has records.
+	 * No notifications are fired for the dropped changes.
+	 */
+	void reset_from(order_t t=DEFAULT_T);
+
+	/**
+	 * Fold all states earlier than the horizon into one base state,
+	 * in this view and its child views, and drop the history records
+	 * that are no longer needed.
+	 * Queries at or after the horizon are not affected.
+	 * The view must not be queried, patched or reset earlier than
+	 * the horizon afterwards.
+	 * Returns the estimated number of bytes released.
 	 */
-	// TODO void reset_from(order_t t=DEFAULT_T);
+	size_t compact_before(order_t horizon);
 
 
 	/**
-	 * Call the notifications for the given objects.
+	 * Enable or disable concurrent reads.
+	 *
+	 * With concurrent reads, any number of threads can read from the
+	 * view while one thread commits transactions, without blocking.
+	 * Transactions modify a copy of the state history and publish it
+	 * atomically when they are done. A reader keeps using the history
+	 * it started with, which is freed once its last reader is done.
+	 * Use the Object member functions or hold a ReadGuard to read.
+	 *
+	 * Calculated member values are cached in this mode as well.
+	 * The caches are shared by the history copies, so readers
+	 * add values to them without modifying the history.
+	 * Child views created afterwards inherit the setting.
+	 * Reads on a child view also read its parents, so they need
+	 * concurrent reads as well if they are modified meanwhile.
+	 * Must not be changed while other threads use the view.
 	 */
-	void fire_notifications(const std::unordered_set<fqon_t> &changed_objs,
-	                        order_t t) const;
+	void set_concurrent_reads(bool enabled);
+
+	/**
+	 * Check if concurrent reads are enabled.
+	 */
+	bool has_concurrent_reads() const;
+
+	/**
+	 * Enable or disable asynchronous notifications.
+	 *
+	 * Then commits don't call the notification callbacks, they
+	 * only queue the objects changed by them, each object once
+	 * per commit. The callbacks are called when the queue is
+	 * drained by dispatch_notifications(), so the commit doesn't
+	 * wait for them.
+	 *
+	 * Child views created afterwards inherit the setting.
+	 * Must not be changed while other threads use the view.
+	 */
+	void set_async_notifications(bool enabled);
+
+	/**
+	 * Check if notifications are queued instead of called by commits.
+	 */
+	bool has_async_notifications() const;
+
+	/**
+	 * Call the notification callbacks for the queued changes,
+	 * in the order they were committed. Only one thread may
+	 * dispatch at a time. The notifiers must be created and
+	 * destroyed by that thread, and while transactions are
+	 * committed by other threads, the view needs concurrent reads.
+	 * Returns the number of changed objects that were dispatched.
+	 */
+	size_t dispatch_notifications();
+
+	/**
+	 * Call the notifications for the given objects, or queue them
+	 * with asynchronous notifications.
+	 * Also does so in the child views without records of their own.
+	 */
+	void fire_notifications(const changed_objects_t &changed_objs,
+	                        order_t t);
 
 
 protected:
 	const std::vector<std::weak_ptr<View>> &get_children();
 
-	void gather_obj_children(std::unordered_set<fqon_t> &target,
-	                         const fqon_t &obj,
-	                         order_t t) const;
+	/**
+	 * Drop all state later than t in this view and its child views.
+	 */
+	void drop_after(order_t t);
 
+	/**
+	 * Apply the transactions of the parent views later than t again
+	 * in this view and its child views that have records,
+	 * after their records later than t were dropped.
+	 */
+	void reapply_parent_transactions(order_t t);
+
+	/**
+	 * Add the transactions of the parent views later than t
+	 * that have to be applied again in this view, or in its
+	 * child views with records if this view has none.
+	 */
+	void get_parent_transactions(order_t t, std::vector<transaction_record> &records);
+
+	/**
+	 * Return the state history to read from.
+	 * In concurrent read mode, the thread holding the WriteGuard reads
+	 * the one it modifies, the other threads the one pinned by their
+	 * ReadGuard. Reading without either of them is an error.
+	 */
+	const StateHistory &read_state_history() const;
+
+	/**
+	 * Check if the current thread holds the WriteGuard
+	 * of the database of this view.
+	 */
+	bool is_writer() const;
+
+	/**
+	 * Return the cache for the member values of an object at t.
+	 * It's the one of the parent view if the object is unchanged here,
+	 * and the one of the object info if it is unchanged in all views.
+	 * Calculated values can be added to it in concurrent read mode too.
+	 */
+	ValueCache &get_value_cache(obj_id_t obj, order_t t) const;
+
+	/**
+	 * Return the time to look up data at in the parent view
+	 * if the given history of this view has no records for it at t.
+	 */
+	order_t parent_time(const StateHistory &history, order_t t) const;
+
+	/**
+	 * Remember that a commit changed the objects.
+	 */
+	void record_writes(const changed_objects_t &objs, transaction_id_t id);
+	void record_write(obj_id_t obj, transaction_id_t id);
+
+	/**
+	 * Return the id of the last commit that may have changed the object
+	 * in this view or in the parent views it is read from.
+	 */
+	transaction_id_t get_last_write(obj_id_t obj) const;
+
+	/**
+	 * Return the state history to modify.
+	 * In concurrent read mode, this is a copy of the published history,
+	 * which becomes visible to readers by publish_state_history().
+	 * The WriteGuard must be held then.
+	 */
 	StateHistory &get_state_history();
 
+	/**
+	 * Make the modified state history visible to readers.
+	 */
+	void publish_state_history();
+
 	void add_child(const std::shared_ptr<View> &view);
 
+	/**
+	 * Call the notification callbacks of this view for the given objects.
+	 */
+	void notify(const changed_objects_t &changed_objs, order_t t) const;
+
+	/**
+	 * Objects changed by a commit at some time.
+	 */
+	struct pending_notification {
+		order_t t;
+		changed_objects_t changed_objs;
+	};
+
 	/**
 	 * Database used if the state curve has no information about
 	 * the queried object at all.
@@ -102,28 +381,68 @@ protected:
 
 	/**
 	 * Data storage over time.
+	 * In concurrent read mode, it is only replaced atomically,
+	 * never modified.
 	 */
-	StateHistory state;
+	std::shared_ptr<StateHistory> state;
 
 	/**
-	 * Child views. Used to propagate down patches.
+	 * Modified copy of the state history in concurrent read mode,
+	 * nullptr if no transaction modifies the view.
+	 */
+	std::shared_ptr<StateHistory> pending_state;
+
+	/**
+	 * True if other threads may read while the view is modified.
+	 */
+	bool concurrent_reads;
+
+	/**
+	 * Child views. Used to propagate down patches
+	 * to those that have records of their own.
 	 */
 	std::vector<std::weak_ptr<View>> children;
 
 	/**
 	 * If this view is a child of another view, this pointer
 	 * can bring us back to the parent.
+	 * Data that this view has no records for is looked up there,
+	 * so the parent is kept alive.
 	 */
-	std::weak_ptr<View> parent_view;
+	std::shared_ptr<View> parent_view;
+
+	/**
+	 * Time until which the changes of the parent view are seen
+	 * in this view. LATEST_T unless this view is a fork.
+	 */
+	order_t fork_time;
 
 	/**
 	 * Registered event notification callbacks.
 	 */
-	std::unordered_map<fqon_t, std::unordered_set<std::shared_ptr<ObjectNotifierHandle>>> notifiers;
+	std::unordered_map<obj_id_t, std::unordered_set<std::shared_ptr<ObjectNotifierHandle>>> notifiers;
 
-	// TODO: track transactions and then use tracking to
-	//       check for transaction modificationconflicts
-	//       beware the child views so that conflicts in them are detected as well
+	/**
+	 * True if commits queue the notifications instead of calling them.
+	 */
+	bool async_notifications;
+
+	/**
+	 * Changes whose notifications were not dispatched yet.
+	 */
+	datastructure::MPSCQueue<pending_notification> notification_queue;
+
+	/**
+	 * Id of the last commit that changed each object in this view.
+	 * Used to detect transactions built from outdated objects.
+	 */
+	std::unordered_map<obj_id_t, transaction_id_t> last_writes;
+
+	/**
+	 * Id of the next commit when this view was last reset,
+	 * which may have changed all of its objects.
+	 */
+	transaction_id_t last_reset;
 };
 
 } // namespace nyan
@@ -0,0 +1,67 @@
+// Copyright 2019-2019 the nyan authors, LGPLv3+. See copying.md for legal info.
+
+#include "worker_pool.h"
+
+
+namespace nyan {
+
+
+WorkerPool::WorkerPool(size_t thread_count)
+	:
+	stop{false} {
+
+	this->threads.reserve(thread_count);
+	for (size_t i = 0; i < thread_count; i++) {
+		this->threads.emplace_back(&WorkerPool::work, this);
+	}
+}
+
+
+WorkerPool::~WorkerPool() {
+	this->cancel();
+	{
+		std::lock_guard<std::mutex> lock{this->mutex};
+		this->stop = true;
+	}
+	this->job_added.notify_all();
+
+	for (auto &thread : this->threads) {
+		thread.join();
+	}
+}
+
+
+void WorkerPool::cancel() {
+	std::deque<std::function<void()>> dropped;
+	{
+		std::lock_guard<std::mutex> lock{this->mutex};
+		dropped.swap(this->jobs);
+	}
+	// the tasks are destroyed outside of the lock.
+}
+
+
+void WorkerPool::work() {
+	while (true) {
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock{this->mutex};
+			this->job_added.wait(lock, [this] {
+				return this->stop or not this->jobs.empty();
+			});
+
+			if (this->stop) {
+				return;
+			}
+
+			job = std::move(this->jobs.front());
+			this->jobs.pop_front();
+		}
+
+		// exceptions are stored in the job's future.
+		job();
+	}
+}
+
+
+} // namespace nyan
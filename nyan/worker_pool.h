@@ -0,0 +1,97 @@
+// Copyright 2019-2019 the nyan authors, LGPLv3+. See copying.md for legal info.
+#pragma once
+
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace nyan {
+
+
+/**
+ * Fixed number of threads which run the submitted jobs in submit order.
+ * The threads are created once and reused for all jobs.
+ */
+class WorkerPool {
+public:
+	WorkerPool(size_t thread_count);
+
+	/**
+	 * Drops the jobs which didn't start yet and waits
+	 * for the running ones to finish.
+	 */
+	~WorkerPool();
+
+	WorkerPool(const WorkerPool &other) = delete;
+	WorkerPool(WorkerPool &&other) = delete;
+	WorkerPool &operator =(const WorkerPool &other) = delete;
+	WorkerPool &operator =(WorkerPool &&other) = delete;
+
+	/**
+	 * Queue a job. The result or the exception of the job
+	 * is delivered through the returned future.
+	 */
+	template <typename F>
+	auto submit(F &&func) -> std::future<decltype(func())> {
+		using result_t = decltype(func());
+
+		// std::function needs a copyable target.
+		auto task = std::make_shared<std::packaged_task<result_t()>>(std::forward<F>(func));
+		std::future<result_t> ret = task->get_future();
+
+		{
+			std::lock_guard<std::mutex> lock{this->mutex};
+			this->jobs.emplace_back([task] () { (*task)(); });
+		}
+		this->job_added.notify_one();
+
+		return ret;
+	}
+
+	/**
+	 * Drop the jobs which didn't start yet.
+	 * Their futures report a broken promise.
+	 */
+	void cancel();
+
+protected:
+	/**
+	 * Run jobs until the pool is destroyed.
+	 */
+	void work();
+
+	/**
+	 * Guards the job queue and the stop flag.
+	 */
+	std::mutex mutex;
+
+	/**
+	 * Signalled when a job is queued or the pool stops.
+	 */
+	std::condition_variable job_added;
+
+	/**
+	 * Jobs that wait for a thread.
+	 */
+	std::deque<std::function<void()>> jobs;
+
+	/**
+	 * Set when the threads shall exit.
+	 */
+	bool stop;
+
+	/**
+	 * The worker threads.
+	 */
+	std::vector<std::thread> threads;
+};
+
+
+} // namespace nyan